@@ -1,11 +1,14 @@
 #ifdef WIN32
-#include "KinectSensor.h"
+#include "kinectbodysource.h"
 #endif
 
+#include "gesturetracker.h"
 #include "renderer.h"
+#include "simulatedbodysource.h"
 
 #include <SDL.h>
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iostream>
@@ -96,6 +99,50 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // Options after the images argument.
+  std::string recordPath, replayPath, skeletonPath;
+  bool replayRealtime{true};
+  bool simulate{false};
+  JointFilter::Params filter;
+  UserArbiter::Policy arbiter{UserArbiter::Policy::Closest};
+  float predictMs{0.0f};
+  bool pace{false};
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    const bool hasValue{i + 1 < argc};
+    if (arg == "--record" && hasValue) {
+      recordPath = argv[++i];
+    } else if (arg == "--replay" && hasValue) {
+      replayPath = argv[++i];
+    } else if (arg == "--replay-fast" && hasValue) {
+      replayPath = argv[++i];
+      replayRealtime = false;
+    } else if (arg == "--simulate") {
+      simulate = true;
+    } else if (arg == "--simulate-file" && hasValue) {
+      simulate = true;
+      skeletonPath = argv[++i];
+    } else if (arg == "--filter" && hasValue &&
+               JointFilter::parse(argv[i + 1], &filter.kind)) {
+      ++i;
+    } else if (arg == "--arbiter" && hasValue &&
+               UserArbiter::parse(argv[i + 1], &arbiter)) {
+      ++i;
+    } else if (arg == "--predict" && hasValue) {
+      predictMs = static_cast<float>(std::atof(argv[++i]));
+    } else if (arg == "--pace") {
+      pace = true;
+    } else {
+      std::cerr << "Unknown option " << arg << "\n"
+                << "Options: --record LOG, --replay LOG, --replay-fast LOG,"
+                   " --simulate, --simulate-file SKELETONS,"
+                   " --filter none|boxcar|oneeuro|doubleexp,"
+                   " --arbiter closest|engaged|raised, --predict MS,"
+                   " --pace\n";
+      return 1;
+    }
+  }
+
   std::vector<std::string> paths;
 #ifdef WIN32
   if (!parseImagesDirectory(argv[1], &paths)) {
@@ -114,22 +161,48 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-#ifdef WIN32
-  KinectSensor::handCoords[0] = 0.0f;
-  KinectSensor::handCoords[1] = 0.0f;
-  KinectSensor::handCoords[2] = 0.0f;
+  if (!recordPath.empty() && !renderer.recordInput(recordPath)) {
+    return 1;
+  }
+  if (!replayPath.empty() &&
+      !renderer.replayInput(replayPath, replayRealtime)) {
+    return 1;
+  }
 
-  std::thread t{&KinectSensor::updateHandPosition};
+  // Gestures come from the Kinect, or from a simulated skeleton that loops
+  // over its stream. Created last, nothing can fail after its sensor thread
+  // has started.
+  GestureTracker *tracker{nullptr};
+  if (simulate) {
+    tracker = new GestureTracker(
+        new SimulatedBodySource(skeletonPath, 1.0f, true), filter, arbiter);
+    renderer.gestureCursor(true);
+  }
+#ifdef WIN32
+  else {
+    tracker = new GestureTracker(new KinectBodySource(), filter, arbiter);
+  }
 #endif
+  if (predictMs > 0.0f) {
+    // Look ahead to the measured presentation time, at most predictMs.
+    CursorPredictor::Params prediction;
+    prediction.horizonMs = predictMs;
+    prediction.maxHorizonMs = predictMs;
+    renderer.predictCursor(prediction);
+  }
+  renderer.framePacing(pace);
+  if (tracker != nullptr) {
+    renderer.gestureTracker(tracker);
+    tracker->start();
+  }
 
   renderer.loadImages(paths);
   renderer.loop();
 
-#ifdef WIN32
-  KinectSensor::KeepUpdatingHandPos = false;
-
-  t.join();
-#endif
+  // Stops the sensor thread before ~Renderer shuts down the event queue it
+  // posts to. The renderer must not be left holding the deleted tracker.
+  renderer.gestureTracker(nullptr);
+  delete tracker;
 
   return 0;
 }
@@ -0,0 +1,1260 @@
+////////////////////////////////////////////////////////////////////////////
+// SuperEpicBench: runs the Renderer without a person in front of it.
+//
+// A synthetic image set is written as BMP files, the renderer is started
+// on SDL's dummy video driver with the software renderer and a fixed script
+// of gallery pans, selections, zooms and mode transitions is played by
+// pushing SDL events between Renderer::step() calls. Load time, frame time
+// percentiles per phase, peak RSS and peak texture memory are written as
+// JSON.
+//
+// With --replay, an input log written by SuperEpic --record is replayed as
+// fast as possible after loading, instead of the script. With --gestures,
+// a simulated skeleton steers the renderer through the gesture path; the
+// built-in gesture script of SimulatedBodySource, or --skeleton FILE, at
+// --gesture-speed times real time, with the joints smoothed by --filter.
+// The frames the sensor thread received and dropped and the CPU time it
+// used are reported under "sensor", the latency percentiles of each stage
+// from skeleton frame to presented frame under "latency". --predict MS
+// draws the cursor where the hand is predicted to be, at most MS ahead;
+// "cursor_prediction" compares the latency it takes off with the error it
+// adds, on the gesture script with the --filter joint filter.
+// Every run also reports the error, jitter and lag of each JointFilter on
+// a noisy copy of the gesture script, and the time the GestureRecognizer
+// takes per skeleton frame on that script. The "crowd" report times the
+// filter, the recognizers and the UserArbiter, chosen with --arbiter, on
+// that script with one to six people in view. "pixel_kernels" times each
+// PixelKernels kernel per instruction set on an image of --size and
+// compares its pixels with the scalar reference. "codecs" decodes an image
+// of --size in every format the bench can write through the CodecRegistry
+// and through IMG_Load, and to planar YUV where the codec can.
+// "texture_uploads" counts how the TextureUploader created the textures of
+// the run and the time it took, "peak_tier_bytes" the most texture memory
+// the images held in each TextureUploader::Tier.
+//
+//   SuperEpicBench [--images N] [--size WxH] [--huge N] [--huge-size WxH]
+//                  [--dir DIR] [--out FILE] [--warm] [--window]
+//                  [--replay LOG] [--gestures] [--skeleton FILE]
+//                  [--gesture-speed X] [--filter NAME] [--arbiter NAME]
+//                  [--predict MS]
+//
+// Run it from the SuperEpic directory so that ../res/ has the cursor images.
+// On Linux, with SDL2 and SDL2_image installed:
+//
+//   g++ -std=c++14 -O2 -pthread -o SuperEpicBench benchmark.cpp
+//       codecregistry.cpp cursor.cpp cursorpredictor.cpp gesture.cpp
+//       gesturerecognizer.cpp gesturetracker.cpp image.cpp imageloader.cpp
+//       inputlog.cpp jointfilter.cpp jpegdecoder.cpp latencytracer.cpp
+//       pixelkernels.cpp pngdecoder.cpp prefetcher.cpp proxycache.cpp
+//       renderer.cpp residency.cpp simulatedbodysource.cpp textureuploader.cpp
+//       tilepyramid.cpp userarbiter.cpp webpdecoder.cpp
+//       $(sdl2-config --cflags --libs)
+//       -lSDL2_image
+//
+// Add -DEPIC_LIBJPEG -ljpeg, -DEPIC_LIBPNG -lpng and -DEPIC_LIBWEBP -lwebp
+// to decode those formats without SDL_image, see CodecRegistry.
+////////////////////////////////////////////////////////////////////////////
+
+#include "codecregistry.h"
+#include "gesturetracker.h"
+#include "pixelkernels.h"
+#include "renderer.h"
+#include "simulatedbodysource.h"
+#include "yuvimage.h"
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef EPIC_LIBJPEG
+#include <jpeglib.h>
+#endif
+#ifdef EPIC_LIBWEBP
+#include <webp/encode.h>
+#endif
+
+#ifdef WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+const int BENCH_WIN_WIDTH{1280};
+const int BENCH_WIN_HEIGHT{720};
+
+/// Gallery columns on screen, see Renderer::getGalleryIndexFromCoord().
+const int GALLERY_COLUMNS{5};
+
+/// Give up on a phase that waits for the renderer after this many frames.
+const int MAX_WAIT_FRAMES{2000};
+
+/// Give up waiting for the initial loads after this long.
+const Uint32 MAX_LOAD_MS{120000};
+
+/// Standard deviation of the noise added to the joints for the filter
+/// report, in meters; about what the Kinect shows for a still hand.
+const float FILTER_NOISE_M{0.005f};
+/// Largest delay searched for when lining up filtered and clean tracks.
+const size_t MAX_FILTER_LAG_FRAMES{15};
+/// Times the gesture script is run through the GestureRecognizer alone.
+const int RECOGNIZER_PASSES{200};
+/// Horizons of the cursor prediction report, milliseconds.
+const float PREDICTION_HORIZONS_MS[]{0.0f, 33.0f, 66.0f, 100.0f};
+/// Largest delay searched for when lining up predicted and clean tracks.
+const int MAX_PREDICTION_LAG_MS{250};
+/// Times the gesture script is run for each crowd size.
+const int CROWD_PASSES{20};
+/// Times each pixel kernel runs per instruction set, the fastest counts.
+const int KERNEL_PASSES{3};
+/// Times each file of the codec report is decoded.
+const int CODEC_PASSES{5};
+/// Quality the codec report encodes JPEG and WebP files at.
+const int CODEC_QUALITY{90};
+
+struct Options {
+  int numImages{40};
+  SDL_Point imageDims{1920, 1080};
+  int numHuge{1};
+  SDL_Point hugeDims{8192, 6144};
+  std::string dir;
+  std::string out{"superepic-bench.json"};
+  bool warm{false};   ///< Keep the proxy cache of the previous run.
+  bool window{false}; ///< Use the default video driver, not dummy.
+  std::string replay; ///< Input log to replay instead of the script.
+  bool gestures{false}; ///< Run a simulated skeleton instead of the script.
+  std::string skeleton; ///< Skeleton stream, empty for the built-in one.
+  float gestureSpeed{1.0f};
+  JointFilter::Params filter;
+  UserArbiter::Policy arbiter{UserArbiter::Policy::Closest};
+  float predictMs{0.0f}; ///< Cursor prediction horizon, 0 for none.
+};
+
+/// Frame times of one part of the script.
+struct Phase {
+  std::string name;
+  std::vector<double> frameMs;
+};
+
+struct Bench {
+  Renderer *renderer;
+  std::vector<Phase> phases;
+  size_t peakTextureBytes;
+  std::array<size_t, TextureUploader::NUM_TIERS> peakTierBytes;
+};
+
+////////////////////////////////////////////////////////////////////////////
+size_t peakRssBytes() {
+#ifdef WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return pmc.PeakWorkingSetSize;
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss); // Bytes.
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024; // Kilobytes.
+#endif
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool parseDims(const char *s, SDL_Point *dims) {
+  return std::sscanf(s, "%dx%d", &dims->x, &dims->y) == 2 && dims->x > 0 &&
+         dims->y > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool parseOptions(int argc, char *argv[], Options *opts) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    const bool hasValue{i + 1 < argc};
+    if (arg == "--images" && hasValue) {
+      opts->numImages = std::max(GALLERY_COLUMNS + 1, std::atoi(argv[++i]));
+    } else if (arg == "--size" && hasValue) {
+      if (!parseDims(argv[++i], &opts->imageDims))
+        return false;
+    } else if (arg == "--huge" && hasValue) {
+      opts->numHuge = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--huge-size" && hasValue) {
+      if (!parseDims(argv[++i], &opts->hugeDims))
+        return false;
+    } else if (arg == "--dir" && hasValue) {
+      opts->dir = argv[++i];
+    } else if (arg == "--out" && hasValue) {
+      opts->out = argv[++i];
+    } else if (arg == "--warm") {
+      opts->warm = true;
+    } else if (arg == "--window") {
+      opts->window = true;
+    } else if (arg == "--replay" && hasValue) {
+      opts->replay = argv[++i];
+    } else if (arg == "--gestures") {
+      opts->gestures = true;
+    } else if (arg == "--skeleton" && hasValue) {
+      opts->gestures = true;
+      opts->skeleton = argv[++i];
+    } else if (arg == "--gesture-speed" && hasValue) {
+      opts->gestureSpeed = static_cast<float>(std::atof(argv[++i]));
+      if (opts->gestureSpeed <= 0.0f)
+        return false;
+    } else if (arg == "--filter" && hasValue) {
+      if (!JointFilter::parse(argv[++i], &opts->filter.kind))
+        return false;
+    } else if (arg == "--arbiter" && hasValue) {
+      if (!UserArbiter::parse(argv[++i], &opts->arbiter))
+        return false;
+    } else if (arg == "--predict" && hasValue) {
+      opts->predictMs = static_cast<float>(std::atof(argv[++i]));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Fill \c surf with a pattern that depends on \c seed: a gradient
+///        with a checker board on top, so that downscaling has some work.
+void fillPattern(SDL_Surface *surf, Uint32 seed) {
+  const Uint8 r0{static_cast<Uint8>(seed * 67)};
+  const Uint8 g0{static_cast<Uint8>(seed * 131)};
+  const Uint8 b0{static_cast<Uint8>(seed * 199)};
+  const int cell{16 + static_cast<int>(seed % 7) * 8};
+
+  SDL_LockSurface(surf);
+  for (int y = 0; y < surf->h; ++y) {
+    Uint8 *row{static_cast<Uint8 *>(surf->pixels) + y * surf->pitch};
+    for (int x = 0; x < surf->w; ++x) {
+      const bool odd{((x / cell) + (y / cell)) % 2 == 1};
+      const Uint8 gx{static_cast<Uint8>(x * 255 / surf->w)};
+      const Uint8 gy{static_cast<Uint8>(y * 255 / surf->h)};
+      // 24 bit surfaces are BGR in memory with the masks used below.
+      row[x * 3 + 0] = static_cast<Uint8>(b0 + (odd ? gx : gy));
+      row[x * 3 + 1] = static_cast<Uint8>(g0 + gy);
+      row[x * 3 + 2] = static_cast<Uint8>(r0 + (odd ? gy : gx));
+    }
+  }
+  SDL_UnlockSurface(surf);
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Write the synthetic image set to opts.dir, reusing files of an
+///        earlier run. The huge images go to gallery indices 2, 2 + columns,
+///        and so on, where the script opens them.
+bool makeImages(const Options &opts, std::vector<std::string> *paths) {
+  int hugeLeft{opts.numHuge};
+  for (int i = 0; i < opts.numImages; ++i) {
+    const bool huge{hugeLeft > 0 && i % GALLERY_COLUMNS == 2};
+    const SDL_Point dims{huge ? opts.hugeDims : opts.imageDims};
+    if (huge)
+      --hugeLeft;
+
+    std::ostringstream name;
+    name << opts.dir << "bench_" << i << '_' << dims.x << 'x' << dims.y
+         << ".bmp";
+    paths->push_back(name.str());
+
+    SDL_RWops *existing{SDL_RWFromFile(name.str().c_str(), "rb")};
+    if (existing != nullptr) {
+      SDL_RWclose(existing);
+      continue;
+    }
+
+    SDL_Surface *surf{SDL_CreateRGBSurface(0, dims.x, dims.y, 24, 0x00ff0000,
+                                           0x0000ff00, 0x000000ff, 0)};
+    if (surf == nullptr) {
+      std::cerr << "Could not create synthetic image: " << SDL_GetError()
+                << "\n";
+      return false;
+    }
+    fillPattern(surf, static_cast<Uint32>(i + 1));
+    const int saved{SDL_SaveBMP(surf, name.str().c_str())};
+    SDL_FreeSurface(surf);
+    if (saved != 0) {
+      std::cerr << "Could not write " << name.str() << ": " << SDL_GetError()
+                << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void pushKey(SDL_Keycode key) {
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_KEYDOWN;
+  event.key.state = SDL_PRESSED;
+  event.key.keysym.sym = key;
+  SDL_PushEvent(&event);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void pushMotion(int x, int y) {
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_MOUSEMOTION;
+  event.motion.x = x;
+  event.motion.y = y;
+  SDL_PushEvent(&event);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void pushClick(Uint8 button) {
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_MOUSEBUTTONUP;
+  event.button.button = button;
+  event.button.state = SDL_RELEASED;
+  SDL_PushEvent(&event);
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Run one Renderer::step() and add its time to the current phase.
+void frame(Bench *bench) {
+  const Uint64 start{SDL_GetPerformanceCounter()};
+  bench->renderer->step();
+  const Uint64 end{SDL_GetPerformanceCounter()};
+
+  bench->phases.back().frameMs.push_back(
+      (end - start) * 1000.0 / SDL_GetPerformanceFrequency());
+  bench->peakTextureBytes = std::max(
+      bench->peakTextureBytes, bench->renderer->residency().residentBytes());
+  for (int t = 0; t < TextureUploader::NUM_TIERS; ++t) {
+    bench->peakTierBytes[t] = std::max(
+        bench->peakTierBytes[t],
+        bench->renderer->tierBytes(static_cast<TextureUploader::Tier>(t)));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void beginPhase(Bench *bench, const std::string &name) {
+  bench->phases.push_back({name, {}});
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Press \c key \c perFrame times in each of \c frames frames.
+void holdKey(Bench *bench, SDL_Keycode key, int perFrame, int frames) {
+  for (int f = 0; f < frames; ++f) {
+    for (int k = 0; k < perFrame; ++k) {
+      pushKey(key);
+    }
+    frame(bench);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Scroll the gallery back to its first image.
+void rewindGallery(Bench *bench) {
+  for (int f = 0;
+       f < MAX_WAIT_FRAMES && bench->renderer->galleryStartIndex() > 0; ++f) {
+    holdKey(bench, SDLK_RIGHT, 8, 1);
+  }
+
+  // Renderer::shiftCandidates() stops once the first image lines up with the
+  // left edge, 10 pixels per key press.
+  holdKey(bench, SDLK_RIGHT, 8, BENCH_WIN_WIDTH / GALLERY_COLUMNS / 80 + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Double click gallery column \c column and wait for image view.
+bool openImage(Bench *bench, int column) {
+  const int colWidth{BENCH_WIN_WIDTH / GALLERY_COLUMNS};
+  const int x{column * colWidth + colWidth / 2};
+  const int y{BENCH_WIN_HEIGHT / 2};
+
+  // The renderer only counts clicks while the hovered column is unchanged.
+  pushMotion(x, y);
+  frame(bench);
+  pushMotion(x, y);
+  frame(bench);
+
+  for (int f = 0; f < MAX_WAIT_FRAMES; ++f) {
+    if (bench->renderer->mode() == Renderer::DisplayMode::Image)
+      return true;
+    if (bench->renderer->mode() == Renderer::DisplayMode::Gallery) {
+      pushClick(SDL_BUTTON_LEFT); // Also waits out a still loading image.
+      pushClick(SDL_BUTTON_LEFT);
+    }
+    frame(bench);
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Zoom in, pan around, zoom back out and go back to the gallery.
+void exploreImage(Bench *bench) {
+  holdKey(bench, SDLK_a, 2, 100);
+  holdKey(bench, SDLK_LEFT, 4, 60);
+  holdKey(bench, SDLK_DOWN, 4, 60);
+  holdKey(bench, SDLK_RIGHT, 4, 60);
+  holdKey(bench, SDLK_UP, 4, 60);
+  holdKey(bench, SDLK_z, 2, 100);
+  pushKey(SDLK_ESCAPE);
+  frame(bench);
+}
+
+////////////////////////////////////////////////////////////////////////////
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  const size_t i{static_cast<size_t>(p * (sorted.size() - 1) + 0.5)};
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+////////////////////////////////////////////////////////////////////////////
+void writeFrameStats(std::ostream &json, std::vector<double> ms) {
+  std::sort(ms.begin(), ms.end());
+  double sum{0.0};
+  for (double t : ms) {
+    sum += t;
+  }
+
+  json << "\"frames\": " << ms.size() << ", \"mean_ms\": "
+       << (ms.empty() ? 0.0 : sum / ms.size())
+       << ", \"p50_ms\": " << percentile(ms, 0.50)
+       << ", \"p90_ms\": " << percentile(ms, 0.90)
+       << ", \"p95_ms\": " << percentile(ms, 0.95)
+       << ", \"p99_ms\": " << percentile(ms, 0.99)
+       << ", \"max_ms\": " << (ms.empty() ? 0.0 : ms.back());
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Roughly normal noise with unit variance, deterministic.
+float noise(Uint32 *seed) {
+  float sum{0.0f};
+  for (int i = 0; i < 4; ++i) {
+    *seed = *seed * 1664525u + 1013904223u;
+    sum += (*seed >> 8) / 16777216.0f;
+  }
+  return (sum - 2.0f) * 1.7320508f;
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Run the built-in gesture script with noise on every joint through
+///        a JointFilter of \c kind and compare the right hand to the clean
+///        track: the error, the jitter left while the hand is held still,
+///        and the delay that best lines the filtered track up with the clean
+///        one.
+void writeFilterReport(std::ostream &json, JointFilter::Kind kind) {
+  const std::vector<BodyFrame> clean{SimulatedBodySource::script()};
+  const int hand{static_cast<int>(BodyFrame::JointType::HandRight)};
+
+  JointFilter::Params params;
+  params.kind = kind;
+  JointFilter filter{params};
+
+  std::vector<float> x, y; // The filtered right hand.
+  Uint32 seed{12345};
+  for (const BodyFrame &f : clean) {
+    BodyFrame noisy = f;
+    float *joints = &noisy.bodies[0].joints[0][0];
+    for (int c = 0; c < BodyFrame::JOINT_COUNT * 3; ++c) {
+      joints[c] += FILTER_NOISE_M * noise(&seed);
+    }
+    filter.apply(&noisy);
+    x.push_back(noisy.bodies[0].joints[hand][0]);
+    y.push_back(noisy.bodies[0].joints[hand][1]);
+  }
+
+  const auto rmsError = [&](size_t lag) {
+    double sum{0.0};
+    for (size_t i = lag; i < x.size(); ++i) {
+      const float *truth = clean[i - lag].bodies[0].joints[hand];
+      const double dx{x[i] - truth[0]}, dy{y[i] - truth[1]};
+      sum += dx * dx + dy * dy;
+    }
+    return std::sqrt(sum / (x.size() - lag));
+  };
+
+  size_t lag{0};
+  for (size_t l = 1; l <= MAX_FILTER_LAG_FRAMES; ++l) {
+    if (rmsError(l) < rmsError(lag))
+      lag = l;
+  }
+
+  double jitter{0.0};
+  size_t still{0};
+  for (size_t i = 1; i < x.size(); ++i) {
+    const float *a = clean[i - 1].bodies[0].joints[hand];
+    const float *b = clean[i].bodies[0].joints[hand];
+    if (a[0] == b[0] && a[1] == b[1]) {
+      const double dx{x[i] - x[i - 1]}, dy{y[i] - y[i - 1]};
+      jitter += dx * dx + dy * dy;
+      ++still;
+    }
+  }
+
+  json << "{\"filter\": \"" << JointFilter::name(kind)
+       << "\", \"error_mm\": " << rmsError(0) * 1000.0
+       << ", \"jitter_mm\": "
+       << (still > 0 ? std::sqrt(jitter / still) * 1000.0 : 0.0)
+       << ", \"lag_ms\": " << lag * SimulatedBodySource::FRAME_MS << "}";
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Run the noisy gesture script through the JointFilter of \c opts
+///        and a CursorPredictor looking \c horizonMs ahead, the way the
+///        renderer places the cursor, and compare with the clean hand: the
+///        latency left, i.e. the delay that best lines the predicted track
+///        up with the clean one, and the error against where the hand
+///        really was \c horizonMs later.
+void writePredictionReport(std::ostream &json, const Options &opts,
+                           float horizonMs) {
+  const std::vector<BodyFrame> clean{SimulatedBodySource::script()};
+  const int hand{static_cast<int>(BodyFrame::JointType::HandRight)};
+  const int spine{static_cast<int>(BodyFrame::JointType::SpineBase)};
+
+  // The clean hand relative to the spine at sensor time ms, interpolated.
+  const auto cleanAt = [&](double ms, int c) {
+    const double f = std::min(std::max(ms, 0.0) / SimulatedBodySource::FRAME_MS,
+                              static_cast<double>(clean.size() - 1));
+    const size_t i = static_cast<size_t>(f);
+    const size_t j = std::min(i + 1, clean.size() - 1);
+    const float *a = clean[i].bodies[0].joints[hand];
+    const float *b = clean[j].bodies[0].joints[hand];
+    const double wa = a[c] - clean[i].bodies[0].joints[spine][c];
+    const double wb = b[c] - clean[j].bodies[0].joints[spine][c];
+    return wa + (wb - wa) * (f - i);
+  };
+
+  JointFilter filter{opts.filter};
+  CursorPredictor::Params params;
+  params.adaptive = false;
+  params.horizonMs = horizonMs;
+  params.maxHorizonMs = horizonMs;
+  CursorPredictor predictor{params};
+
+  std::vector<float> x, y; // The predicted hand.
+  Uint32 seed{12345};
+  for (const BodyFrame &f : clean) {
+    BodyFrame noisy = f;
+    float *joints = &noisy.bodies[0].joints[0][0];
+    for (int c = 0; c < BodyFrame::JOINT_COUNT * 3; ++c) {
+      joints[c] += FILTER_NOISE_M * noise(&seed);
+    }
+    filter.apply(&noisy);
+
+    const BodyFrame::Body &body = noisy.bodies[0];
+    const float coords[3]{body.joints[hand][0] - body.joints[spine][0],
+                          body.joints[hand][1] - body.joints[spine][1],
+                          body.joints[hand][2] - body.joints[spine][2]};
+    predictor.update(coords, f.ms);
+    float predicted[3];
+    predictor.predict(horizonMs, predicted);
+    x.push_back(predicted[0]);
+    y.push_back(predicted[1]);
+  }
+
+  // RMS distance to the clean hand shifted by shiftMs.
+  const auto rmsError = [&](double shiftMs) {
+    double sum{0.0};
+    for (size_t i = 0; i < x.size(); ++i) {
+      const double ms = clean[i].ms + shiftMs;
+      const double dx{x[i] - cleanAt(ms, 0)}, dy{y[i] - cleanAt(ms, 1)};
+      sum += dx * dx + dy * dy;
+    }
+    return std::sqrt(sum / x.size());
+  };
+
+  int lag{0};
+  for (int l = -MAX_PREDICTION_LAG_MS; l <= MAX_PREDICTION_LAG_MS; ++l) {
+    if (rmsError(-l) < rmsError(-lag))
+      lag = l;
+  }
+
+  double maxError{0.0};
+  for (size_t i = 0; i < x.size(); ++i) {
+    const double ms = clean[i].ms + horizonMs;
+    const double dx{x[i] - cleanAt(ms, 0)}, dy{y[i] - cleanAt(ms, 1)};
+    maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy));
+  }
+
+  json << "{\"horizon_ms\": " << horizonMs << ", \"lag_ms\": " << lag
+       << ", \"error_mm\": " << rmsError(horizonMs) * 1000.0
+       << ", \"max_error_mm\": " << maxError * 1000.0 << "}";
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Time the GestureRecognizer alone on the built-in gesture script,
+///        switching the view the way the renderer would.
+void writeRecognizerReport(std::ostream &json) {
+  const std::vector<BodyFrame> frames{SimulatedBodySource::script()};
+
+  size_t transitions{0}, entered{0};
+  const Uint64 start{SDL_GetPerformanceCounter()};
+  for (int pass = 0; pass < RECOGNIZER_PASSES; ++pass) {
+    GestureRecognizer recognizer;
+    GestureView view{GestureView::Gallery};
+    for (const BodyFrame &frame : frames) {
+      const GestureSample sample{
+          recognizer.update(frame.bodies[0], frame.ms, view)};
+      if (sample.type != sample.previous) {
+        ++entered;
+        if (sample.type == GestureType::ZoomIn)
+          view = GestureView::Image;
+        else if (sample.type == GestureType::ZoomOut)
+          view = GestureView::Gallery;
+      }
+    }
+    transitions += recognizer.transitions();
+  }
+  const double ns{(SDL_GetPerformanceCounter() - start) * 1e9 /
+                  SDL_GetPerformanceFrequency()};
+  const size_t updates{frames.size() * RECOGNIZER_PASSES};
+
+  json << "{\"updates\": " << updates
+       << ", \"ns_per_update\": " << ns / updates
+       << ", \"transitions_per_pass\": " << transitions / RECOGNIZER_PASSES
+       << ", \"gestures_per_pass\": " << entered / RECOGNIZER_PASSES << "}";
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Time GestureTracker::process() on the built-in gesture script
+///        with \c people in view. The others stand further back and to the
+///        side and run the script out of step with the first.
+void writeCrowdReport(std::ostream &json, const Options &opts, int people) {
+  const std::vector<BodyFrame> script{SimulatedBodySource::script()};
+  std::vector<BodyFrame> frames{script};
+  for (size_t f = 0; f < frames.size(); ++f) {
+    for (int b = 1; b < people; ++b) {
+      BodyFrame::Body &body = frames[f].bodies[b];
+      body = script[(f + 97 * b) % script.size()].bodies[0];
+      body.trackingId = static_cast<Uint64>(b) + 1;
+      for (auto &joint : body.joints) {
+        joint[0] += 0.7f * (b % 2 == 0 ? b / 2 : -(b + 1) / 2);
+        joint[2] += 0.4f * b;
+      }
+    }
+  }
+
+  // Never started, process() runs on this thread.
+  GestureTracker tracker{new SimulatedBodySource("", 0.0f, false), opts.filter,
+                         opts.arbiter};
+  const Uint64 start{SDL_GetPerformanceCounter()};
+  for (int pass = 0; pass < CROWD_PASSES; ++pass) {
+    for (const BodyFrame &f : frames) {
+      BodyFrame frame = f;
+      GestureSample gesture;
+      tracker.process(&frame, GestureView::Gallery, &gesture);
+    }
+  }
+  const double ns{(SDL_GetPerformanceCounter() - start) * 1e9 /
+                  SDL_GetPerformanceFrequency()};
+
+  json << "{\"people\": " << people << ", \"ns_per_frame\": "
+       << ns / (frames.size() * CROWD_PASSES)
+       << ", \"handoffs\": " << tracker.handoffs() << "}";
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Largest difference of a channel between two ARGB8888 surfaces of
+///        the same size.
+int maxChannelDiff(const SDL_Surface *a, const SDL_Surface *b) {
+  int diff{0};
+  for (int y = 0; y < a->h; ++y) {
+    const Uint8 *pa{static_cast<const Uint8 *>(a->pixels) + y * a->pitch};
+    const Uint8 *pb{static_cast<const Uint8 *>(b->pixels) + y * b->pitch};
+    for (int i = 0; i < a->w * 4; ++i) {
+      diff = std::max(diff, std::abs(pa[i] - pb[i]));
+    }
+  }
+  return diff;
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Time every PixelKernels kernel on an image of opts.imageDims, for
+///        each instruction set this CPU runs, and compare the pixels with
+///        those of the scalar reference.
+void writeKernelReport(std::ostream &json, const Options &opts) {
+  const int w{opts.imageDims.x}, h{opts.imageDims.y};
+  const PixelKernels &scalar{PixelKernels::scalar()};
+
+  // The pattern of fillPattern(), as RGB24, and with a varying alpha as
+  // the ARGB8888 input of the other kernels.
+  std::vector<Uint8> rgb(static_cast<size_t>(w) * h * 3);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      const bool odd{((x / 16) + (y / 16)) % 2 == 1};
+      Uint8 *p{&rgb[(static_cast<size_t>(y) * w + x) * 3]};
+      p[0] = static_cast<Uint8>(odd ? y * 255 / h : x * 255 / w);
+      p[1] = static_cast<Uint8>(y * 255 / h);
+      p[2] = static_cast<Uint8>(odd ? x * 255 / w : y * 255 / h);
+    }
+  }
+  SDL_Surface *src{SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00,
+                                        0x000000ff, 0xff000000)};
+  if (src == nullptr) {
+    json << "null";
+    return;
+  }
+  for (int y = 0; y < h; ++y) {
+    Uint32 *row{reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(src->pixels) +
+                                           y * src->pitch)};
+    scalar.rgb24ToArgb(&rgb[static_cast<size_t>(y) * w * 3], row, w);
+    for (int x = 0; x < w; ++x) {
+      row[x] = (row[x] & 0x00ffffff) | (static_cast<Uint32>(x ^ y) << 24);
+    }
+  }
+
+  struct Kernel {
+    const char *name;
+    SDL_Point dims; ///< Of the output.
+    bool inPlace;   ///< Works on a copy of the input in the output.
+    std::function<void(const PixelKernels &, SDL_Surface *)> run;
+  };
+  const auto copyRows = [src](SDL_Surface *out) {
+    for (int y = 0; y < src->h; ++y) {
+      SDL_memcpy(static_cast<Uint8 *>(out->pixels) + y * out->pitch,
+                 static_cast<Uint8 *>(src->pixels) + y * src->pitch,
+                 src->w * 4);
+    }
+  };
+  const auto rotate = [src](int degrees) {
+    return [src, degrees](const PixelKernels &k, SDL_Surface *out) {
+      k.rotate(src, out, degrees);
+    };
+  };
+  const Kernel kernels[]{
+      {"rgb24_to_argb", {w, h}, false,
+       [&](const PixelKernels &k, SDL_Surface *out) {
+         for (int y = 0; y < h; ++y) {
+           k.rgb24ToArgb(&rgb[static_cast<size_t>(y) * w * 3],
+                         reinterpret_cast<Uint32 *>(
+                             static_cast<Uint8 *>(out->pixels) +
+                             y * out->pitch),
+                         w);
+         }
+       }},
+      {"premultiply", {w, h}, true,
+       [&](const PixelKernels &k, SDL_Surface *out) {
+         for (int y = 0; y < h; ++y) {
+           k.premultiply(reinterpret_cast<Uint32 *>(
+                             static_cast<Uint8 *>(out->pixels) +
+                             y * out->pitch),
+                         w);
+         }
+       }},
+      // About the gallery proxy and the screen proxy.
+      {"downscale_area", {std::max(1, w / 6), std::max(1, h / 6)}, false,
+       [src](const PixelKernels &k, SDL_Surface *out) {
+         k.downscaleArea(src, out);
+       }},
+      {"downscale_lanczos", {std::max(1, w * 2 / 3), std::max(1, h * 2 / 3)},
+       false,
+       [src](const PixelKernels &k, SDL_Surface *out) {
+         k.downscaleLanczos(src, out);
+       }},
+      {"rotate_90", {h, w}, false, rotate(90)},
+      {"rotate_180", {w, h}, false, rotate(180)},
+      {"rotate_270", {h, w}, false, rotate(270)},
+      // The IYUV planes back to back, in an output of 2 bytes per pixel.
+      {"argb_to_yuv420", {w, (h + 1) / 2}, false,
+       [src, w, h](const PixelKernels &k, SDL_Surface *out) {
+         const size_t lumaSize{static_cast<size_t>(w) * h};
+         const size_t chromaSize{static_cast<size_t>((w + 1) / 2) *
+                                 ((h + 1) / 2)};
+         Uint8 *y{static_cast<Uint8 *>(out->pixels)};
+         k.argbToYuv420(src, y, y + lumaSize, y + lumaSize + chromaSize);
+       }}};
+
+  json << "{\"best\": \"" << PixelKernels::name(PixelKernels::best().isa)
+       << "\", \"width\": " << w << ", \"height\": " << h
+       << ", \"kernels\": [\n";
+  const PixelKernels::Isa isas[]{PixelKernels::Isa::Scalar,
+                                 PixelKernels::Isa::SSE2,
+                                 PixelKernels::Isa::AVX2,
+                                 PixelKernels::Isa::NEON};
+  for (const Kernel &kernel : kernels) {
+    SDL_Surface *reference{nullptr};
+    double scalarMs{0.0};
+    json << "      {\"kernel\": \"" << kernel.name << "\", \"variants\": [";
+    bool first{true};
+    for (auto isa : isas) {
+      const PixelKernels *k{PixelKernels::get(isa)};
+      if (k == nullptr)
+        continue;
+
+      SDL_Surface *out{SDL_CreateRGBSurface(0, kernel.dims.x, kernel.dims.y,
+                                            32, 0x00ff0000, 0x0000ff00,
+                                            0x000000ff, 0xff000000)};
+      if (out == nullptr)
+        continue;
+
+      double ms{0.0};
+      for (int pass = 0; pass < KERNEL_PASSES; ++pass) {
+        if (kernel.inPlace)
+          copyRows(out);
+        const Uint64 start{SDL_GetPerformanceCounter()};
+        kernel.run(*k, out);
+        const double passMs{(SDL_GetPerformanceCounter() - start) * 1000.0 /
+                            SDL_GetPerformanceFrequency()};
+        ms = pass == 0 ? passMs : std::min(ms, passMs);
+      }
+
+      if (reference == nullptr) {
+        reference = out;
+        scalarMs = ms;
+      }
+      json << (first ? "" : ", ") << "{\"isa\": \"" << PixelKernels::name(isa)
+           << "\", \"ms\": " << ms
+           << ", \"mpix_per_s\": " << (ms > 0.0 ? w * h / (ms * 1000.0) : 0.0)
+           << ", \"speedup\": " << (ms > 0.0 ? scalarMs / ms : 0.0)
+           << ", \"max_diff\": " << maxChannelDiff(reference, out) << "}";
+      first = false;
+      if (out != reference)
+        SDL_FreeSurface(out);
+    }
+    SDL_FreeSurface(reference);
+    json << "]}" << (&kernel != std::end(kernels) - 1 ? "," : "") << "\n";
+  }
+  json << "    ]}";
+  SDL_FreeSurface(src);
+}
+
+#ifdef EPIC_LIBJPEG
+////////////////////////////////////////////////////////////////////////////
+/// \brief Write the ARGB8888 surface \c argb to \c path as a JPEG.
+bool saveJPEG(SDL_Surface *argb, const std::string &path) {
+  FILE *file{std::fopen(path.c_str(), "wb")};
+  if (file == nullptr)
+    return false;
+
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr err;
+  cinfo.err = jpeg_std_error(&err);
+  jpeg_create_compress(&cinfo);
+  jpeg_stdio_dest(&cinfo, file);
+  cinfo.image_width = argb->w;
+  cinfo.image_height = argb->h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, CODEC_QUALITY, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+
+  std::vector<Uint8> rgb(argb->w * 3);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const Uint32 *in{reinterpret_cast<const Uint32 *>(
+        static_cast<Uint8 *>(argb->pixels) +
+        cinfo.next_scanline * argb->pitch)};
+    for (int x = 0; x < argb->w; ++x) {
+      rgb[x * 3 + 0] = static_cast<Uint8>(in[x] >> 16);
+      rgb[x * 3 + 1] = static_cast<Uint8>(in[x] >> 8);
+      rgb[x * 3 + 2] = static_cast<Uint8>(in[x]);
+    }
+    JSAMPROW row{rgb.data()};
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return std::fclose(file) == 0;
+}
+#endif
+
+#ifdef EPIC_LIBWEBP
+////////////////////////////////////////////////////////////////////////////
+/// \brief Write the ARGB8888 surface \c argb to \c path as a lossy WebP.
+bool saveWebP(SDL_Surface *argb, const std::string &path) {
+  uint8_t *encoded{nullptr};
+  const size_t size{WebPEncodeBGRA(static_cast<const uint8_t *>(argb->pixels),
+                                   argb->w, argb->h, argb->pitch,
+                                   static_cast<float>(CODEC_QUALITY),
+                                   &encoded)};
+  SDL_RWops *file{size > 0 ? SDL_RWFromFile(path.c_str(), "wb") : nullptr};
+  const bool ok{file != nullptr &&
+                SDL_RWwrite(file, encoded, 1, size) == size};
+  if (file != nullptr)
+    SDL_RWclose(file);
+  WebPFree(encoded);
+  return ok;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Decode an image of opts.imageDims in each format the bench can
+///        write, through the CodecRegistry and through IMG_Load with the
+///        conversion to ARGB8888 the loader did before.
+void writeCodecReport(std::ostream &json, const Options &opts) {
+  SDL_Surface *rgb{SDL_CreateRGBSurface(0, opts.imageDims.x, opts.imageDims.y,
+                                        24, 0x00ff0000, 0x0000ff00,
+                                        0x000000ff, 0)};
+  SDL_Surface *argb{nullptr};
+  if (rgb != nullptr) {
+    fillPattern(rgb, 1);
+    argb = SDL_ConvertSurfaceFormat(rgb, SDL_PIXELFORMAT_ARGB8888, 0);
+  }
+  if (argb == nullptr) {
+    SDL_FreeSurface(rgb);
+    json << "[]";
+    return;
+  }
+
+  struct Format {
+    const char *name;
+    std::function<bool(const std::string &)> save;
+  };
+  const Format formats[]{
+      {"bmp",
+       [&](const std::string &path) {
+         return SDL_SaveBMP(rgb, path.c_str()) == 0;
+       }},
+      {"png",
+       [&](const std::string &path) {
+         return IMG_SavePNG(rgb, path.c_str()) == 0;
+       }},
+#ifdef EPIC_LIBJPEG
+      {"jpg", [&](const std::string &path) { return saveJPEG(argb, path); }},
+#endif
+#ifdef EPIC_LIBWEBP
+      {"webp", [&](const std::string &path) { return saveWebP(argb, path); }},
+#endif
+  };
+
+  const CodecRegistry codecs;
+  const double pixels{static_cast<double>(argb->w) * argb->h};
+  json << "[";
+  bool first{true};
+  for (const Format &format : formats) {
+    const std::string path{opts.dir + "codec." + format.name};
+    if (!format.save(path)) {
+      std::cerr << "Could not write " << path << ": " << SDL_GetError()
+                << "\n";
+      continue;
+    }
+
+    const char *codec{"none"};
+    Uint64 start{SDL_GetPerformanceCounter()};
+    for (int pass = 0; pass < CODEC_PASSES; ++pass) {
+      SDL_Point dims;
+      SDL_FreeSurface(codecs.load(path, {0, 0}, &dims, &codec));
+    }
+    const double ms{(SDL_GetPerformanceCounter() - start) * 1000.0 /
+                    SDL_GetPerformanceFrequency() / CODEC_PASSES};
+
+    start = SDL_GetPerformanceCounter();
+    for (int pass = 0; pass < CODEC_PASSES; ++pass) {
+      SDL_Surface *decoded{IMG_Load(path.c_str())};
+      if (decoded != nullptr) {
+        SDL_FreeSurface(
+            SDL_ConvertSurfaceFormat(decoded, SDL_PIXELFORMAT_ARGB8888, 0));
+        SDL_FreeSurface(decoded);
+      }
+    }
+    const double imgMs{(SDL_GetPerformanceCounter() - start) * 1000.0 /
+                       SDL_GetPerformanceFrequency() / CODEC_PASSES};
+
+    // Planar YUV, for the codecs that decode to it.
+    bool yuv{true};
+    start = SDL_GetPerformanceCounter();
+    for (int pass = 0; pass < CODEC_PASSES && yuv; ++pass) {
+      SDL_Point dims;
+      YUVImage *planes{nullptr};
+      SDL_FreeSurface(codecs.load(path, {0, 0}, &dims, nullptr, &planes));
+      yuv = planes != nullptr;
+      delete planes;
+    }
+    const double yuvMs{(SDL_GetPerformanceCounter() - start) * 1000.0 /
+                       SDL_GetPerformanceFrequency() / CODEC_PASSES};
+
+    json << (first ? "\n" : ",\n") << "    {\"format\": \"" << format.name
+         << "\", \"codec\": \"" << codec << "\", \"ms\": " << ms
+         << ", \"mpix_per_s\": " << (ms > 0.0 ? pixels / (ms * 1000.0) : 0.0)
+         << ", \"img_load_ms\": " << imgMs
+         << ", \"speedup\": " << (ms > 0.0 ? imgMs / ms : 0.0);
+    if (yuv)
+      json << ", \"yuv_ms\": " << yuvMs;
+    json << "}";
+    first = false;
+  }
+  json << (first ? "]" : "\n  ]");
+
+  SDL_FreeSurface(argb);
+  SDL_FreeSurface(rgb);
+}
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Play the fixed script after loading.
+/// \return false if the renderer did not open an image when asked to.
+bool runScript(Bench *bench) {
+  bool opened{true};
+
+  beginPhase(bench, "pan_slow");
+  holdKey(bench, SDLK_LEFT, 1, 240);
+
+  beginPhase(bench, "pan_fast");
+  holdKey(bench, SDLK_LEFT, 8, 240);
+
+  beginPhase(bench, "pan_back");
+  rewindGallery(bench);
+
+  beginPhase(bench, "image");
+  opened = openImage(bench, 1) && opened;
+  exploreImage(bench);
+
+  beginPhase(bench, "image_huge");
+  opened = openImage(bench, 2) && opened;
+  exploreImage(bench);
+
+  return opened;
+}
+
+////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[]) {
+  Options opts;
+  if (!parseOptions(argc, argv, &opts)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--images N] [--size WxH] [--huge N] [--huge-size WxH]"
+                 " [--dir DIR] [--out FILE] [--warm] [--window]"
+                 " [--replay LOG] [--gestures] [--skeleton FILE]"
+                 " [--gesture-speed X] [--filter NAME] [--arbiter NAME]"
+                 " [--predict MS]\n";
+    return 1;
+  }
+
+  if (!opts.window) {
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+  }
+
+  if (opts.dir.empty()) {
+    char *pref{SDL_GetPrefPath("SuperEpic", "Bench")};
+    if (pref == nullptr) {
+      std::cerr << "No directory for the synthetic images, use --dir.\n";
+      return 1;
+    }
+    opts.dir = pref;
+    SDL_free(pref);
+  }
+  if (opts.dir.back() != '/' && opts.dir.back() != '\\') {
+    opts.dir += '/';
+  }
+
+  std::vector<std::string> paths;
+  if (!makeImages(opts, &paths)) {
+    return 1;
+  }
+
+  // A cache of its own, so that the user's cache does not skew a cold run.
+  std::string cacheDir;
+  {
+    char *pref{SDL_GetPrefPath("SuperEpic", "BenchProxyCache")};
+    if (pref != nullptr) {
+      cacheDir = pref;
+      SDL_free(pref);
+    }
+    if (!opts.warm && !cacheDir.empty()) {
+      ProxyCache(cacheDir).clear();
+    }
+  }
+
+  Bench bench{nullptr, {}, 0, {}};
+  double loadMs{0.0};
+  bool opened{true};
+  size_t framesRendered{0}, framesSkipped{0}, evictions{0};
+  size_t prefetchHits{0}, prefetchMisses{0};
+  size_t sensorReceived{0}, sensorDropped{0}, gesturesDropped{0};
+  size_t handoffs{0};
+  std::ostringstream latency, uploads;
+  double sensorCpuMs{0.0}, gestureMs{0.0};
+  {
+    Renderer renderer{BENCH_WIN_WIDTH, BENCH_WIN_HEIGHT,
+                      SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED};
+    renderer.startFullScreen(false);
+    renderer.softwareRenderer(!opts.window);
+    renderer.proxyCacheDir(cacheDir);
+    // Every step() draws a frame, so that frame times are comparable.
+    renderer.renderOnDemand(false);
+    // Scripted mouse events do not move SDL's mouse state, only gestures
+    // can be latched.
+    renderer.lateLatch(opts.gestures);
+    if (opts.predictMs > 0.0f) {
+      CursorPredictor::Params prediction;
+      prediction.horizonMs = opts.predictMs;
+      prediction.maxHorizonMs = opts.predictMs;
+      renderer.predictCursor(prediction);
+    }
+    if (renderer.init() < 0) {
+      std::cerr << "Could not create Renderer! Exiting..." << std::endl;
+      return 1;
+    }
+    bench.renderer = &renderer;
+
+    beginPhase(&bench, "load");
+    const Uint32 loadStart{SDL_GetTicks()};
+    renderer.loadImages(paths);
+    do {
+      frame(&bench);
+    } while (renderer.pendingLoads() > 0 &&
+             SDL_GetTicks() - loadStart < MAX_LOAD_MS);
+    loadMs = SDL_GetTicks() - loadStart;
+
+    if (!opts.replay.empty()) {
+      beginPhase(&bench, "replay");
+      opened = renderer.replayInput(opts.replay, false);
+      while (opened && !Renderer::m_shouldQuit) {
+        frame(&bench);
+      }
+    } else if (opts.gestures) {
+      beginPhase(&bench, "gestures");
+      GestureTracker tracker{
+          new SimulatedBodySource(opts.skeleton, opts.gestureSpeed, false),
+          opts.filter, opts.arbiter};
+      renderer.gestureTracker(&tracker);
+      renderer.gestureCursor(true);
+      const Uint32 gestureStart{SDL_GetTicks()};
+      tracker.start();
+      while (!tracker.finished() && !Renderer::m_shouldQuit) {
+        frame(&bench);
+      }
+      tracker.stop();
+      gestureMs = SDL_GetTicks() - gestureStart;
+      opened = tracker.frames() > 0;
+      sensorReceived = tracker.framesReceived();
+      sensorDropped = tracker.framesDropped();
+      gesturesDropped = tracker.queueDropped();
+      handoffs = tracker.handoffs();
+      sensorCpuMs = tracker.cpuMs();
+      renderer.gestureTracker(nullptr);
+    } else {
+      opened = runScript(&bench);
+    }
+
+    framesRendered = renderer.framesRendered();
+    framesSkipped = renderer.framesSkipped();
+    evictions = renderer.residency().evictionCount();
+    prefetchHits = renderer.prefetcher().hits();
+    prefetchMisses = renderer.prefetcher().misses();
+    renderer.latency().writeJson(latency);
+
+    const TextureUploader &uploader{*renderer.uploader()};
+    uploads << "{\"format\": \"" << SDL_GetPixelFormatName(uploader.format())
+            << "\", \"streaming\": "
+            << (uploader.streaming() ? "true" : "false")
+            << ", \"streamed\": " << uploader.streamedCount()
+            << ", \"updated\": " << uploader.updatedCount()
+            << ", \"staged\": " << uploader.stagedCount()
+            << ", \"from_surface\": " << uploader.fallbackCount()
+            << ", \"yuv\": " << uploader.yuvCount()
+            << ", \"compact_format\": \""
+            << SDL_GetPixelFormatName(uploader.compactFormat())
+            << "\", \"compact\": " << uploader.compactCount()
+            << ", \"upload_ms\": " << uploader.uploadMs() << "}";
+  }
+
+  std::vector<double> all;
+  for (auto &phase : bench.phases) {
+    all.insert(all.end(), phase.frameMs.begin(), phase.frameMs.end());
+  }
+
+  std::ofstream json(opts.out);
+  if (!json.is_open()) {
+    std::cerr << "Could not write " << opts.out << "\n";
+    return 1;
+  }
+
+  json << "{\n";
+  json << "  \"images\": " << opts.numImages << ",\n";
+  json << "  \"image_size\": [" << opts.imageDims.x << ", "
+       << opts.imageDims.y << "],\n";
+  json << "  \"huge_images\": " << opts.numHuge << ",\n";
+  json << "  \"huge_image_size\": [" << opts.hugeDims.x << ", "
+       << opts.hugeDims.y << "],\n";
+  json << "  \"window\": [" << BENCH_WIN_WIDTH << ", " << BENCH_WIN_HEIGHT
+       << "],\n";
+  json << "  \"renderer\": \"" << (opts.window ? "accelerated" : "software")
+       << "\",\n";
+  json << "  \"warm_cache\": " << (opts.warm ? "true" : "false") << ",\n";
+  json << "  \"replay\": " << (opts.replay.empty() ? "false" : "true")
+       << ",\n";
+  json << "  \"gestures\": " << (opts.gestures ? "true" : "false") << ",\n";
+  json << "  \"filter\": \"" << JointFilter::name(opts.filter.kind)
+       << "\",\n";
+  json << "  \"script_completed\": " << (opened ? "true" : "false") << ",\n";
+  json << "  \"load_ms\": " << loadMs << ",\n";
+  json << "  \"phases\": [\n";
+  for (size_t i = 0; i < bench.phases.size(); ++i) {
+    json << "    {\"name\": \"" << bench.phases[i].name << "\", ";
+    writeFrameStats(json, bench.phases[i].frameMs);
+    json << "}" << (i + 1 < bench.phases.size() ? "," : "") << "\n";
+  }
+  json << "  ],\n";
+  json << "  \"all\": {";
+  writeFrameStats(json, all);
+  json << "},\n";
+  json << "  \"joint_filters\": [\n";
+  const JointFilter::Kind filters[]{
+      JointFilter::Kind::None, JointFilter::Kind::Boxcar,
+      JointFilter::Kind::OneEuro, JointFilter::Kind::DoubleExponential};
+  for (auto kind : filters) {
+    json << "    ";
+    writeFilterReport(json, kind);
+    json << (kind != filters[3] ? "," : "") << "\n";
+  }
+  json << "  ],\n";
+  json << "  \"pixel_kernels\": ";
+  writeKernelReport(json, opts);
+  json << ",\n";
+  json << "  \"codecs\": ";
+  writeCodecReport(json, opts);
+  json << ",\n";
+  json << "  \"gesture_recognizer\": ";
+  writeRecognizerReport(json);
+  json << ",\n";
+  json << "  \"latency\": " << latency.str() << ",\n";
+  json << "  \"cursor_prediction\": [\n";
+  for (float horizonMs : PREDICTION_HORIZONS_MS) {
+    json << "    ";
+    writePredictionReport(json, opts, horizonMs);
+    json << (horizonMs != PREDICTION_HORIZONS_MS[3] ? "," : "") << "\n";
+  }
+  json << "  ],\n";
+  json << "  \"arbiter\": \"" << UserArbiter::name(opts.arbiter) << "\",\n";
+  json << "  \"crowd\": [\n";
+  for (int people = 1; people <= BodyFrame::MAX_BODIES; ++people) {
+    json << "    ";
+    writeCrowdReport(json, opts, people);
+    json << (people < BodyFrame::MAX_BODIES ? "," : "") << "\n";
+  }
+  json << "  ],\n";
+  json << "  \"sensor\": {\"frames_received\": " << sensorReceived
+       << ", \"frames_dropped\": " << sensorDropped
+       << ", \"gestures_dropped\": " << gesturesDropped
+       << ", \"handoffs\": " << handoffs
+       << ", \"thread_cpu_ms\": " << sensorCpuMs
+       << ", \"thread_cpu_percent\": "
+       << (gestureMs > 0.0 ? 100.0 * sensorCpuMs / gestureMs : 0.0) << "},\n";
+  json << "  \"frames_rendered\": " << framesRendered << ",\n";
+  json << "  \"frames_skipped\": " << framesSkipped << ",\n";
+  json << "  \"texture_evictions\": " << evictions << ",\n";
+  json << "  \"texture_uploads\": " << uploads.str() << ",\n";
+  json << "  \"prefetch_hits\": " << prefetchHits << ",\n";
+  json << "  \"prefetch_misses\": " << prefetchMisses << ",\n";
+  json << "  \"peak_texture_bytes\": " << bench.peakTextureBytes << ",\n";
+  json << "  \"peak_tier_bytes\": {\"full\": " << bench.peakTierBytes[0]
+       << ", \"compact\": " << bench.peakTierBytes[1] << "},\n";
+  json << "  \"peak_rss_bytes\": " << peakRssBytes() << "\n";
+  json << "}\n";
+
+  std::cout << "Benchmark results written to " << opts.out << "\n";
+  return opened ? 0 : 2;
+}
@@ -0,0 +1,100 @@
+#ifndef epic_bodysource_h__
+#define epic_bodysource_h__
+
+#include <SDL.h>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief The skeletons seen in one sensor frame.
+////////////////////////////////////////////////////////////////////////////
+struct BodyFrame {
+  /// \brief Skeleton joints, in the order of the Kinect v2 JointType,
+  ///        nested to keep clear of the Kinect SDK names.
+  enum class JointType : int {
+    SpineBase = 0,
+    SpineMid,
+    Neck,
+    Head,
+    ShoulderLeft,
+    ElbowLeft,
+    WristLeft,
+    HandLeft,
+    ShoulderRight,
+    ElbowRight,
+    WristRight,
+    HandRight,
+    HipLeft,
+    KneeLeft,
+    AnkleLeft,
+    FootLeft,
+    HipRight,
+    KneeRight,
+    AnkleRight,
+    FootRight,
+    SpineShoulder,
+    HandTipLeft,
+    ThumbLeft,
+    HandTipRight,
+    ThumbRight,
+    Count
+  };
+
+  /// \brief What a hand is doing, in the order of the Kinect v2 HandState.
+  enum class HandState : int { Unknown = 0, NotTracked, Open, Closed, Lasso };
+
+  static const int MAX_BODIES = 6;
+  static const int JOINT_COUNT = static_cast<int>(JointType::Count);
+
+  struct Body {
+    bool tracked;
+    Uint64 trackingId;
+    float joints[JOINT_COUNT][3]; ///< Camera space x, y, z in meters.
+    HandState leftHand;
+    HandState rightHand;
+
+    const float *joint(JointType type) const {
+      return joints[static_cast<int>(type)];
+    }
+  };
+
+  Uint32 ms; ///< Sensor time of the frame, only differences are meaningful.
+  /// SDL_GetPerformanceCounter() when the frame was captured, as well as
+  /// the source can tell, for LatencyTracer.
+  Uint64 captured;
+  Body bodies[MAX_BODIES];
+};
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Where skeletons come from: a sensor, or a recorded or generated
+///        stream for running the gesture path without one.
+///
+/// A source is opened and read on the sensor thread only, see
+/// GestureTracker. The thread sleeps in wait() between frames rather than
+/// polling acquire().
+////////////////////////////////////////////////////////////////////////////
+class BodySource {
+public:
+  virtual ~BodySource() {}
+
+  /// \brief Connect to the device or load the stream.
+  /// \return false if there is nothing to read from.
+  virtual bool open() = 0;
+
+  /// \brief Block until the next frame arrives or \c timeoutMs passed.
+  /// \return true if acquire() should find a frame, false on a timeout, at
+  ///         the end of the stream or after interrupt().
+  virtual bool wait(Uint32 timeoutMs) = 0;
+
+  /// \brief Make a wait() in progress, or the next one, return false
+  ///        early. The only call that may come from another thread.
+  virtual void interrupt() {}
+
+  /// \brief Fetch the next frame if one arrived since the last call, does
+  ///        not wait for it.
+  /// \return false if there is no new frame.
+  virtual bool acquire(BodyFrame *frame) = 0;
+
+  /// \brief True once a stream has no more frames; a sensor never finishes.
+  virtual bool finished() const { return false; }
+};
+
+#endif // ! epic_bodysource_h__
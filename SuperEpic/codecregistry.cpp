@@ -0,0 +1,126 @@
+#include "codecregistry.h"
+#include "jpegdecoder.h"
+#include "pixelkernels.h"
+#include "pngdecoder.h"
+#include "webpdecoder.h"
+#include "yuvimage.h"
+
+#include <SDL_image.h>
+
+namespace {
+/// \brief Read all of \c path.
+bool readFile(const std::string &path, std::vector<Uint8> *data) {
+  SDL_RWops *file{SDL_RWFromFile(path.c_str(), "rb")};
+  if (file == nullptr)
+    return false;
+
+  const Sint64 size{SDL_RWsize(file)};
+  bool ok{size >= 0};
+  if (ok) {
+    data->resize(static_cast<size_t>(size));
+    ok = SDL_RWread(file, data->data(), 1, data->size()) == data->size();
+  }
+  SDL_RWclose(file);
+  return ok;
+}
+
+/// \brief Extension of \c path, which IMG_LoadTyped_RW() needs for the
+///        formats it cannot tell by their contents, like TGA.
+std::string extension(const std::string &path) {
+  const size_t dot{path.find_last_of('.')};
+  return dot == std::string::npos ? "" : path.substr(dot + 1);
+}
+
+/// \brief IMG_Load from memory, converted to ARGB8888.
+SDL_Surface *imgLoad(const std::vector<Uint8> &data, const std::string &type) {
+  SDL_Surface *decoded{IMG_LoadTyped_RW(
+      SDL_RWFromConstMem(data.data(), static_cast<int>(data.size())), 1,
+      type.c_str())};
+  if (decoded == nullptr)
+    return nullptr;
+
+  // RGB24, what SDL_image decodes JPEGs to, is expanded by PixelKernels
+  // instead of SDL's blitter.
+  SDL_Surface *argb{nullptr};
+  if (decoded->format->format == SDL_PIXELFORMAT_RGB24 &&
+      !SDL_MUSTLOCK(decoded)) {
+    argb = SDL_CreateRGBSurface(0, decoded->w, decoded->h, 32, 0x00ff0000,
+                                0x0000ff00, 0x000000ff, 0xff000000);
+    if (argb != nullptr) {
+      const PixelKernels &kernels{PixelKernels::best()};
+      for (int y = 0; y < decoded->h; ++y) {
+        kernels.rgb24ToArgb(
+            static_cast<const Uint8 *>(decoded->pixels) + y * decoded->pitch,
+            reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(argb->pixels) +
+                                       y * argb->pitch),
+            decoded->w);
+      }
+    }
+  } else {
+    argb = SDL_ConvertSurfaceFormat(decoded, SDL_PIXELFORMAT_ARGB8888, 0);
+  }
+  SDL_FreeSurface(decoded);
+  return argb;
+}
+} // namespace
+
+const char *const CodecRegistry::FALLBACK_NAME{"img_load"};
+
+////////////////////////////////////////////////////////////////////////////
+CodecRegistry::CodecRegistry() {
+#ifdef EPIC_LIBJPEG
+  add({"libjpeg", isJPEG, decodeJPEG, decodeJPEGYUV});
+#endif
+#ifdef EPIC_LIBPNG
+  add({"libpng", isPNG, decodePNG, nullptr});
+#endif
+#ifdef EPIC_LIBWEBP
+  add({"libwebp", isWebP, decodeWebP, nullptr});
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////
+void CodecRegistry::add(const Codec &codec) { m_codecs.push_back(codec); }
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *CodecRegistry::load(const std::string &path,
+                                 const SDL_Point &box, SDL_Point *fullDims,
+                                 const char **codec, YUVImage **yuv) const {
+  if (yuv != nullptr)
+    *yuv = nullptr;
+  std::vector<Uint8> data;
+  if (!readFile(path, &data))
+    return nullptr;
+
+  for (const Codec &c : m_codecs) {
+    if (!c.sniff(data.data(), data.size()))
+      continue;
+
+    if (yuv != nullptr && c.decodeYUV != nullptr &&
+        (box.x <= 0 || box.y <= 0)) {
+      *yuv = c.decodeYUV(data.data(), data.size(), fullDims);
+      if (*yuv != nullptr) {
+        if (codec != nullptr)
+          *codec = c.name;
+        return nullptr;
+      }
+    }
+
+    SDL_Surface *surface{c.decode(data.data(), data.size(), box, fullDims)};
+    if (surface != nullptr) {
+      if (codec != nullptr)
+        *codec = c.name;
+      return surface;
+    }
+    // SDL_image may still make something of a damaged file.
+    break;
+  }
+
+  SDL_Surface *surface{imgLoad(data, extension(path))};
+  if (surface != nullptr) {
+    *fullDims = {surface->w, surface->h};
+    if (codec != nullptr)
+      *codec = FALLBACK_NAME;
+  }
+  return surface;
+}
@@ -0,0 +1,72 @@
+#ifndef epic_codecregistry_h__
+#define epic_codecregistry_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct YUVImage;
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Picks the decoder of an image file by its first bytes.
+///
+/// The file is read into memory once and handed to the first Codec whose
+/// sniff() recognizes it. Codecs decode straight into an ARGB8888 surface,
+/// the format the textures are made in, or on request into a YUVImage.
+/// Files no codec takes, or that one fails on, are decoded from the same
+/// memory by IMG_Load and converted.
+///
+/// The built-in codecs are compiled in with EPIC_LIBJPEG (libjpeg or
+/// libjpeg-turbo), EPIC_LIBPNG (libpng) and EPIC_LIBWEBP (libwebp). Any
+/// number of threads may load() at once, but not while a codec is add()ed.
+////////////////////////////////////////////////////////////////////////////
+class CodecRegistry {
+public:
+  struct Codec {
+    const char *name;
+    /// True if the file \c data of \c size bytes is for this codec,
+    /// usually by its magic bytes.
+    bool (*sniff)(const Uint8 *data, size_t size);
+    /// Decode the whole file \c data. The codec may decode at a smaller
+    /// size as long as the image fit into \c box is covered; an empty box
+    /// asks for full resolution. Sets \c fullDims to the dimensions of the
+    /// full resolution image. nullptr if decoding failed.
+    SDL_Surface *(*decode)(const Uint8 *data, size_t size,
+                           const SDL_Point &box, SDL_Point *fullDims);
+    /// Decode the whole file \c data at full resolution into planar YUV
+    /// without converting to RGB, nullptr if the file, or the codec, cannot
+    /// do that. The codec may leave this nullptr.
+    YUVImage *(*decodeYUV)(const Uint8 *data, size_t size,
+                           SDL_Point *fullDims);
+  };
+
+  /// Name load() reports for files decoded by IMG_Load.
+  static const char *const FALLBACK_NAME;
+
+  /// \brief A registry with the codecs that were compiled in.
+  CodecRegistry();
+
+  /// \brief Add \c codec, it is asked after the ones added before.
+  void add(const Codec &codec);
+
+  /// \brief Decode \c path into an ARGB8888 surface, see Codec::decode().
+  /// \param codec If not nullptr, set to the name of the codec that decoded
+  ///        the file.
+  /// \param yuv If not nullptr, and \c box is empty, the codec is asked for
+  ///        planar YUV first, see Codec::decodeYUV(). If it delivers,
+  ///        \c yuv is set and nullptr is returned, otherwise \c yuv is set
+  ///        to nullptr and the surface is decoded as usual.
+  /// \return nullptr on failure, the reason is in SDL_GetError().
+  SDL_Surface *load(const std::string &path, const SDL_Point &box,
+                    SDL_Point *fullDims, const char **codec = nullptr,
+                    YUVImage **yuv = nullptr) const;
+
+  const std::vector<Codec> &codecs() const { return m_codecs; }
+
+private:
+  std::vector<Codec> m_codecs;
+};
+
+#endif // ! epic_codecregistry_h__
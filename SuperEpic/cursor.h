@@ -34,6 +34,9 @@ public:
 
   void update(float dt);
 
+  /// \brief True while the ring is spinning, i.e. every frame looks different.
+  bool isAnimating() const { return m_animate; }
+
   /// \brief Set the time in seconds for the ring to complete one rotation.
   void setRingTime(float seconds);
 
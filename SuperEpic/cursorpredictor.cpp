@@ -0,0 +1,129 @@
+#include "cursorpredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int CursorPredictor::MAX_WINDOW;
+const Uint32 CursorPredictor::RESET_GAP_MS;
+
+////////////////////////////////////////////////////////////////////////////
+CursorPredictor::Params::Params()
+    : horizonMs{50.0f}, adaptive{true}, maxHorizonMs{100.0f},
+      maxLeadM{0.1f}, order{2}, window{6} {}
+
+////////////////////////////////////////////////////////////////////////////
+CursorPredictor::CursorPredictor(const Params &params) : m_params(params) {
+  m_params.window = std::min(std::max(m_params.window, 3), MAX_WINDOW);
+  m_params.order = std::min(std::max(m_params.order, 1), 2);
+  reset();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void CursorPredictor::reset() {
+  m_next = 0;
+  m_count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void CursorPredictor::update(const float *hand, Uint32 ms) {
+  if (m_count > 0) {
+    const Uint32 last = m_ms[(m_next + MAX_WINDOW - 1) % MAX_WINDOW];
+    // A sample seen before, e.g. latched early by the renderer.
+    if (ms <= last && last - ms <= RESET_GAP_MS)
+      return;
+    if (ms < last || ms - last > RESET_GAP_MS)
+      reset();
+  }
+
+  m_hands[m_next][0] = hand[0];
+  m_hands[m_next][1] = hand[1];
+  m_hands[m_next][2] = hand[2];
+  m_ms[m_next] = ms;
+  m_next = (m_next + 1) % MAX_WINDOW;
+  m_count = std::min(m_count + 1, m_params.window);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void CursorPredictor::predict(float aheadMs, float *out) const {
+  const int lastSlot = (m_next + MAX_WINDOW - 1) % MAX_WINDOW;
+  const float *last = m_hands[lastSlot];
+  if (m_count == 0) {
+    out[0] = out[1] = out[2] = 0.0f;
+    return;
+  }
+  out[0] = last[0];
+  out[1] = last[1];
+  out[2] = last[2];
+  if (m_count < 2)
+    return;
+
+  const double h =
+      std::min(std::max(aheadMs, 0.0f), m_params.maxHorizonMs) * 1e-3;
+  const int order = m_count < 3 ? 1 : m_params.order;
+
+  // Sums of t^k and x t^k over the window, t in seconds relative to the
+  // last position so that the fit is evaluated near t = 0.
+  double s[5]{0.0, 0.0, 0.0, 0.0, 0.0};
+  double sx[3][3]{};
+  for (int i = 0; i < m_count; ++i) {
+    const int slot = (lastSlot + MAX_WINDOW - i) % MAX_WINDOW;
+    const double t = -static_cast<double>(m_ms[lastSlot] - m_ms[slot]) * 1e-3;
+    double tk = 1.0;
+    for (int k = 0; k < 5; ++k) {
+      if (k < 3) {
+        for (int c = 0; c < 3; ++c) {
+          sx[c][k] += m_hands[slot][c] * tk;
+        }
+      }
+      s[k] += tk;
+      tk *= t;
+    }
+  }
+
+  for (int c = 0; c < 3; ++c) {
+    double a, b, q = 0.0;
+    if (order == 2) {
+      // Normal equations of x = a + b t + q t^2, by Cramer's rule.
+      const double det = s[0] * (s[2] * s[4] - s[3] * s[3]) -
+                         s[1] * (s[1] * s[4] - s[3] * s[2]) +
+                         s[2] * (s[1] * s[3] - s[2] * s[2]);
+      if (std::abs(det) < 1e-12) {
+        out[c] = last[c];
+        continue;
+      }
+      a = (sx[c][0] * (s[2] * s[4] - s[3] * s[3]) -
+           s[1] * (sx[c][1] * s[4] - s[3] * sx[c][2]) +
+           s[2] * (sx[c][1] * s[3] - s[2] * sx[c][2])) /
+          det;
+      b = (s[0] * (sx[c][1] * s[4] - s[3] * sx[c][2]) -
+           sx[c][0] * (s[1] * s[4] - s[3] * s[2]) +
+           s[2] * (s[1] * sx[c][2] - sx[c][1] * s[2])) /
+          det;
+      q = (s[0] * (s[2] * sx[c][2] - sx[c][1] * s[3]) -
+           s[1] * (s[1] * sx[c][2] - sx[c][1] * s[2]) +
+           sx[c][0] * (s[1] * s[3] - s[2] * s[2])) /
+          det;
+    } else {
+      // x = a + b t.
+      const double det = s[0] * s[2] - s[1] * s[1];
+      if (std::abs(det) < 1e-12) {
+        out[c] = last[c];
+        continue;
+      }
+      a = (sx[c][0] * s[2] - s[1] * sx[c][1]) / det;
+      b = (s[0] * sx[c][1] - s[1] * sx[c][0]) / det;
+    }
+    out[c] = static_cast<float>(a + b * h + q * h * h);
+  }
+
+  // Clamp the lead over the last measured position.
+  const float dx = out[0] - last[0], dy = out[1] - last[1],
+              dz = out[2] - last[2];
+  const float lead = std::sqrt(dx * dx + dy * dy + dz * dz);
+  if (lead > m_params.maxLeadM) {
+    const float scale = m_params.maxLeadM / lead;
+    out[0] = last[0] + dx * scale;
+    out[1] = last[1] + dy * scale;
+    out[2] = last[2] + dz * scale;
+  }
+}
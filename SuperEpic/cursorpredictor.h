@@ -0,0 +1,63 @@
+#ifndef epic_cursorpredictor_h__
+#define epic_cursorpredictor_h__
+
+#include <SDL.h>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Extrapolates the hand to where it will be when the frame that
+///        draws it is on screen, to hide the latency of the sensor and the
+///        joint filter.
+///
+/// Velocity and acceleration come from a least squares fit of a quadratic
+/// (or a line) to the last \c window hand positions, each coordinate on its
+/// own. The horizon and the distance the prediction may lead the last
+/// measured position are clamped, so that a sudden stop overshoots by a
+/// bounded amount. History is dropped after a gap of RESET_GAP_MS.
+////////////////////////////////////////////////////////////////////////////
+class CursorPredictor {
+public:
+  /// Longest fit window.
+  static const int MAX_WINDOW = 16;
+  /// A pause between samples longer than this starts over, milliseconds.
+  static const Uint32 RESET_GAP_MS = 200;
+
+  struct Params {
+    float horizonMs;    ///< How far ahead to predict when the latency is
+                        /// not measured, e.g. for a replayed log.
+    bool adaptive;      ///< Predict to the measured presentation time
+                        /// when it is known.
+    float maxHorizonMs; ///< Never predict further ahead than this.
+    float maxLeadM;     ///< Never lead the last position by more, meters.
+    int order;          ///< 1 extrapolates velocity, 2 acceleration too.
+    int window;         ///< Positions in the fit, 3 to MAX_WINDOW.
+
+    /// \brief Adaptive, at most 100 ms and 10 cm ahead, quadratic over six
+    ///        positions.
+    Params();
+  };
+
+  explicit CursorPredictor(const Params &params = Params{});
+
+  /// \brief Add the hand position \c hand seen at sensor time \c ms.
+  ///        Positions not newer than the last one are skipped.
+  void update(const float *hand, Uint32 ms);
+
+  /// \brief Where the hand will be \c aheadMs after the last update().
+  /// \param out Set to the last position if there is no history yet.
+  void predict(float aheadMs, float *out) const;
+
+  /// \brief Forget the history.
+  void reset();
+
+  const Params &params() const { return m_params; }
+
+private:
+  Params m_params;
+
+  float m_hands[MAX_WINDOW][3]; ///< Ring of the last positions.
+  Uint32 m_ms[MAX_WINDOW];
+  int m_next;  ///< Ring slot the next position goes to.
+  int m_count; ///< Positions in the ring.
+};
+
+#endif // ! epic_cursorpredictor_h__
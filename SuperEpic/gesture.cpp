@@ -0,0 +1,32 @@
+#include "gesture.h"
+
+#include <algorithm>
+
+namespace {
+const double VIRTUAL_RECTANGLE_CORNER_L_X{0.05};
+const double VIRTUAL_RECTANGLE_CORNER_L_Y{0.75};
+
+const double VIRTUAL_RECTANGLE_CORNER_R_X{0.35};
+const double VIRTUAL_RECTANGLE_CORNER_R_Y{0.25};
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Point mapHandToCursor(const float *handPosition, int screenWidth,
+                          int screenHeight) {
+  SDL_Point cursor;
+
+  float x = handPosition[0] - VIRTUAL_RECTANGLE_CORNER_L_X;
+  cursor.x = static_cast<int>(
+      (x * screenWidth) /
+      (VIRTUAL_RECTANGLE_CORNER_R_X - VIRTUAL_RECTANGLE_CORNER_L_X));
+  cursor.x = std::min(std::max(cursor.x, 0), screenWidth);
+
+  // Scaled by the width as well, the virtual rectangle is not as tall.
+  float y = handPosition[1] - VIRTUAL_RECTANGLE_CORNER_L_Y;
+  cursor.y = static_cast<int>(
+      (y * screenWidth) /
+      (VIRTUAL_RECTANGLE_CORNER_R_Y - VIRTUAL_RECTANGLE_CORNER_L_Y));
+  cursor.y = std::min(std::max(cursor.y, 0), screenHeight);
+
+  return cursor;
+}
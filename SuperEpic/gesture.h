@@ -0,0 +1,43 @@
+#ifndef epic_gesture_h__
+#define epic_gesture_h__
+
+#include <SDL.h>
+
+/// \brief Hand gestures GestureRecognizer tells apart.
+enum class GestureType : Uint8 {
+  None = 0,
+  Select = 1,
+  Panning = 2,
+  ZoomIn = 4,
+  ZoomOut = 5,
+  SelectionProgress = 6
+};
+
+/// \brief What is on screen, some gestures mean different things in the
+///        gallery and the image view.
+enum class GestureView { Gallery, Image, Transition };
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Snapshot of the sensor state the renderer reacts to.
+///
+/// Filled by the sensor thread, or read back from an input log, so that the
+/// gesture handling in Renderer does not depend on where the data came from.
+////////////////////////////////////////////////////////////////////////////
+struct GestureSample {
+  GestureType type;
+  GestureType previous;  ///< Type of the sample before; if it differs from
+                         /// \c type, \c previous was exited and \c type
+                         /// entered at \c ms.
+  Uint32 ms;             ///< Sensor time, see BodyFrame::ms.
+  float hand[3];         ///< Right hand relative to the spine base, meters.
+  float panningDeltaX;   ///< Hand movement since the hand closed, meters.
+  float panningDeltaY;
+  float secondsSincePan; ///< Since the last panning movement started.
+};
+
+/// \brief Map a hand position to window coordinates, the hand moves in a
+///        virtual rectangle in front of the user's right shoulder.
+SDL_Point mapHandToCursor(const float *handPosition, int screenWidth,
+                          int screenHeight);
+
+#endif // ! epic_gesture_h__
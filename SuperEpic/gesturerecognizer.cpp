@@ -0,0 +1,168 @@
+#include "gesturerecognizer.h"
+
+#include <cmath>
+
+namespace {
+using Input = GestureRecognizer::Input;
+using State = GestureRecognizer::State;
+
+/// \brief A row of the transition table: in any of the states \c from, the
+///        input \c input leads to \c to once the current state has lasted
+///        \c dwellMs.
+struct Transition {
+  Uint8 from; ///< Mask of stateBit()s.
+  Input input;
+  State to;
+  Uint32 dwellMs;
+};
+
+constexpr Uint8 stateBit(State state) {
+  return static_cast<Uint8>(1 << static_cast<int>(state));
+}
+
+const Uint8 ANY_STATE{0xff};
+
+/// Tried in order for every frame, the first row that matches the state and
+/// the input and whose dwell time has passed is taken. If none does the
+/// state stays.
+const Transition TRANSITIONS[]{
+    {ANY_STATE, Input::Open, State::Idle, 0},
+    {ANY_STATE, Input::BothClosed, State::Zooming, 0},
+    {stateBit(State::Idle) | stateBit(State::Panning) |
+         stateBit(State::Zooming),
+     Input::Closed, State::Pressed, 0},
+    {stateBit(State::Pressed), Input::Closed, State::Selected,
+     GestureRecognizer::SELECT_DWELL_MS},
+    {ANY_STATE, Input::Moved, State::Panning, 0},
+};
+} // namespace
+
+const float GestureRecognizer::PAN_START_DISTANCE{0.1f};
+const float GestureRecognizer::PAN_STOP_DISTANCE{0.07f};
+const Uint32 GestureRecognizer::SELECT_DWELL_MS;
+const Uint32 GestureRecognizer::HAND_LOST_MS;
+
+////////////////////////////////////////////////////////////////////////////
+GestureRecognizer::GestureRecognizer()
+    : m_handCoords{0.0f, 0.0f, 0.0f}, m_state{State::Idle}, m_enteredMs{0},
+      m_timer{0}, m_rightClosedMs{0}, m_leftClosedMs{0},
+      m_rightHandClosed{false}, m_leftHandClosed{false}, m_handPosX{0.0f},
+      m_handPosY{0.0f}, m_handDistance{0.0f}, m_panningDeltaX{0.0f},
+      m_panningDeltaY{0.0f}, m_zoomDelta{0.0f}, m_type{GestureType::None},
+      m_transitions{0} {}
+
+////////////////////////////////////////////////////////////////////////////
+float GestureRecognizer::handsDistance(const BodyFrame::Body &body) {
+  const float *rhj = body.joint(BodyFrame::JointType::HandRight);
+  const float *lhj = body.joint(BodyFrame::JointType::HandLeft);
+  return std::sqrt((rhj[0] - lhj[0]) * (rhj[0] - lhj[0]) +
+                   (rhj[1] - lhj[1]) * (rhj[1] - lhj[1]));
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool GestureRecognizer::isClosed(BodyFrame::HandState hand, Uint32 ms,
+                                 bool *closed, Uint32 *closedMs) {
+  if (hand == BodyFrame::HandState::Closed) {
+    *closed = true;
+    *closedMs = ms;
+  } else {
+    const bool lost = hand == BodyFrame::HandState::Unknown ||
+                      hand == BodyFrame::HandState::NotTracked;
+    *closed = *closed && lost && ms - *closedMs < HAND_LOST_MS;
+  }
+  return *closed;
+}
+
+////////////////////////////////////////////////////////////////////////////
+GestureRecognizer::Input
+GestureRecognizer::classify(const BodyFrame::Body &body, Uint32 ms,
+                            GestureView view) {
+  const bool wasClosed = m_rightHandClosed;
+  isClosed(body.leftHand, ms, &m_leftHandClosed, &m_leftClosedMs);
+  if (!isClosed(body.rightHand, ms, &m_rightHandClosed, &m_rightClosedMs))
+    return Input::Open;
+
+  if (!wasClosed) {
+    // Pans are measured from where the hand closed.
+    m_timer = ms;
+    m_handPosX = m_handCoords[0];
+    m_handPosY = m_handCoords[1];
+  }
+  m_panningDeltaX = m_handPosX - m_handCoords[0];
+  m_panningDeltaY = m_handPosY - m_handCoords[1];
+
+  if (m_leftHandClosed)
+    return Input::BothClosed;
+  if (view != GestureView::Gallery)
+    return Input::Moved;
+
+  const float threshold =
+      m_state == State::Panning ? PAN_STOP_DISTANCE : PAN_START_DISTANCE;
+  return std::abs(m_panningDeltaX) > threshold ? Input::Moved
+                                               : Input::Closed;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void GestureRecognizer::enter(State state, Uint32 ms) {
+  m_state = state;
+  m_enteredMs = ms;
+  ++m_transitions;
+}
+
+////////////////////////////////////////////////////////////////////////////
+GestureType GestureRecognizer::gestureType() const {
+  switch (m_state) {
+  case State::Pressed:
+    return GestureType::SelectionProgress;
+  case State::Selected:
+    return GestureType::Select;
+  case State::Panning:
+    return GestureType::Panning;
+  case State::Zooming:
+    return m_zoomDelta < 0 ? GestureType::ZoomOut : GestureType::ZoomIn;
+  default:
+    return GestureType::None;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+GestureSample GestureRecognizer::update(const BodyFrame::Body &body,
+                                        Uint32 ms, GestureView view) {
+  const float *hand = body.joint(BodyFrame::JointType::HandRight);
+  const float *spine = body.joint(BodyFrame::JointType::SpineBase);
+  for (int c = 0; c < 3; ++c) {
+    m_handCoords[c] = hand[c] - spine[c];
+  }
+
+  const Input input = classify(body, ms, view);
+  for (const Transition &transition : TRANSITIONS) {
+    if ((transition.from & stateBit(m_state)) == 0 ||
+        transition.input != input || ms - m_enteredMs < transition.dwellMs)
+      continue;
+
+    if (transition.to != m_state)
+      enter(transition.to, ms);
+    break;
+  }
+
+  if (m_state == State::Panning) {
+    m_timer = ms;
+  } else if (m_state == State::Zooming) {
+    const float d = handsDistance(body);
+    m_zoomDelta = d - m_handDistance;
+    m_handDistance = d;
+  }
+
+  GestureSample s;
+  s.previous = m_type;
+  m_type = gestureType();
+  s.type = m_type;
+  s.ms = ms;
+  s.hand[0] = m_handCoords[0];
+  s.hand[1] = m_handCoords[1];
+  s.hand[2] = m_handCoords[2];
+  s.panningDeltaX = m_panningDeltaX;
+  s.panningDeltaY = m_panningDeltaY;
+  s.secondsSincePan = (ms - m_timer) * 1e-3f;
+  return s;
+}
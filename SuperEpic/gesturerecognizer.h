@@ -0,0 +1,99 @@
+#ifndef epic_gesturerecognizer_h__
+#define epic_gesturerecognizer_h__
+
+#include "bodysource.h"
+#include "gesture.h"
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Turns the skeleton of the user into gestures.
+///
+/// The right hand moves the cursor while open. Closing it pans, or in the
+/// gallery selects the image under the cursor if it is held still; closing
+/// both hands zooms. Only looks at the BodyFrame, so it runs the same on
+/// live and simulated skeletons. The joints are expected to be smoothed
+/// already, see JointFilter.
+///
+/// Each frame is reduced to an Input, which drives a State machine through
+/// the transition table in gesturerecognizer.cpp. A transition may ask for
+/// the current state to have lasted a dwell time first, and the hands have
+/// hysteresis: a closed hand the sensor briefly loses track of stays closed,
+/// and a pan ends closer to where the hand closed than it started.
+////////////////////////////////////////////////////////////////////////////
+class GestureRecognizer {
+public:
+  /// \brief What the hands do in one frame.
+  enum class Input : Uint8 {
+    Open,      ///< Right hand open.
+    Closed,    ///< Right hand closed and held near where it closed.
+    Moved,     ///< Right hand closed and moved, or closed outside the
+               /// gallery.
+    BothClosed ///< Both hands closed.
+  };
+
+  /// \brief The gesture in progress.
+  enum class State : Uint8 {
+    Idle,     ///< Hand open, moves the cursor.
+    Pressed,  ///< Hand closed, selects once held long enough.
+    Selected, ///< Hand closed and held still, the image is selected.
+    Panning,  ///< Hand closed and moving.
+    Zooming   ///< Both hands closed.
+  };
+
+  /// Right hand movement from where it closed that starts a pan, meters.
+  static const float PAN_START_DISTANCE;
+  /// Right hand movement below which a pan ends again, meters.
+  static const float PAN_STOP_DISTANCE;
+  /// A closed hand held still this long selects, milliseconds.
+  static const Uint32 SELECT_DWELL_MS = 1000;
+  /// A closed hand reported as unknown or not tracked for less than this
+  /// is still closed, milliseconds.
+  static const Uint32 HAND_LOST_MS = 150;
+
+  GestureRecognizer();
+
+  /// \brief Update the gesture with \c body, seen at sensor time \c ms.
+  /// \param view What the renderer shows.
+  /// \return The gesture after the update, with \c previous set to the
+  ///         gesture before it.
+  GestureSample update(const BodyFrame::Body &body, Uint32 ms,
+                       GestureView view);
+
+  /// \brief The gesture in progress.
+  State state() const { return m_state; }
+
+  /// \brief Number of state changes so far.
+  size_t transitions() const { return m_transitions; }
+
+private:
+  static float handsDistance(const BodyFrame::Body &body);
+
+  /// \brief Update \c closed with \c hand. A closed hand stays closed
+  ///        while the sensor loses track of it for less than HAND_LOST_MS.
+  /// \param closedMs Sensor time the hand was last seen closed.
+  /// \return The new \c closed.
+  static bool isClosed(BodyFrame::HandState hand, Uint32 ms, bool *closed,
+                       Uint32 *closedMs);
+
+  Input classify(const BodyFrame::Body &body, Uint32 ms, GestureView view);
+  void enter(State state, Uint32 ms);
+  GestureType gestureType() const;
+
+  float m_handCoords[3]; ///< Right hand relative to the spine base.
+  State m_state;
+  Uint32 m_enteredMs; ///< Sensor time m_state was entered.
+  Uint32 m_timer;     ///< Sensor time the right hand closed or last panned.
+  Uint32 m_rightClosedMs; ///< Sensor time the right hand was last closed.
+  Uint32 m_leftClosedMs;
+  bool m_rightHandClosed;
+  bool m_leftHandClosed;
+  float m_handPosX; ///< Where the right hand closed.
+  float m_handPosY;
+  float m_handDistance;
+  float m_panningDeltaX;
+  float m_panningDeltaY;
+  float m_zoomDelta;
+  GestureType m_type; ///< Reported for the last frame.
+  size_t m_transitions;
+};
+
+#endif // ! epic_gesturerecognizer_h__
@@ -0,0 +1,217 @@
+#include "gesturetracker.h"
+
+#include "renderer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+/// \brief CPU time used by the calling thread, in microseconds.
+Uint64 threadCpuUs() {
+#ifdef WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    return 0;
+  // FILETIMEs count 100 ns ticks.
+  ULARGE_INTEGER kernelTicks, userTicks;
+  kernelTicks.LowPart = kernel.dwLowDateTime;
+  kernelTicks.HighPart = kernel.dwHighDateTime;
+  userTicks.LowPart = user.dwLowDateTime;
+  userTicks.HighPart = user.dwHighDateTime;
+  return (kernelTicks.QuadPart + userTicks.QuadPart) / 10;
+#else
+  timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+    return 0;
+  return static_cast<Uint64>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+#endif
+}
+} // namespace
+
+const Uint32 GestureTracker::WAIT_TIMEOUT_MS;
+const Uint32 GestureTracker::SENSOR_FRAME_MS;
+
+////////////////////////////////////////////////////////////////////////////
+GestureTracker::GestureTracker(BodySource *source,
+                               const JointFilter::Params &filter,
+                               UserArbiter::Policy arbiter)
+    : m_source{source}, m_filter{filter}, m_recognizers{}, m_trackingIds{},
+      m_arbiter{arbiter}, m_queued{GestureType::None}, m_thread{},
+      m_stop{false},
+      m_finished{false}, m_view{static_cast<int>(GestureView::Gallery)},
+      m_frames{0}, m_framesReceived{0}, m_framesDropped{0},
+      m_queueDropped{0}, m_handoffs{0}, m_cpuUs{0}, m_queue{},
+      m_latestMutex{}, m_latest{}, m_hasLatest{false}, m_polled{0},
+      m_totalDelayMs{0.0}, m_maxDelayMs{0.0} {}
+
+////////////////////////////////////////////////////////////////////////////
+GestureTracker::~GestureTracker() {
+  stop();
+  delete m_source;
+
+  std::cout << "Gestures: " << m_framesReceived << " frames received, "
+            << m_framesDropped << " dropped by the sensor, " << m_frames
+            << " tracked, " << m_handoffs << " handoffs, " << m_queueDropped
+            << " gestures dropped, "
+            << "queue delay " << meanQueueDelayMs() << " ms mean, "
+            << m_maxDelayMs << " ms max, sensor thread " << cpuMs()
+            << " ms CPU\n";
+}
+
+////////////////////////////////////////////////////////////////////////////
+void GestureTracker::start() {
+  if (m_thread.joinable())
+    return;
+
+  m_stop = false;
+  m_thread = std::thread{&GestureTracker::run, this};
+}
+
+////////////////////////////////////////////////////////////////////////////
+void GestureTracker::stop() {
+  m_stop = true;
+  m_source->interrupt();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool GestureTracker::poll(Sample *sample) {
+  if (!m_queue.pop(sample))
+    return false;
+
+  const double delayMs = (SDL_GetPerformanceCounter() - sample->acquired) *
+                         1000.0 / SDL_GetPerformanceFrequency();
+  ++m_polled;
+  m_totalDelayMs += delayMs;
+  m_maxDelayMs = std::max(m_maxDelayMs, delayMs);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool GestureTracker::latest(Sample *sample) const {
+  std::lock_guard<std::mutex> lock(m_latestMutex);
+  if (!m_hasLatest)
+    return false;
+
+  *sample = m_latest;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+double GestureTracker::meanQueueDelayMs() const {
+  return m_polled > 0 ? m_totalDelayMs / m_polled : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void GestureTracker::run() {
+  if (!m_source->open()) {
+    std::cerr << "Could not open the body source, gestures are off.\n";
+    m_finished = true;
+    return;
+  }
+
+  BodyFrame frame;
+  bool first = true;
+  Uint32 previousMs = 0;
+  while (!m_stop) {
+    const bool arrived = m_source->wait(WAIT_TIMEOUT_MS);
+    m_cpuUs = threadCpuUs();
+    if (m_stop)
+      break;
+    if (!arrived || !m_source->acquire(&frame)) {
+      if (m_source->finished())
+        break;
+      continue;
+    }
+    const Uint64 acquired = SDL_GetPerformanceCounter();
+
+    ++m_framesReceived;
+    if (!first)
+      countDropped(previousMs, frame.ms);
+    first = false;
+    previousMs = frame.ms;
+
+    GestureSample gesture;
+    if (!process(&frame, static_cast<GestureView>(m_view.load()), &gesture))
+      continue;
+
+    Sample sample;
+    sample.gesture = gesture;
+    sample.frameMs = frame.ms;
+    sample.captured = frame.captured;
+    sample.acquired = acquired;
+    sample.queued = SDL_GetPerformanceCounter();
+    {
+      std::lock_guard<std::mutex> lock(m_latestMutex);
+      m_latest = sample;
+      m_hasLatest = true;
+    }
+    if (m_queue.push(sample)) {
+      m_queued = gesture.type;
+    } else {
+      ++m_queueDropped;
+    }
+    ++m_frames;
+
+    // Let the render loop know it has something new to look at.
+    Renderer::postSensorUpdate();
+  }
+
+  m_cpuUs = threadCpuUs();
+  m_finished = true;
+  Renderer::postSensorUpdate();
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool GestureTracker::process(BodyFrame *frame, GestureView view,
+                             GestureSample *gesture) {
+  m_filter.apply(frame);
+
+  GestureSample gestures[BodyFrame::MAX_BODIES];
+  for (int i = 0; i < BodyFrame::MAX_BODIES; ++i) {
+    const BodyFrame::Body &body = frame->bodies[i];
+    if (!body.tracked)
+      continue;
+
+    // A new tracking id in the slot is someone else, start over.
+    if (m_trackingIds[i] != body.trackingId) {
+      m_recognizers[i] = GestureRecognizer{};
+      m_trackingIds[i] = body.trackingId;
+    }
+    gestures[i] = m_recognizers[i].update(body, frame->ms, view);
+  }
+
+  const int active = m_arbiter.select(*frame, gestures);
+  m_handoffs = m_arbiter.handoffs();
+  if (active < 0)
+    return false;
+
+  *gesture = gestures[active];
+  // After a handoff this ends the gesture of the previous user.
+  gesture->previous = m_queued;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void GestureTracker::countDropped(Uint32 previousMs, Uint32 ms) {
+  // A stream that loops or a sensor that restarts goes back in time.
+  if (ms <= previousMs)
+    return;
+
+  // Round to whole frame intervals, frame times jitter by a millisecond or
+  // two.
+  const Uint32 intervals =
+      (ms - previousMs + SENSOR_FRAME_MS / 2) / SENSOR_FRAME_MS;
+  if (intervals > 1)
+    m_framesDropped += intervals - 1;
+}
@@ -0,0 +1,152 @@
+#ifndef epic_gesturetracker_h__
+#define epic_gesturetracker_h__
+
+#include "bodysource.h"
+#include "gesture.h"
+#include "gesturerecognizer.h"
+#include "jointfilter.h"
+#include "spscring.h"
+#include "userarbiter.h"
+
+#include <SDL.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Runs a BodySource, a JointFilter and the GestureRecognizer on a
+///        thread of their own and queues the gestures for the render loop.
+///
+/// Gestures travel through a lock-free SpscRing, the sensor thread is the
+/// only producer and the thread calling poll(), the render loop, the only
+/// consumer. Every new gesture wakes the render loop with
+/// Renderer::postSensorUpdate().
+///
+/// Every tracked body has a GestureRecognizer of its own, all of them are
+/// updated each frame after one JointFilter pass over the whole frame. The
+/// UserArbiter decides whose gestures are queued. When control moves to
+/// another user, the first gesture queued for them has the last one queued
+/// as its \c previous, so the renderer sees the old gesture end.
+///
+/// The sensor thread blocks in BodySource::wait() between frames, waking up
+/// every WAIT_TIMEOUT_MS at the latest to see whether it should stop.
+////////////////////////////////////////////////////////////////////////////
+class GestureTracker {
+public:
+  /// \brief A gesture and the sensor frame it came from.
+  struct Sample {
+    GestureSample gesture;
+    Uint32 frameMs;  ///< Sensor time of the frame, see BodyFrame::ms.
+    // SDL_GetPerformanceCounter() stamps for LatencyTracer.
+    Uint64 captured; ///< See BodyFrame::captured.
+    Uint64 acquired; ///< The sensor thread got the frame.
+    Uint64 queued;   ///< The gesture was queued.
+  };
+
+  /// Gestures that can wait for the render loop, two seconds at 30 Hz.
+  static const size_t QUEUE_SIZE = 64;
+
+  /// Longest the sensor thread sleeps before checking for stop().
+  static const Uint32 WAIT_TIMEOUT_MS = 100;
+
+  /// Frame interval of the sensor, for counting the frames it dropped.
+  static const Uint32 SENSOR_FRAME_MS = 33;
+
+  /// \param source Where skeletons come from, owned by the tracker.
+  /// \param filter How the joints are smoothed.
+  /// \param arbiter How the user in control is chosen.
+  explicit GestureTracker(
+      BodySource *source,
+      const JointFilter::Params &filter = JointFilter::Params{},
+      UserArbiter::Policy arbiter = UserArbiter::Policy::Closest);
+  /// \brief Stops the thread.
+  ~GestureTracker();
+
+  /// \brief Start the sensor thread, the source is opened on it.
+  void start();
+  /// \brief Stop the sensor thread and wait for it.
+  void stop();
+
+  /// \brief Tell the recognizer what the renderer shows. Any thread.
+  void view(GestureView view) { m_view = static_cast<int>(view); }
+
+  /// \brief Filter \c frame and update the gestures of all its bodies.
+  ///        Sensor thread only, or any thread if the tracker is not
+  ///        started.
+  /// \param gesture Set to the gesture of the user in control.
+  /// \return false if no body is tracked.
+  bool process(BodyFrame *frame, GestureView view, GestureSample *gesture);
+
+  /// \brief Pop the oldest gesture not handled yet, consumer thread only.
+  /// \return false if the queue is empty.
+  bool poll(Sample *sample);
+
+  /// \brief The newest gesture, queued or not, without taking it off the
+  ///        queue, for drawing the cursor as late as possible. Any thread.
+  /// \return false if there was none yet.
+  bool latest(Sample *sample) const;
+
+  /// \brief True once the source could not be opened or ran out of frames.
+  bool finished() const { return m_finished; }
+
+  /// \brief Sensor frames with a tracked body so far.
+  size_t frames() const { return m_frames; }
+
+  /// \brief Sensor frames acquired so far, tracked body or not.
+  size_t framesReceived() const { return m_framesReceived; }
+
+  /// \brief Sensor frames missed, judged from gaps in the frame times.
+  size_t framesDropped() const { return m_framesDropped; }
+
+  /// \brief Gestures lost because the render loop did not keep up.
+  size_t queueDropped() const { return m_queueDropped; }
+
+  /// \brief Times control moved from one user to another.
+  size_t handoffs() const { return m_handoffs; }
+
+  /// \brief CPU time used by the sensor thread so far, in milliseconds.
+  double cpuMs() const { return m_cpuUs / 1000.0; }
+
+  /// \brief Time from acquiring a frame to poll()ing its gesture, in
+  ///        milliseconds. Consumer thread only.
+  double meanQueueDelayMs() const;
+  double maxQueueDelayMs() const { return m_maxDelayMs; }
+
+private:
+  void run();
+  /// \brief Count the frames missed between \c previousMs and \c ms.
+  void countDropped(Uint32 previousMs, Uint32 ms);
+
+  BodySource *m_source;
+  JointFilter m_filter;           ///< Only used by the sensor thread.
+  // Only used by the sensor thread.
+  GestureRecognizer m_recognizers[BodyFrame::MAX_BODIES];
+  Uint64 m_trackingIds[BodyFrame::MAX_BODIES]; ///< Of each recognizer.
+  UserArbiter m_arbiter;
+  GestureType m_queued; ///< Type of the last gesture queued.
+
+  std::thread m_thread;
+  std::atomic<bool> m_stop;
+  std::atomic<bool> m_finished;
+  std::atomic<int> m_view;
+  std::atomic<size_t> m_frames;
+  std::atomic<size_t> m_framesReceived;
+  std::atomic<size_t> m_framesDropped;
+  std::atomic<size_t> m_queueDropped;
+  std::atomic<size_t> m_handoffs;
+  std::atomic<Uint64> m_cpuUs;
+
+  SpscRing<Sample, QUEUE_SIZE> m_queue;
+
+  mutable std::mutex m_latestMutex;
+  Sample m_latest;
+  bool m_hasLatest;
+
+  // Consumer side statistics.
+  size_t m_polled;
+  double m_totalDelayMs;
+  double m_maxDelayMs;
+};
+
+#endif // ! epic_gesturetracker_h__
@@ -1,50 +1,341 @@
 #include "image.h"
+#include "residency.h"
+#include "textureuploader.h"
+#include "tilepyramid.h"
+#include "yuvimage.h"
 #include <SDL_image.h>
 #include <algorithm>
 #include <cmath>
 #include <iostream>
 
-namespace {}
+namespace {
+/// \brief Upload \c surf through Image::uploader() if there is one.
+SDL_Texture *uploadSurface(SDL_Surface *surf, TextureUploader::Tier tier,
+                           TextureUploader::Tier *made) {
+  if (Image::uploader() != nullptr)
+    return Image::uploader()->upload(surf, tier, made);
+  if (made != nullptr)
+    *made = TextureUploader::Tier::Full;
+  return SDL_CreateTextureFromSurface(Image::sdl_renderer(), surf);
+}
 
-///////////////////////////////////////////////////////////////////////////////
-Image *Image::load(const std::string &file) {
-  SDL_Surface *surf{IMG_Load(file.c_str())};
-  SDL_Texture *tex{SDL_CreateTextureFromSurface(sdl_renderer(), surf)};
+/// \brief Call \c create until it returns a texture, evicting other images
+///        while there is not enough texture memory.
+template <typename Create> SDL_Texture *createEvicting(Create create) {
+  SDL_Texture *tex{create()};
+  // Most likely out of texture memory, make room and try again.
+  while (tex == nullptr && Image::residency() != nullptr &&
+         Image::residency()->evictOne()) {
+    tex = create();
+  }
+  return tex;
+}
+
+size_t textureBytes(SDL_Texture *tex) {
   if (tex == nullptr)
+    return 0;
+
+  Uint32 format;
+  int w, h;
+  SDL_QueryTexture(tex, &format, nullptr, &w, &h);
+  // Planar 4:2:0, a full size Y plane and two quarter size chroma planes.
+  if (format == SDL_PIXELFORMAT_IYUV || format == SDL_PIXELFORMAT_YV12)
+    return static_cast<size_t>(w) * h + 2 * ((w + 1) / 2) * ((h + 1) / 2);
+  return static_cast<size_t>(w) * h * SDL_BYTESPERPIXEL(format);
+}
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+SDL_Texture *Image::createTexture(SDL_Surface *surf,
+                                  TextureUploader::Tier tier,
+                                  TextureUploader::Tier *made) {
+  if (surf == nullptr)
     return nullptr;
 
+  SDL_Texture *tex{createEvicting(
+      [surf, tier, made] { return uploadSurface(surf, tier, made); })};
+  SDL_FreeSurface(surf);
+  return tex;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Image *Image::load(const std::string &file) {
   Image *image{new Image()};
+  if (!image->setSurface(IMG_Load(file.c_str()))) {
+    delete image;
+    return nullptr;
+  }
+
+  return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Image::Image()
+    : m_texture{nullptr}, m_pyramid{nullptr}, m_proxies{}, m_proxyDims{},
+      m_proxyTiers{}, m_bbox{0, 0, 0, 0},
+      m_src{0, 0, 0, 0}, m_texDims{0, 0}, m_scaleFactor{0} {}
+
+///////////////////////////////////////////////////////////////////////////////
+Image::~Image() {
+  if (residency() != nullptr)
+    residency()->remove(this);
+
+  if (m_texture != nullptr) {
+    SDL_DestroyTexture(m_texture);
+  }
+
+  delete m_pyramid;
 
-  SDL_QueryTexture(tex, nullptr, nullptr, &image->m_bbox.w, &image->m_bbox.h);
-  image->m_bbox.x = 0;
-  image->m_bbox.y = 0;
-  image->m_texture = tex;
+  for (auto tex : m_proxies) {
+    if (tex != nullptr)
+      SDL_DestroyTexture(tex);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Image::setSurface(SDL_Surface *surf) {
+  SDL_Texture *tex{createTexture(surf)};
+  if (tex == nullptr)
+    return false;
+
+  setTexture(tex);
+  return true;
+}
 
-  image->m_src = image->m_bbox;
-  image->m_texDims.x = image->m_bbox.w;
-  image->m_texDims.y = image->m_bbox.h;
+///////////////////////////////////////////////////////////////////////////////
+bool Image::setYUV(YUVImage *yuv) {
+  if (yuv == nullptr)
+    return false;
+
+  SDL_Texture *tex{nullptr};
+  if (uploader() != nullptr) {
+    tex = createEvicting([yuv] { return uploader()->uploadYUV(*yuv); });
+  }
+  delete yuv;
+  if (tex == nullptr)
+    return false;
+
+  setTexture(tex);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Image::setTexture(SDL_Texture *tex) {
+  if (m_texture != nullptr)
+    SDL_DestroyTexture(m_texture);
+  m_texture = tex;
+
+  SDL_Point dims;
+  SDL_QueryTexture(tex, nullptr, nullptr, &dims.x, &dims.y);
+  setSourceSize(dims);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Image::setSourceSize(const SDL_Point &dims) {
+  // Keep the current view if the image was already on screen as a proxy.
+  if (hasTexDims())
+    return;
+
+  m_bbox = {0, 0, dims.x, dims.y};
+  m_src = m_bbox;
+  m_texDims = dims;
 
   // this is just to init the m_scaleFactor variable to something that is not
   // zero.
-  image->maximize();
+  maximize();
+}
 
-  return image;
+///////////////////////////////////////////////////////////////////////////////
+bool Image::setProxy(Proxy p, SDL_Surface *surf,
+                     TextureUploader::Tier tier) {
+  const int i{static_cast<int>(p)};
+  if (m_proxies[i] != nullptr) {
+    SDL_DestroyTexture(m_proxies[i]);
+    m_proxies[i] = nullptr;
+  }
+
+  m_proxies[i] = createTexture(surf, tier, &m_proxyTiers[i]);
+  if (m_proxies[i] == nullptr)
+    return false;
+
+  SDL_QueryTexture(m_proxies[i], nullptr, nullptr, &m_proxyDims[i].x,
+                   &m_proxyDims[i].y);
+  return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-Image::Image()
-    : m_texture{nullptr}, m_bbox{0, 0, 0, 0}, m_src{0, 0, 0, 0},
-      m_texDims{0, 0}, m_scaleFactor{0} {}
+bool Image::isLoaded() const {
+  return m_proxies[0] != nullptr || isResident();
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-Image::~Image() {
+bool Image::isResident() const {
+  if (m_texture != nullptr || m_pyramid != nullptr)
+    return true;
+
+  for (int i = 1; i < NUM_PROXIES; ++i) {
+    if (m_proxies[i] != nullptr)
+      return true;
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Image::hasFullResolution() const {
+  return m_texture != nullptr || m_pyramid != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Image::setPyramid(TilePyramid *pyramid) {
+  delete m_pyramid;
+  m_pyramid = pyramid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Image::hasTexDims() const { return m_texDims.x > 0 && m_texDims.y > 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+void Image::evict() {
   if (m_texture != nullptr) {
     SDL_DestroyTexture(m_texture);
+    m_texture = nullptr;
   }
+
+  delete m_pyramid;
+  m_pyramid = nullptr;
+
+  // The strip thumbnail is tiny and drawn for every image, so it stays.
+  for (int i = 1; i < NUM_PROXIES; ++i) {
+    if (m_proxies[i] != nullptr) {
+      SDL_DestroyTexture(m_proxies[i]);
+      m_proxies[i] = nullptr;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+size_t Image::getTextureBytes() const {
+  size_t bytes{textureBytes(m_texture)};
+  if (m_pyramid != nullptr)
+    bytes += m_pyramid->getTextureBytes();
+  for (int i = 1; i < NUM_PROXIES; ++i) {
+    bytes += textureBytes(m_proxies[i]);
+  }
+  return bytes;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+size_t Image::getTextureBytes(TextureUploader::Tier tier) const {
+  size_t bytes{0};
+  if (tier == TextureUploader::Tier::Full) {
+    bytes += textureBytes(m_texture);
+    if (m_pyramid != nullptr)
+      bytes += m_pyramid->getTextureBytes();
+  }
+  for (int i = 0; i < NUM_PROXIES; ++i) {
+    if (getProxyTier(static_cast<Proxy>(i)) == tier)
+      bytes += textureBytes(m_proxies[i]);
+  }
+  return bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TextureUploader::Tier Image::getProxyTier(Proxy p) const {
+  const int i{static_cast<int>(p)};
+  return m_proxies[i] != nullptr ? m_proxyTiers[i]
+                                 : TextureUploader::Tier::Full;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+SDL_Texture *Image::textureFor(const SDL_Rect &dest, SDL_Point *dims) const {
+  // The opened image is promoted to its full resolution texture or tiles.
+  const bool skipCompact{m_texture != nullptr || m_pyramid != nullptr};
+  auto usable = [this, skipCompact](int i) {
+    return m_proxies[i] != nullptr &&
+           !(skipCompact && m_proxyTiers[i] == TextureUploader::Tier::Compact);
+  };
+
+  for (int i = 0; i < NUM_PROXIES; ++i) {
+    if (usable(i) && m_proxyDims[i].x >= dest.w &&
+        m_proxyDims[i].y >= dest.h) {
+      *dims = m_proxyDims[i];
+      return m_proxies[i];
+    }
+  }
+
+  if (m_texture != nullptr) {
+    *dims = m_texDims;
+    return m_texture;
+  }
+
+  // No full resolution texture, stretch the largest proxy we have. A
+  // compact one still beats nothing, e.g. under the tiles of the pyramid.
+  for (int i = NUM_PROXIES - 1; i >= 0; --i) {
+    if (usable(i)) {
+      *dims = m_proxyDims[i];
+      return m_proxies[i];
+    }
+  }
+  for (int i = NUM_PROXIES - 1; i >= 0; --i) {
+    if (m_proxies[i] != nullptr) {
+      *dims = m_proxyDims[i];
+      return m_proxies[i];
+    }
+  }
+
+  return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Image::isCompactProxy(const SDL_Texture *tex) const {
+  for (int i = 0; i < NUM_PROXIES; ++i) {
+    if (m_proxies[i] == tex)
+      return m_proxyTiers[i] == TextureUploader::Tier::Compact;
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
 void Image::draw() {
-  SDL_RenderCopy(sdl_renderer(), m_texture, &m_src, &m_bbox);
+  SDL_Point dims;
+  SDL_Texture *tex{textureFor(m_bbox, &dims)};
+
+  // Zoomed in past the proxies, only draw the tiles that are on screen.
+  const bool proxyCovers{tex != nullptr && tex != m_texture &&
+                         dims.x >= m_bbox.w && dims.y >= m_bbox.h &&
+                         !isCompactProxy(tex)};
+  if (m_pyramid != nullptr && !proxyCovers) {
+    SDL_Rect viewport{0, 0, 0, 0};
+    SDL_GetWindowSize(sdl_window(), &viewport.w, &viewport.h);
+    if (tex != nullptr)
+      SDL_RenderCopy(sdl_renderer(), tex, nullptr, &m_bbox); // Under the tiles.
+    m_pyramid->draw(m_bbox, viewport);
+    return;
+  }
+
+  if (tex == nullptr)
+    return;
+
+  // m_src is in full resolution texels, map it onto the chosen texture.
+  SDL_Rect src{m_src};
+  if (dims.x != m_texDims.x || dims.y != m_texDims.y) {
+    const float sx{dims.x / static_cast<float>(m_texDims.x)};
+    const float sy{dims.y / static_cast<float>(m_texDims.y)};
+    src.x = static_cast<int>(m_src.x * sx);
+    src.y = static_cast<int>(m_src.y * sy);
+    src.w = std::max(1, static_cast<int>(m_src.w * sx));
+    src.h = std::max(1, static_cast<int>(m_src.h * sy));
+  }
+
+  SDL_RenderCopy(sdl_renderer(), tex, &src, &m_bbox);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Image::draw(const SDL_Rect &dest) const {
+  SDL_Point dims;
+  SDL_Texture *tex{textureFor(dest, &dims)};
+  if (tex != nullptr)
+    SDL_RenderCopy(sdl_renderer(), tex, nullptr, &dest);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
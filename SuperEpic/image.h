@@ -1,12 +1,29 @@
 #ifndef epic_image_h__
 #define epic_image_h__
 
+#include "textureuploader.h"
+
 #include <SDL.h>
+#include <array>
+#include <cstddef>
 #include <string>
 
+class TextureResidency;
+class TilePyramid;
+struct YUVImage;
+
 class Image {
 
 public:
+  /// \brief Downscaled copies of the image kept next to the full resolution
+  ///        texture, ordered smallest first.
+  enum class Proxy : int {
+    Strip,   ///< Thumbnail strip below the gallery.
+    Gallery, ///< One gallery column.
+    Screen   ///< Fit to the window.
+  };
+  static const int NUM_PROXIES = 3;
+
   // These two functions are such a bad idea (for at least two reasons)
   static SDL_Renderer *sdl_renderer(SDL_Renderer *ren = nullptr) {
     static SDL_Renderer *renderer = ren;
@@ -18,6 +35,31 @@ public:
     return window;
   }
 
+  /// \brief The residency manager asked to free texture memory when texture
+  ///        creation fails.
+  static TextureResidency *residency(TextureResidency *res = nullptr) {
+    static TextureResidency *residency = res;
+    return residency;
+  }
+
+  /// \brief Creates the textures of all images. Without one they come from
+  ///        SDL_CreateTextureFromSurface().
+  static TextureUploader *uploader(TextureUploader *up = nullptr) {
+    static TextureUploader *uploader = up;
+    return uploader;
+  }
+
+  /// \brief Turn \c surf into a texture through uploader(), evicting other
+  ///        images through residency() while there is not enough texture
+  ///        memory. Frees \c surf.
+  /// \param made If not nullptr, set to the tier the texture was made in,
+  ///        see TextureUploader::upload().
+  /// \return nullptr if \c surf is nullptr or nothing could be evicted.
+  static SDL_Texture *createTexture(
+      SDL_Surface *surf,
+      TextureUploader::Tier tier = TextureUploader::Tier::Full,
+      TextureUploader::Tier *made = nullptr);
+
   /// \brief Create an image from the image at imgFilePath.
   /// \return nullptr if failure, otherwise a valid Image.
   static Image *load(const std::string &imgFilePath);
@@ -25,8 +67,80 @@ public:
   Image();
   virtual ~Image();
 
+  /// \brief Create the texture for this image from \c surf.
+  ///
+  /// Takes ownership of \c surf, which is freed once the texture exists.
+  /// Must be called from the thread that created the SDL_Renderer.
+  /// If texture creation fails, other images are evicted through residency()
+  /// until it succeeds or there is nothing left to evict.
+  ///
+  /// \return false if \c surf is nullptr or no texture could be created.
+  bool setSurface(SDL_Surface *surf);
+
+  /// \brief Create an SDL_PIXELFORMAT_IYUV texture for this image from
+  ///        \c yuv, the renderer converts it to RGB when drawing. Same
+  ///        ownership rules as setSurface(), needs an uploader() whose
+  ///        TextureUploader::yuv() is true.
+  bool setYUV(YUVImage *yuv);
+
+  /// \brief Set the dimensions of the full resolution image before its
+  ///        texture exists, e.g. when only proxies have been loaded.
+  ///        Does nothing if the dimensions are already known.
+  void setSourceSize(const SDL_Point &dims);
+
+  /// \brief Create the texture for proxy \c p from \c surf, same ownership
+  ///        rules as setSurface(). The proxy is dropped if \c surf is nullptr.
+  /// \param tier Passed on to TextureUploader::upload().
+  bool setProxy(Proxy p, SDL_Surface *surf,
+                TextureUploader::Tier tier = TextureUploader::Tier::Full);
+
+  /// \brief True if this image has anything to draw, false for placeholders
+  ///        that are still waiting on their decode.
+  bool isLoaded() const;
+
+  /// \brief True if the full resolution texture or one of the proxies larger
+  ///        than the strip thumbnail is present, i.e. there is something
+  ///        evict() would release.
+  bool isResident() const;
+
+  /// \brief True if the full resolution texture or a tile pyramid is present.
+  bool hasFullResolution() const;
+
+  /// \brief Draw the image from \c pyramid instead of a full resolution
+  ///        texture, for images larger than the renderer can handle.
+  ///        Takes ownership of \c pyramid, nullptr drops the current one.
+  void setPyramid(TilePyramid *pyramid);
+  TilePyramid *pyramid() const { return m_pyramid; }
+
+  /// \brief True once the size of the image is known, which stays true after
+  ///        the texture is evicted.
+  bool hasTexDims() const;
+
+  /// \brief Destroy the full resolution texture, the tile pyramid and every
+  ///        proxy except the strip thumbnail, but remember the image
+  ///        dimensions so that layout does not change until the textures
+  ///        are recreated.
+  void evict();
+
+  /// \brief Approximate bytes of texture memory that evict() would release.
+  size_t getTextureBytes() const;
+
+  /// \brief Approximate bytes of all textures of this image in \c tier,
+  ///        the strip thumbnail included. Only proxies can be
+  ///        Tier::Compact.
+  size_t getTextureBytes(TextureUploader::Tier tier) const;
+
+  /// \brief The tier proxy \c p was uploaded in, Tier::Full if there is
+  ///        none.
+  TextureUploader::Tier getProxyTier(Proxy p) const;
+
+  /// \brief Draw the smallest texture that covers the bounds of this image.
   void draw();
 
+  /// \brief Draw the whole image into \c dest, ignoring the bounds and
+  ///        cropping rectangle of this image.
+  void draw(const SDL_Rect &dest) const;
+
   /// \brief Translate the image to given destination.
   /// \param p Where the upper-left corner of this Image should be.
   // void scale(const SDL_Point &p);
@@ -86,7 +200,22 @@ public:
   float getBaseScaleFactor() const;
 
 private:
+  /// \brief Replace the full resolution texture with \c tex.
+  void setTexture(SDL_Texture *tex);
+
+  /// \brief Pick the smallest texture at least as large as \c dest, or the
+  ///        largest one available if none is. Compact proxies are passed
+  ///        over once the full resolution texture or tile pyramid is there,
+  ///        unless there is nothing else.
+  SDL_Texture *textureFor(const SDL_Rect &dest, SDL_Point *dims) const;
+  /// \brief True if \c tex is one of the proxies, in Tier::Compact.
+  bool isCompactProxy(const SDL_Texture *tex) const;
+
   SDL_Texture *m_texture;
+  TilePyramid *m_pyramid;
+  std::array<SDL_Texture *, NUM_PROXIES> m_proxies;
+  std::array<SDL_Point, NUM_PROXIES> m_proxyDims;
+  std::array<TextureUploader::Tier, NUM_PROXIES> m_proxyTiers;
   SDL_Rect m_bbox; ///< The bounding box for this image
   SDL_Rect m_src;  ///< The cropping rectangle for this image.
   SDL_Point m_texDims;
@@ -0,0 +1,526 @@
+#include "imageloader.h"
+#include "pixelkernels.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+/// \brief An empty ARGB8888 surface.
+SDL_Surface *createARGB(int w, int h) {
+  return SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00, 0x000000ff,
+                              0xff000000);
+}
+
+/// \brief ProxyCache entry name for proxy \c level fit into \c box.
+std::string proxyEntry(int level, const SDL_Point &box) {
+  std::ostringstream entry;
+  entry << "proxy" << level << '-' << box.x << 'x' << box.y;
+  return entry.str();
+}
+
+/// \brief Largest size with the aspect ratio of \c dims that fits in \c box,
+///        never larger than \c dims itself.
+SDL_Point fitInBox(const SDL_Point &dims, const SDL_Point &box) {
+  const float s{std::min(1.0f, std::min(box.x / static_cast<float>(dims.x),
+                                        box.y / static_cast<float>(dims.y)))};
+  return {std::max(1, static_cast<int>(dims.x * s)),
+          std::max(1, static_cast<int>(dims.y * s))};
+}
+
+/// \brief Downscale of an ARGB8888 surface.
+///
+/// Area averaging, where every destination pixel is the mean of the source
+/// pixels it covers, avoids the aliasing of the nearest neighbour
+/// SDL_BlitScaled(). It blurs when shrinking by less than 2x, where the
+/// Lanczos filter is used instead.
+SDL_Surface *downscale(SDL_Surface *src, int dw, int dh) {
+  SDL_Surface *dst{createARGB(dw, dh)};
+  if (dst == nullptr)
+    return nullptr;
+
+  const PixelKernels &kernels{PixelKernels::best()};
+  if (src->w < 2 * dw && src->h < 2 * dh) {
+    kernels.downscaleLanczos(src, dst);
+  } else {
+    kernels.downscaleArea(src, dst);
+  }
+  return dst;
+}
+} // namespace
+
+const int ImageLoader::DISCARD;
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Request
+ImageLoader::Request::forImage(size_t index, const std::string &path,
+                               bool full, const ProxyBoxes &boxes, bool yuv) {
+  return {index, path, full, boxes, Kind::Image, {0, 0, 0}, yuv};
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Request
+ImageLoader::Request::forPyramid(size_t index, const std::string &path,
+                                 const ProxyBoxes &boxes) {
+  return {index, path, false, boxes, Kind::Pyramid, {0, 0, 0}, false};
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Request
+ImageLoader::Request::forTile(size_t index, const std::string &path,
+                              const TilePyramid::TileId &tile) {
+  return {index, path, false, ProxyBoxes{}, Kind::Tile, tile, false};
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::ImageLoader(ProxyCache *cache, int numThreads)
+    : m_cache{cache}, m_nextId{0}, m_stop{false}, m_notifyEvent{0} {
+  if (numThreads <= 0) {
+    numThreads = SDL_GetCPUCount();
+  }
+
+  for (int i = 0; i < numThreads; ++i) {
+    m_workers.emplace_back(&ImageLoader::work, this);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::~ImageLoader() {
+  {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    m_stop = true;
+    m_jobs.clear();
+  }
+  m_jobsCond.notify_all();
+
+  for (auto &t : m_workers) {
+    t.join();
+  }
+
+  // Nobody is going to pick these up anymore.
+  for (auto &r : m_done) {
+    SDL_FreeSurface(r.surface);
+    delete r.yuv;
+    for (auto p : r.proxies) {
+      SDL_FreeSurface(p);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::prioritize(const PriorityFunction &priority) {
+  m_priority = priority;
+  reprioritize();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::enqueue(const Request &request) {
+  const int priority{m_priority ? m_priority(request) : 0};
+  if (priority == DISCARD) {
+    {
+      std::lock_guard<std::mutex> lock(m_doneMutex);
+      m_done.push_back(cancelledResult(request));
+    }
+    pushNotifyEvent();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    m_jobs.push_back({request, priority, m_nextId++, false});
+  }
+  m_jobsCond.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::reprioritize() {
+  if (!m_priority)
+    return;
+
+  std::vector<Request> dropped;
+  {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    auto keep = m_jobs.begin();
+    for (auto &job : m_jobs) {
+      job.priority = m_priority(job.request);
+      if (job.priority == DISCARD) {
+        dropped.push_back(job.request);
+      } else {
+        *keep++ = job;
+      }
+    }
+    m_jobs.erase(keep, m_jobs.end());
+
+    for (auto &job : m_running) {
+      if (m_priority(job.request) == DISCARD)
+        job.cancelled = true;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_doneMutex);
+    for (auto &request : dropped) {
+      m_done.push_back(cancelledResult(request));
+    }
+  }
+  if (!dropped.empty())
+    pushNotifyEvent();
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ImageLoader::poll(Result *result) {
+  std::lock_guard<std::mutex> lock(m_doneMutex);
+  if (m_done.empty())
+    return false;
+
+  *result = m_done.front();
+  m_done.pop_front();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t ImageLoader::pending() const {
+  std::lock_guard<std::mutex> lock(m_jobsMutex);
+  return m_jobs.size() + m_running.size();
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t ImageLoader::finished() const {
+  std::lock_guard<std::mutex> lock(m_doneMutex);
+  return m_done.size();
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ImageLoader::isCancelled(const Job &job) const {
+  std::lock_guard<std::mutex> lock(m_jobsMutex);
+  for (auto &running : m_running) {
+    if (running.id == job.id)
+      return running.cancelled;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::pushNotifyEvent() const {
+  const Uint32 type{m_notifyEvent};
+  if (type == 0)
+    return;
+
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = type;
+  SDL_PushEvent(&event); // Thread safe.
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Result ImageLoader::emptyResult(const Request &request) {
+  return {request.index, nullptr,      {},           {0, 0},
+          request.path,  "",           false,        request.kind,
+          request.tile,  false,        nullptr,      request.full};
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Result ImageLoader::cancelledResult(const Request &request) {
+  Result r{emptyResult(request)};
+  r.cancelled = true;
+  return r;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::work() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_jobsMutex);
+      m_jobsCond.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+      if (m_stop)
+        return;
+
+      // Most urgent first, oldest first among equals.
+      auto next = std::min_element(
+          m_jobs.begin(), m_jobs.end(), [](const Job &a, const Job &b) {
+            return a.priority < b.priority ||
+                   (a.priority == b.priority && a.id < b.id);
+          });
+      job = *next;
+      m_jobs.erase(next);
+      m_running.push_back(job);
+    }
+
+    Result r;
+    switch (job.request.kind) {
+    case Kind::Pyramid:
+      r = buildPyramid(job);
+      break;
+    case Kind::Tile:
+      r = loadTile(job);
+      break;
+    case Kind::Image:
+    default:
+      r = decode(job);
+      break;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_doneMutex);
+      m_done.push_back(r);
+    }
+    pushNotifyEvent();
+    {
+      std::lock_guard<std::mutex> lock(m_jobsMutex);
+      m_running.erase(std::find_if(
+          m_running.begin(), m_running.end(),
+          [&job](const Job &running) { return running.id == job.id; }));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Result ImageLoader::decode(const Job &j) const {
+  const Request &job{j.request};
+  Result r{emptyResult(job)};
+
+  const bool missingProxy{!loadProxies(job, &r)};
+  if (!job.full && !missingProxy)
+    return r;
+
+  // The decode is the expensive part, skip it if nobody wants it anymore.
+  if (isCancelled(j)) {
+    freeProxies(&r);
+    return cancelledResult(job);
+  }
+
+  // Without the full resolution image, the codec may decode at the
+  // smallest size the missing proxies can still be made from.
+  SDL_Point box{0, 0};
+  if (!job.full) {
+    for (int i = 0; i < Image::NUM_PROXIES; ++i) {
+      if (r.proxies[i] == nullptr) {
+        box.x = std::max(box.x, job.proxyBoxes[i].x);
+        box.y = std::max(box.y, job.proxyBoxes[i].y);
+      }
+    }
+  }
+  // Proxies are scaled from ARGB8888 pixels, so no planar YUV for them.
+  const bool yuv{job.full && job.yuv && !missingProxy};
+  SDL_Surface *src{m_codecs.load(job.path, box, &r.dims, nullptr,
+                                 yuv ? &r.yuv : nullptr)};
+  if (src == nullptr && r.yuv == nullptr) {
+    r.error = SDL_GetError(); // SDL keeps the error message per thread.
+    r.failed = true;
+    freeProxies(&r);
+    return r;
+  }
+  if (src != nullptr)
+    makeProxies(job, src, &r);
+
+  // The new proxies are in the cache now, which saves the next decode, but
+  // the textures are not wanted anymore.
+  if (isCancelled(j)) {
+    SDL_FreeSurface(src);
+    delete r.yuv;
+    freeProxies(&r);
+    return cancelledResult(job);
+  }
+
+  if (job.full) {
+    r.surface = src;
+  } else {
+    SDL_FreeSurface(src);
+  }
+
+  return r;
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Result ImageLoader::buildPyramid(const Job &j) const {
+  const Request &job{j.request};
+  Result r{emptyResult(job)};
+  if (m_cache == nullptr || !m_cache->isValid()) {
+    r.error = "No proxy cache to keep the tiles in";
+    r.failed = true;
+    return r;
+  }
+
+  // Proxies not in the cache are made from the same decode as the tiles.
+  const bool missingProxy{!loadProxies(job, &r)};
+
+  // Made on an earlier open, or by an earlier run.
+  SDL_Surface *manifest{
+      m_cache->load(job.path, TilePyramid::manifestEntry(), &r.dims)};
+  const bool tiled{manifest != nullptr && hasAllTiles(job.path, r.dims)};
+  SDL_FreeSurface(manifest);
+  if (tiled && !missingProxy)
+    return r;
+
+  if (isCancelled(j)) {
+    freeProxies(&r);
+    return cancelledResult(job);
+  }
+
+  SDL_Surface *level{m_codecs.load(job.path, {0, 0}, &r.dims)};
+  if (level == nullptr) {
+    r.error = SDL_GetError();
+    r.failed = true;
+    freeProxies(&r);
+    return r;
+  }
+  makeProxies(job, level, &r);
+  if (tiled) {
+    SDL_FreeSurface(level);
+    return r;
+  }
+  SDL_SetSurfaceBlendMode(level, SDL_BLENDMODE_NONE);
+
+  const int ts{TilePyramid::TILE_SIZE};
+  const int levels{TilePyramid::levelCount(r.dims)};
+  bool complete{true};
+  for (int l = 0; l < levels && level != nullptr; ++l) {
+    if (isCancelled(j)) {
+      // No manifest was written, the next open starts over.
+      SDL_FreeSurface(level);
+      freeProxies(&r);
+      return cancelledResult(job);
+    }
+
+    for (int row = 0; row * ts < level->h; ++row) {
+      for (int col = 0; col * ts < level->w; ++col) {
+        SDL_Rect area{col * ts, row * ts, std::min(ts, level->w - col * ts),
+                      std::min(ts, level->h - row * ts)};
+        SDL_Surface *tile{createARGB(area.w, area.h)};
+        if (tile == nullptr) {
+          complete = false;
+          continue;
+        }
+        SDL_BlitSurface(level, &area, tile, nullptr);
+        complete &= m_cache->store(
+            job.path, TilePyramid::tileEntry({l, col, row}), r.dims, tile);
+        SDL_FreeSurface(tile);
+      }
+    }
+
+    if (l + 1 < levels) {
+      SDL_Point next{TilePyramid::levelDims(r.dims, l + 1)};
+      SDL_Surface *smaller{downscale(level, next.x, next.y)};
+      SDL_FreeSurface(level);
+      level = smaller;
+      if (level != nullptr)
+        SDL_SetSurfaceBlendMode(level, SDL_BLENDMODE_NONE);
+    }
+  }
+
+  if (level == nullptr) {
+    r.error = "Out of memory while building the tile pyramid";
+    r.failed = true;
+    freeProxies(&r);
+    return r;
+  }
+  SDL_FreeSurface(level);
+
+  if (!complete) {
+    r.error = "Could not write all tiles to the proxy cache";
+    r.failed = true;
+    freeProxies(&r);
+    return r;
+  }
+
+  // Written last, so it only exists if every tile made it to the cache.
+  SDL_Surface *marker{createARGB(1, 1)};
+  if (marker != nullptr) {
+    m_cache->store(job.path, TilePyramid::manifestEntry(), r.dims, marker);
+    SDL_FreeSurface(marker);
+  }
+
+  return r;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ImageLoader::isCached(const std::string &path,
+                           const ProxyBoxes &boxes) const {
+  if (m_cache == nullptr)
+    return false;
+
+  for (int i = 0; i < Image::NUM_PROXIES; ++i) {
+    const SDL_Point &box{boxes[i]};
+    if (box.x > 0 && box.y > 0 && !m_cache->contains(path, proxyEntry(i, box)))
+      return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ImageLoader::loadProxies(const Request &job, Result *r) const {
+  bool all{true};
+  for (int i = 0; i < Image::NUM_PROXIES; ++i) {
+    const SDL_Point &box{job.proxyBoxes[i]};
+    if (box.x <= 0 || box.y <= 0)
+      continue;
+
+    if (m_cache != nullptr)
+      r->proxies[i] = m_cache->load(job.path, proxyEntry(i, box), &r->dims);
+    if (r->proxies[i] == nullptr)
+      all = false;
+  }
+  return all;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::makeProxies(const Request &job, SDL_Surface *src,
+                              Result *r) const {
+  // Largest proxy first, each one is scaled down from the previous one.
+  SDL_Surface *from{src};
+  for (int i = Image::NUM_PROXIES - 1; i >= 0; --i) {
+    const SDL_Point &box{job.proxyBoxes[i]};
+    if (box.x <= 0 || box.y <= 0)
+      continue;
+
+    if (r->proxies[i] == nullptr) {
+      SDL_Point dims{fitInBox(r->dims, box)};
+      r->proxies[i] = downscale(from, dims.x, dims.y);
+      if (r->proxies[i] != nullptr && m_cache != nullptr)
+        m_cache->store(job.path, proxyEntry(i, box), r->dims, r->proxies[i]);
+    }
+
+    if (r->proxies[i] != nullptr)
+      from = r->proxies[i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ImageLoader::freeProxies(Result *r) {
+  for (auto &p : r->proxies) {
+    SDL_FreeSurface(p);
+    p = nullptr;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ImageLoader::hasAllTiles(const std::string &path,
+                              const SDL_Point &dims) const {
+  // ProxyCache::prune() goes by age and may have taken some of them.
+  const int ts{TilePyramid::TILE_SIZE};
+  for (int l = 0; l < TilePyramid::levelCount(dims); ++l) {
+    const SDL_Point level{TilePyramid::levelDims(dims, l)};
+    for (int row = 0; row * ts < level.y; ++row) {
+      for (int col = 0; col * ts < level.x; ++col) {
+        if (!m_cache->contains(path, TilePyramid::tileEntry({l, col, row})))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::Result ImageLoader::loadTile(const Job &j) const {
+  const Request &job{j.request};
+  Result r{emptyResult(job)};
+  if (m_cache != nullptr)
+    r.surface =
+        m_cache->load(job.path, TilePyramid::tileEntry(job.tile), &r.dims);
+
+  if (r.surface == nullptr) {
+    r.error = "Tile is not in the proxy cache";
+    r.failed = true;
+  }
+  return r;
+}
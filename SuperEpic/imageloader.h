@@ -0,0 +1,190 @@
+#ifndef epic_imageloader_h__
+#define epic_imageloader_h__
+
+#include "codecregistry.h"
+#include "image.h"
+#include "proxycache.h"
+#include "tilepyramid.h"
+#include "yuvimage.h"
+
+#include <SDL.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Decodes image files on a pool of worker threads.
+///
+/// The decode (CodecRegistry) and the downscaling of the proxies happen on the
+/// workers. Proxies are looked up in the ProxyCache first and the file is
+/// only decoded if one of them is missing or the full resolution image was
+/// asked for; newly made proxies are written back. The workers also build
+/// and load the tiles of TilePyramids for images too large to be a single
+/// texture. Decoded surfaces are put on a completion queue and must be turned
+/// into textures by the thread that owns the SDL_Renderer, see \c poll().
+///
+/// Queued requests are started in priority order, see prioritize(). Requests
+/// whose priority becomes DISCARD are dropped from the queue, or abandoned
+/// at the next checkpoint if a worker already started them; either way they
+/// come back from poll() with \c cancelled set.
+////////////////////////////////////////////////////////////////////////////
+class ImageLoader {
+public:
+  using ProxyBoxes = std::array<SDL_Point, Image::NUM_PROXIES>;
+  using ProxySurfaces = std::array<SDL_Surface *, Image::NUM_PROXIES>;
+
+  enum class Kind {
+    Image,   ///< Proxies and/or the full resolution image.
+    Pyramid, ///< Make sure all tiles of the pyramid are in the ProxyCache,
+             ///< proxies not in there are made along the way.
+    Tile     ///< Read one pyramid tile from the ProxyCache.
+  };
+
+  struct Request {
+    size_t index;     ///< Handed back in the Result.
+    std::string path; ///< File to decode.
+    bool full;        ///< Hand back the full resolution surface too.
+    /// Box each proxy is fit into, keeping the aspect ratio. Proxies with an
+    /// empty box are not generated.
+    ProxyBoxes proxyBoxes;
+    Kind kind;                ///< What to load.
+    TilePyramid::TileId tile; ///< The tile to read for Kind::Tile.
+    /// Hand back the full resolution image as Result::yuv instead, if the
+    /// codec can decode it to planar YUV.
+    bool yuv;
+
+    /// \brief Load the proxies in \c boxes and, if \c full, the full
+    ///        resolution image, see \c yuv.
+    static Request forImage(size_t index, const std::string &path,
+                            bool full, const ProxyBoxes &boxes,
+                            bool yuv = false);
+    /// \brief Build the tile pyramid, and the proxies in \c boxes.
+    static Request forPyramid(size_t index, const std::string &path,
+                              const ProxyBoxes &boxes = ProxyBoxes{});
+    /// \brief Read \c tile of the pyramid.
+    static Request forTile(size_t index, const std::string &path,
+                           const TilePyramid::TileId &tile);
+  };
+
+  /// Priority that cancels a request, see prioritize().
+  static const int DISCARD = -1;
+
+  /// Lower values are started first, DISCARD cancels the request.
+  using PriorityFunction = std::function<int(const Request &)>;
+
+  struct Result {
+    size_t index;         ///< The index given in the Request.
+    SDL_Surface *surface; ///< Full resolution pixels, nullptr if not
+                          /// requested or if decoding failed.
+    ProxySurfaces proxies; ///< Downscaled pixels, nullptr if not requested.
+    SDL_Point dims;        ///< Dimensions of the full resolution image.
+    std::string path;      ///< File that was decoded.
+    std::string error;     ///< SDL error message if decoding failed.
+    bool failed;           ///< True if the file could not be decoded.
+    Kind kind;             ///< Same as in the Request.
+    TilePyramid::TileId tile; ///< Same as in the Request, pixels of the tile
+                              /// are in surface.
+    bool cancelled;        ///< True if the request was discarded, nothing was
+                           /// loaded.
+    YUVImage *yuv; ///< Full resolution pixels in place of surface, see
+                   /// Request::yuv.
+    bool full;     ///< Same as in the Request.
+  };
+
+  /// \param cache Where proxies are looked up and stored, may be nullptr.
+  /// \param numThreads Number of decode threads, 0 means one per CPU core.
+  explicit ImageLoader(ProxyCache *cache, int numThreads = 0);
+  ~ImageLoader();
+
+  /// \brief Set the function that ranks requests. It is called on the thread
+  ///        that calls enqueue() and reprioritize() only. Without one,
+  ///        requests are started in the order they were queued.
+  void prioritize(const PriorityFunction &priority);
+
+  /// \brief Queue a file for decoding.
+  void enqueue(const Request &request);
+
+  /// \brief Rank every queued and running request again, e.g. after the user
+  ///        moved to another part of the gallery. Discarded requests are
+  ///        removed from the queue or stopped at their next checkpoint.
+  void reprioritize();
+
+  /// \brief Push an SDL event of type \c eventType every time a request
+  ///        finishes, so a thread waiting for events wakes up to poll().
+  ///        0, the default, pushes nothing.
+  void notify(Uint32 eventType) { m_notifyEvent = eventType; }
+
+  /// \brief Pop one finished decode off the completion queue.
+  /// \return false if no decode has finished since the last call.
+  bool poll(Result *result);
+
+  /// \brief Number of files queued or being decoded.
+  size_t pending() const;
+
+  /// \brief Number of results waiting to be poll()ed.
+  size_t finished() const;
+
+  /// \brief True if every proxy in \c boxes of the image at \c path is in
+  ///        the ProxyCache, so a request for them does not decode the file.
+  bool isCached(const std::string &path, const ProxyBoxes &boxes) const;
+
+private:
+  struct Job {
+    Request request;
+    int priority;
+    Uint64 id;      ///< Order in which the job was queued.
+    bool cancelled; ///< Only set for running jobs, see isCancelled().
+  };
+
+  void work();
+  Result decode(const Job &job) const;
+  Result buildPyramid(const Job &job) const;
+  Result loadTile(const Job &job) const;
+
+  /// \brief Load the proxies \c job asks for from the cache into \c r.
+  /// \return false if one of them is missing.
+  bool loadProxies(const Request &job, Result *r) const;
+  /// \brief Make the proxies of \c job that \c r is still missing from
+  ///        \c src, the full resolution image, and store them in the cache.
+  void makeProxies(const Request &job, SDL_Surface *src, Result *r) const;
+  /// \brief True if the cache holds every tile of the pyramid of \c path.
+  bool hasAllTiles(const std::string &path, const SDL_Point &dims) const;
+  static void freeProxies(Result *r);
+
+  /// \brief Checkpoint for the workers, true if the running job \c job
+  ///        was discarded since it started.
+  bool isCancelled(const Job &job) const;
+  /// \brief Wake up the thread that calls poll(), see notify().
+  void pushNotifyEvent() const;
+  /// \brief Result for \c request with nothing loaded yet. Every member is
+  ///        spelled out here, the other results start from this one.
+  static Result emptyResult(const Request &request);
+  /// \brief Result to hand back for a discarded job.
+  static Result cancelledResult(const Request &request);
+
+  ProxyCache *m_cache;
+  CodecRegistry m_codecs;
+  std::vector<std::thread> m_workers;
+
+  mutable std::mutex m_jobsMutex;
+  std::condition_variable m_jobsCond;
+  std::vector<Job> m_jobs;    ///< Queued, unordered.
+  std::vector<Job> m_running; ///< Popped by a worker but not yet finished.
+  PriorityFunction m_priority;
+  Uint64 m_nextId;
+  bool m_stop;
+
+  mutable std::mutex m_doneMutex;
+  std::deque<Result> m_done;
+  std::atomic<Uint32> m_notifyEvent;
+};
+
+#endif // ! epic_imageloader_h__
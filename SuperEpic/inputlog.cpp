@@ -0,0 +1,289 @@
+#include "inputlog.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+const char MAGIC[4]{'S', 'E', 'I', 'L'};
+/// Version 2 added the previous type and the sensor time to gestures.
+const Uint32 VERSION{2};
+
+/// Bytes of each record before and after the kind dependent payload.
+const Sint64 HEADER_BYTES{4 + 1};
+const Sint64 EVENT_BYTES{4 + 4 * 4};
+const Sint64 GESTURE_BYTES{2 + 4 + 6 * 4};
+const Sint64 GESTURE_V1_BYTES{1 + 6 * 4};
+
+////////////////////////////////////////////////////////////////////////////
+void writeFloat(SDL_RWops *file, float value) {
+  Uint32 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  SDL_WriteLE32(file, bits);
+}
+
+float readFloat(SDL_RWops *file) {
+  Uint32 bits = SDL_ReadLE32(file);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief The four event fields logged for each event type, in the order
+///        they are written.
+void packEvent(const SDL_Event &event, Sint32 *fields) {
+  switch (event.type) {
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    fields[0] = event.key.keysym.sym;
+    fields[1] = event.key.keysym.mod;
+    fields[2] = event.key.keysym.scancode;
+    fields[3] = event.key.repeat;
+    break;
+  case SDL_MOUSEMOTION:
+    fields[0] = event.motion.x;
+    fields[1] = event.motion.y;
+    fields[2] = event.motion.xrel;
+    fields[3] = event.motion.yrel;
+    break;
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    fields[0] = event.button.button;
+    fields[1] = event.button.x;
+    fields[2] = event.button.y;
+    fields[3] = event.button.clicks;
+    break;
+  case SDL_MOUSEWHEEL:
+    fields[0] = event.wheel.x;
+    fields[1] = event.wheel.y;
+    fields[2] = event.wheel.direction;
+    break;
+  case SDL_WINDOWEVENT:
+    fields[0] = event.window.event;
+    fields[1] = event.window.data1;
+    fields[2] = event.window.data2;
+    break;
+  }
+}
+
+void unpackEvent(Uint32 type, const Sint32 *fields, SDL_Event *event) {
+  SDL_zerop(event);
+  event->type = type;
+  switch (type) {
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    event->key.state = type == SDL_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+    event->key.keysym.sym = fields[0];
+    event->key.keysym.mod = static_cast<Uint16>(fields[1]);
+    event->key.keysym.scancode = static_cast<SDL_Scancode>(fields[2]);
+    event->key.repeat = static_cast<Uint8>(fields[3]);
+    break;
+  case SDL_MOUSEMOTION:
+    event->motion.x = fields[0];
+    event->motion.y = fields[1];
+    event->motion.xrel = fields[2];
+    event->motion.yrel = fields[3];
+    break;
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    event->button.state =
+        type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+    event->button.button = static_cast<Uint8>(fields[0]);
+    event->button.x = fields[1];
+    event->button.y = fields[2];
+    event->button.clicks = static_cast<Uint8>(fields[3]);
+    break;
+  case SDL_MOUSEWHEEL:
+    event->wheel.x = fields[0];
+    event->wheel.y = fields[1];
+    event->wheel.direction = static_cast<Uint32>(fields[2]);
+    break;
+  case SDL_WINDOWEVENT:
+    event->window.event = static_cast<Uint8>(fields[0]);
+    event->window.data1 = fields[1];
+    event->window.data2 = fields[2];
+    break;
+  }
+}
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+InputRecorder::InputRecorder(const std::string &path)
+    : m_file{SDL_RWFromFile(path.c_str(), "wb")}, m_start{0},
+      m_started{false}, m_count{0} {
+  if (m_file == nullptr) {
+    std::cerr << "Could not create input log " << path << ": "
+              << SDL_GetError() << std::endl;
+    return;
+  }
+
+  SDL_RWwrite(m_file, MAGIC, sizeof(MAGIC), 1);
+  SDL_WriteLE32(m_file, VERSION);
+}
+
+////////////////////////////////////////////////////////////////////////////
+InputRecorder::~InputRecorder() {
+  if (m_file != nullptr) {
+    SDL_RWclose(m_file);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool InputRecorder::isRecorded(Uint32 type) {
+  switch (type) {
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+  case SDL_MOUSEMOTION:
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+  case SDL_MOUSEWHEEL:
+  case SDL_WINDOWEVENT:
+  case SDL_QUIT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+Uint32 InputRecorder::timestamp(Uint32 ticks) {
+  if (!m_started) {
+    m_start = ticks;
+    m_started = true;
+  }
+  return ticks - m_start;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void InputRecorder::record(Uint32 ticks, const SDL_Event &event) {
+  if (m_file == nullptr || !isRecorded(event.type))
+    return;
+
+  Sint32 fields[4]{0, 0, 0, 0};
+  packEvent(event, fields);
+
+  SDL_WriteLE32(m_file, timestamp(ticks));
+  SDL_WriteU8(m_file, static_cast<Uint8>(InputRecord::Kind::Event));
+  SDL_WriteLE32(m_file, event.type);
+  for (Sint32 field : fields) {
+    SDL_WriteLE32(m_file, static_cast<Uint32>(field));
+  }
+  ++m_count;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void InputRecorder::record(Uint32 ticks, const GestureSample &sample) {
+  if (m_file == nullptr)
+    return;
+
+  SDL_WriteLE32(m_file, timestamp(ticks));
+  SDL_WriteU8(m_file, static_cast<Uint8>(InputRecord::Kind::Gesture));
+  SDL_WriteU8(m_file, static_cast<Uint8>(sample.type));
+  SDL_WriteU8(m_file, static_cast<Uint8>(sample.previous));
+  SDL_WriteLE32(m_file, sample.ms);
+  writeFloat(m_file, sample.hand[0]);
+  writeFloat(m_file, sample.hand[1]);
+  writeFloat(m_file, sample.hand[2]);
+  writeFloat(m_file, sample.panningDeltaX);
+  writeFloat(m_file, sample.panningDeltaY);
+  writeFloat(m_file, sample.secondsSincePan);
+  ++m_count;
+}
+
+////////////////////////////////////////////////////////////////////////////
+InputReplayer::InputReplayer(const std::string &path, bool realtime)
+    : m_next{0}, m_now{0}, m_start{0}, m_started{false},
+      m_realtime{realtime}, m_open{false} {
+  SDL_RWops *file{SDL_RWFromFile(path.c_str(), "rb")};
+  if (file == nullptr) {
+    std::cerr << "Could not open input log " << path << ": "
+              << SDL_GetError() << std::endl;
+    return;
+  }
+
+  char magic[4];
+  Uint32 version{0};
+  if (SDL_RWread(file, magic, sizeof(magic), 1) == 1 &&
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0) {
+    version = SDL_ReadLE32(file);
+  }
+  if (version < 1 || version > VERSION) {
+    std::cerr << path << " is not an input log" << std::endl;
+    SDL_RWclose(file);
+    return;
+  }
+
+  // Records are small, read the whole log up front so replaying does no
+  // file I/O between frames.
+  Sint64 size = SDL_RWsize(file);
+  const Sint64 gestureBytes = version == 1 ? GESTURE_V1_BYTES : GESTURE_BYTES;
+  // Version 1 gestures have no previous type, it is the type of the
+  // gesture before.
+  GestureType previous{GestureType::None};
+  // A log cut short by a crash ends in a partial record, which is dropped.
+  while (size - SDL_RWtell(file) >= HEADER_BYTES) {
+    InputRecord record;
+    SDL_zero(record);
+    record.ms = SDL_ReadLE32(file);
+    record.kind = static_cast<InputRecord::Kind>(SDL_ReadU8(file));
+
+    Sint64 left = size - SDL_RWtell(file);
+    if (record.kind == InputRecord::Kind::Event) {
+      if (left < EVENT_BYTES)
+        break;
+      Uint32 type = SDL_ReadLE32(file);
+      Sint32 fields[4];
+      for (Sint32 &field : fields) {
+        field = static_cast<Sint32>(SDL_ReadLE32(file));
+      }
+      unpackEvent(type, fields, &record.event);
+    } else if (record.kind == InputRecord::Kind::Gesture) {
+      if (left < gestureBytes)
+        break;
+      record.gesture.type = static_cast<GestureType>(SDL_ReadU8(file));
+      record.gesture.previous = previous;
+      if (version > 1) {
+        record.gesture.previous = static_cast<GestureType>(SDL_ReadU8(file));
+        record.gesture.ms = SDL_ReadLE32(file);
+      }
+      previous = record.gesture.type;
+      record.gesture.hand[0] = readFloat(file);
+      record.gesture.hand[1] = readFloat(file);
+      record.gesture.hand[2] = readFloat(file);
+      record.gesture.panningDeltaX = readFloat(file);
+      record.gesture.panningDeltaY = readFloat(file);
+      record.gesture.secondsSincePan = readFloat(file);
+    } else {
+      std::cerr << "Unknown record in input log " << path
+                << ", replaying the first " << m_records.size() << std::endl;
+      break;
+    }
+
+    m_records.push_back(record);
+  }
+
+  SDL_RWclose(file);
+  m_open = true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void InputReplayer::advance(Uint32 ticks) {
+  if (m_realtime) {
+    if (!m_started) {
+      m_start = ticks;
+      m_started = true;
+    }
+    m_now = ticks - m_start;
+  } else if (!finished()) {
+    m_now = m_records[m_next].ms + FAST_STEP_MS - 1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool InputReplayer::poll(InputRecord *record) {
+  if (finished() || m_records[m_next].ms > m_now)
+    return false;
+
+  *record = m_records[m_next++];
+  return true;
+}
@@ -0,0 +1,106 @@
+#ifndef epic_inputlog_h__
+#define epic_inputlog_h__
+
+#include "gesture.h"
+
+#include <SDL.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief One entry of an input log, an SDL input event or a gesture update.
+////////////////////////////////////////////////////////////////////////////
+struct InputRecord {
+  enum class Kind : Uint8 { Event = 0, Gesture = 1 };
+
+  Uint32 ms; ///< Since the first record of the log.
+  Kind kind;
+  SDL_Event event;       ///< For Kind::Event.
+  GestureSample gesture; ///< For Kind::Gesture.
+};
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Writes the input the renderer reacts to into a compact binary log,
+///        so a session can be replayed with InputReplayer.
+///
+/// Only the input events the renderer handles are logged: keys, mouse
+/// motion, buttons and wheel, window events and quit. Each record is a
+/// timestamp, a kind byte and a fixed size payload, all little endian.
+////////////////////////////////////////////////////////////////////////////
+class InputRecorder {
+public:
+  explicit InputRecorder(const std::string &path);
+  ~InputRecorder();
+
+  /// \brief False if the log file could not be created.
+  bool isOpen() const { return m_file != nullptr; }
+
+  /// \brief Log \c event, received at \c ticks (SDL_GetTicks()). Events of
+  ///        other types are ignored.
+  void record(Uint32 ticks, const SDL_Event &event);
+  /// \brief Log the gesture state \c sample at \c ticks.
+  void record(Uint32 ticks, const GestureSample &sample);
+
+  /// \brief Number of records written so far.
+  size_t count() const { return m_count; }
+
+  /// \brief True if the renderer reacts to events of \c type.
+  static bool isRecorded(Uint32 type);
+
+private:
+  Uint32 timestamp(Uint32 ticks);
+
+  SDL_RWops *m_file;
+  Uint32 m_start;
+  bool m_started;
+  size_t m_count;
+};
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Reads a log written by InputRecorder and hands the records back at
+///        their original timing, or as fast as the caller asks for them.
+///
+/// The render loop calls advance() once per iteration and then poll()s the
+/// records that are due. In realtime mode records are due when as much time
+/// has passed since the first advance() as when they were recorded. In fast
+/// mode each advance() releases the next FAST_STEP_MS worth of records
+/// regardless of the wall clock, so a replay always drives the same sequence
+/// of frames.
+////////////////////////////////////////////////////////////////////////////
+class InputReplayer {
+public:
+  /// Log time released per advance() in fast mode, about one 60 Hz frame.
+  static const Uint32 FAST_STEP_MS = 16;
+
+  /// \param realtime Keep the recorded timing instead of replaying as fast
+  ///                 as possible.
+  InputReplayer(const std::string &path, bool realtime);
+
+  /// \brief False if the log could not be read.
+  bool isOpen() const { return m_open; }
+
+  /// \brief Move the replay clock forward, \c ticks is SDL_GetTicks().
+  void advance(Uint32 ticks);
+
+  /// \brief Pop the next record that is due.
+  /// \return false if no record is due until the next advance().
+  bool poll(InputRecord *record);
+
+  /// \brief True after the last record was poll()ed.
+  bool finished() const { return m_next >= m_records.size(); }
+
+  size_t count() const { return m_records.size(); }
+
+private:
+  std::vector<InputRecord> m_records;
+  size_t m_next;
+  Uint32 m_now;   ///< Replay clock, on the timeline of the log.
+  Uint32 m_start; ///< Ticks at the first advance(), realtime mode only.
+  bool m_started;
+  bool m_realtime;
+  bool m_open;
+};
+
+#endif // ! epic_inputlog_h__
@@ -0,0 +1,180 @@
+#include "jointfilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const float PI{3.14159265f};
+/// Frame interval assumed when two frames carry the same time.
+const float DEFAULT_DT{1.0f / 30.0f};
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Weight of the new sample of a first order low pass with cutoff
+///        frequency \c cutoff, sampled every \c dt seconds.
+float lowPassAlpha(float cutoff, float dt) {
+  const float tau = 1.0f / (2.0f * PI * cutoff);
+  return 1.0f / (1.0f + tau / dt);
+}
+} // namespace
+
+const int JointFilter::MAX_WINDOW;
+
+////////////////////////////////////////////////////////////////////////////
+JointFilter::Params::Params()
+    : kind{Kind::Boxcar}, window{10}, minCutoff{1.0f}, beta{1.5f},
+      dCutoff{1.0f}, smoothing{0.5f}, correction{0.5f} {}
+
+////////////////////////////////////////////////////////////////////////////
+JointFilter::JointFilter(const Params &params) : m_params(params) {
+  m_params.window = std::min(std::max(m_params.window, 1), MAX_WINDOW);
+  reset();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void JointFilter::reset() {
+  for (int b = 0; b < BODIES; ++b) {
+    m_trackingId[b] = 0;
+    m_frames[b] = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+const char *JointFilter::name(Kind kind) {
+  switch (kind) {
+  case Kind::None:
+    return "none";
+  case Kind::Boxcar:
+    return "boxcar";
+  case Kind::OneEuro:
+    return "oneeuro";
+  case Kind::DoubleExponential:
+    return "doubleexp";
+  }
+  return "";
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool JointFilter::parse(const std::string &name, Kind *kind) {
+  for (Kind k : {Kind::None, Kind::Boxcar, Kind::OneEuro,
+                 Kind::DoubleExponential}) {
+    if (name == JointFilter::name(k)) {
+      *kind = k;
+      return true;
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void JointFilter::apply(BodyFrame *frame) {
+  for (int b = 0; b < BODIES; ++b) {
+    BodyFrame::Body &body = frame->bodies[b];
+    if (!body.tracked) {
+      m_frames[b] = 0;
+      continue;
+    }
+    if (body.trackingId != m_trackingId[b]) {
+      m_trackingId[b] = body.trackingId;
+      m_frames[b] = 0;
+    }
+
+    float dt = DEFAULT_DT;
+    if (m_frames[b] > 0 && frame->ms != m_lastMs[b]) {
+      dt = (frame->ms - m_lastMs[b]) * 1e-3f;
+    }
+    m_lastMs[b] = frame->ms;
+
+    // The joints of a body are 75 contiguous floats.
+    float *joints = &body.joints[0][0];
+    switch (m_params.kind) {
+    case Kind::None:
+      break;
+    case Kind::Boxcar:
+      boxcar(b, joints, joints);
+      break;
+    case Kind::OneEuro:
+      oneEuro(b, dt, joints, joints);
+      break;
+    case Kind::DoubleExponential:
+      doubleExponential(b, joints, joints);
+      break;
+    }
+    ++m_frames[b];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void JointFilter::boxcar(int body, const float *in, float *out) {
+  const int window = m_params.window;
+  double *sum = m_sum[body];
+
+  if (m_frames[body] == 0) {
+    std::fill(sum, sum + COORDS, 0.0);
+    m_next[body] = 0;
+  }
+
+  // Replace the oldest frame in the ring once it is full.
+  float *slot = m_history[body][m_next[body]];
+  if (m_frames[body] >= window) {
+    for (int c = 0; c < COORDS; ++c) {
+      sum[c] -= slot[c];
+    }
+  }
+  for (int c = 0; c < COORDS; ++c) {
+    slot[c] = in[c];
+    sum[c] += in[c];
+  }
+  m_next[body] = (m_next[body] + 1) % window;
+
+  const int count = std::min(m_frames[body] + 1, window);
+  const double scale = 1.0 / count;
+  for (int c = 0; c < COORDS; ++c) {
+    out[c] = static_cast<float>(sum[c] * scale);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void JointFilter::oneEuro(int body, float dt, const float *in, float *out) {
+  float *value = m_value[body];
+  float *speed = m_trend[body];
+
+  if (m_frames[body] == 0) {
+    std::copy(in, in + COORDS, value);
+    std::fill(speed, speed + COORDS, 0.0f);
+    std::copy(in, in + COORDS, out);
+    return;
+  }
+
+  const float speedAlpha = lowPassAlpha(m_params.dCutoff, dt);
+  for (int c = 0; c < COORDS; ++c) {
+    const float rawSpeed = (in[c] - value[c]) / dt;
+    speed[c] += speedAlpha * (rawSpeed - speed[c]);
+
+    const float cutoff =
+        m_params.minCutoff + m_params.beta * std::abs(speed[c]);
+    value[c] += lowPassAlpha(cutoff, dt) * (in[c] - value[c]);
+    out[c] = value[c];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void JointFilter::doubleExponential(int body, const float *in, float *out) {
+  float *value = m_value[body];
+  float *trend = m_trend[body];
+
+  if (m_frames[body] == 0) {
+    std::copy(in, in + COORDS, value);
+    std::fill(trend, trend + COORDS, 0.0f);
+    std::copy(in, in + COORDS, out);
+    return;
+  }
+
+  const float a = m_params.smoothing;
+  const float g = m_params.correction;
+  for (int c = 0; c < COORDS; ++c) {
+    const float previous = value[c];
+    value[c] = a * in[c] + (1.0f - a) * (previous + trend[c]);
+    trend[c] = g * (value[c] - previous) + (1.0f - g) * trend[c];
+    out[c] = value[c];
+  }
+}
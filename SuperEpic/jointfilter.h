@@ -0,0 +1,88 @@
+#ifndef epic_jointfilter_h__
+#define epic_jointfilter_h__
+
+#include "bodysource.h"
+
+#include <SDL.h>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Smooths the joints of every body in a BodyFrame.
+///
+/// All 25 joints of all bodies are filtered, each coordinate on its own.
+/// State is kept struct-of-arrays, one contiguous array of 75 coordinates
+/// per body and quantity, so a frame is a few straight loops over floats
+/// without allocations. A body's state starts over when its tracking id
+/// changes.
+///
+/// - Boxcar: mean of the last \c window frames, kept as a running sum over
+///   a ring buffer, O(1) per coordinate. Steady but lags by half a window.
+/// - OneEuro: low pass whose cutoff rises with the speed of the joint,
+///   smooth when still and quick when moving (Casiez et al., CHI 2012).
+/// - DoubleExponential: Holt smoothing of position and trend, the trend
+///   makes up for most of the lag of plain exponential smoothing.
+/// - None: passes the joints through.
+////////////////////////////////////////////////////////////////////////////
+class JointFilter {
+public:
+  enum class Kind { None, Boxcar, OneEuro, DoubleExponential };
+
+  /// Longest boxcar window.
+  static const int MAX_WINDOW = 32;
+
+  struct Params {
+    Kind kind;
+    int window; ///< Boxcar frames, 1 to MAX_WINDOW.
+    float minCutoff;  ///< OneEuro cutoff when still, Hz.
+    float beta;       ///< OneEuro cutoff increase per m/s of speed.
+    float dCutoff;    ///< OneEuro cutoff of the speed estimate, Hz.
+    float smoothing;  ///< DoubleExponential weight of the new position.
+    float correction; ///< DoubleExponential weight of the new trend.
+
+    /// \brief The 10 frame boxcar the gestures were tuned with.
+    Params();
+  };
+
+  explicit JointFilter(const Params &params = Params{});
+
+  /// \brief Replace the joints of the tracked bodies in \c frame with their
+  ///        filtered positions.
+  void apply(BodyFrame *frame);
+
+  /// \brief Forget all bodies.
+  void reset();
+
+  const Params &params() const { return m_params; }
+
+  static const char *name(Kind kind);
+  /// \brief Parse the name() of a filter.
+  /// \return false if \c name is not a filter.
+  static bool parse(const std::string &name, Kind *kind);
+
+private:
+  static const int BODIES = BodyFrame::MAX_BODIES;
+  static const int COORDS = BodyFrame::JOINT_COUNT * 3;
+
+  void boxcar(int body, const float *in, float *out);
+  void oneEuro(int body, float dt, const float *in, float *out);
+  void doubleExponential(int body, const float *in, float *out);
+
+  Params m_params;
+
+  Uint64 m_trackingId[BODIES];
+  int m_frames[BODIES]; ///< Frames seen since the body (re)appeared.
+  Uint32 m_lastMs[BODIES];
+
+  // Boxcar: ring of the last frames and their running sum.
+  float m_history[BODIES][MAX_WINDOW][COORDS];
+  double m_sum[BODIES][COORDS];
+  int m_next[BODIES]; ///< Ring slot the next frame goes to.
+
+  // OneEuro: filtered position and speed. DoubleExponential: smoothed
+  // position and trend.
+  float m_value[BODIES][COORDS];
+  float m_trend[BODIES][COORDS];
+};
+
+#endif // ! epic_jointfilter_h__
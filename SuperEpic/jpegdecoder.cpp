@@ -0,0 +1,275 @@
+#include "jpegdecoder.h"
+
+////////////////////////////////////////////////////////////////////////////
+bool isJPEG(const Uint8 *data, size_t size) {
+  return size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff;
+}
+
+#ifdef EPIC_LIBJPEG
+#include "pixelkernels.h"
+#include "yuvimage.h"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+
+// jpeglib.h needs FILE and size_t declared first.
+#include <jpeglib.h>
+
+// libjpeg-turbo converts to the byte order of ARGB8888 itself.
+#if defined(JCS_EXTENSIONS) && SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define EPIC_JPEG_BGRA
+#endif
+
+namespace {
+/// Scales libjpeg decodes at, largest reduction first.
+const unsigned int SCALE_DENOMS[]{8, 4, 2, 1};
+
+struct ErrorManager {
+  jpeg_error_mgr pub;
+  std::jmp_buf jump;
+};
+
+/// \brief libjpeg calls this instead of exit() on fatal errors.
+void onError(j_common_ptr cinfo) {
+  std::longjmp(reinterpret_cast<ErrorManager *>(cinfo->err)->jump, 1);
+}
+
+/// \brief Drop warnings, e.g. about premature end of data, rather than
+///        printing them to stderr from a worker thread.
+void onMessage(j_common_ptr) {}
+
+/// \brief Maps full range JPEG samples into the video range of YUVImage.
+struct VideoRange {
+  Uint8 luma[256];
+  Uint8 chroma[256];
+
+  VideoRange() {
+    for (int i = 0; i < 256; ++i) {
+      luma[i] = static_cast<Uint8>(16 + (i * 219 + 127) / 255);
+      chroma[i] = static_cast<Uint8>(16 + (i * 224 + 127) / 255);
+    }
+  }
+};
+
+const VideoRange &videoRange() {
+  static const VideoRange range;
+  return range;
+}
+
+/// \brief True if decodeJPEGYUV() can take the samples of \c cinfo as
+///        they are: grayscale, or YCbCr with chroma at full, half or
+///        quarter resolution.
+bool hasYUVLayout(const jpeg_decompress_struct &cinfo) {
+  if (cinfo.jpeg_color_space == JCS_GRAYSCALE)
+    return cinfo.num_components == 1;
+  if (cinfo.jpeg_color_space != JCS_YCbCr || cinfo.num_components != 3)
+    return false;
+
+  const jpeg_component_info *comp{cinfo.comp_info};
+  return comp[0].h_samp_factor <= 2 && comp[0].v_samp_factor <= 2 &&
+         comp[1].h_samp_factor == 1 && comp[1].v_samp_factor == 1 &&
+         comp[2].h_samp_factor == 1 && comp[2].v_samp_factor == 1;
+}
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *decodeJPEG(const Uint8 *data, size_t size, const SDL_Point &box,
+                        SDL_Point *fullDims) {
+  jpeg_decompress_struct cinfo;
+  ErrorManager err;
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = onError;
+  err.pub.output_message = onMessage;
+
+  // Set after the setjmp(), so volatile to survive the longjmp().
+  SDL_Surface *volatile argb{nullptr};
+  if (setjmp(err.jump)) {
+    SDL_FreeSurface(argb);
+    jpeg_destroy_decompress(&cinfo);
+    return nullptr;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<Uint8 *>(data),
+               static_cast<unsigned long>(size));
+  jpeg_read_header(&cinfo, TRUE);
+
+  // CMYK and YCCK do not convert to RGB, IMG_Load() decides what to do.
+  if (cinfo.jpeg_color_space == JCS_CMYK ||
+      cinfo.jpeg_color_space == JCS_YCCK) {
+    jpeg_destroy_decompress(&cinfo);
+    return nullptr;
+  }
+
+  const int w{static_cast<int>(cinfo.image_width)};
+  const int h{static_cast<int>(cinfo.image_height)};
+  *fullDims = {w, h};
+
+#ifdef EPIC_JPEG_BGRA
+  cinfo.out_color_space = JCS_EXT_BGRA;
+#else
+  cinfo.out_color_space = JCS_RGB;
+#endif
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = 1;
+  if (box.x > 0 && box.y > 0) {
+    // The size the largest proxy is made at, see ImageLoader.
+    const float fit{std::min(1.0f, std::min(box.x / static_cast<float>(w),
+                                            box.y / static_cast<float>(h)))};
+    const int needW{std::max(1, static_cast<int>(w * fit))};
+    const int needH{std::max(1, static_cast<int>(h * fit))};
+    for (unsigned int denom : SCALE_DENOMS) {
+      cinfo.scale_denom = denom;
+      jpeg_calc_output_dimensions(&cinfo);
+      if (static_cast<int>(cinfo.output_width) >= needW &&
+          static_cast<int>(cinfo.output_height) >= needH)
+        break;
+    }
+  }
+  // Proxies are downscaled with the area or Lanczos filter afterwards,
+  // the fast IDCT and upsampling are good enough for that.
+  if (cinfo.scale_denom > 1) {
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+  }
+
+  jpeg_start_decompress(&cinfo);
+  argb = SDL_CreateRGBSurface(0, cinfo.output_width, cinfo.output_height, 32,
+                              0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+  if (argb == nullptr) {
+    jpeg_destroy_decompress(&cinfo);
+    return nullptr;
+  }
+
+#ifdef EPIC_JPEG_BGRA
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row{static_cast<Uint8 *>(argb->pixels) +
+                 cinfo.output_scanline * argb->pitch};
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+#else
+  const PixelKernels &kernels{PixelKernels::best()};
+  JSAMPARRAY rgb{(*cinfo.mem->alloc_sarray)(
+      reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE,
+      cinfo.output_width * cinfo.output_components, 1)};
+  while (cinfo.output_scanline < cinfo.output_height) {
+    const int y{static_cast<int>(cinfo.output_scanline)};
+    jpeg_read_scanlines(&cinfo, rgb, 1);
+    kernels.rgb24ToArgb(
+        rgb[0],
+        reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(argb->pixels) +
+                                   y * argb->pitch),
+        argb->w);
+  }
+#endif
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return argb;
+}
+
+////////////////////////////////////////////////////////////////////////////
+YUVImage *decodeJPEGYUV(const Uint8 *data, size_t size, SDL_Point *fullDims) {
+  jpeg_decompress_struct cinfo;
+  ErrorManager err;
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = onError;
+  err.pub.output_message = onMessage;
+
+  // Set after the setjmp(), so volatile to survive the longjmp().
+  YUVImage *volatile yuv{nullptr};
+  if (setjmp(err.jump)) {
+    delete yuv;
+    jpeg_destroy_decompress(&cinfo);
+    return nullptr;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<Uint8 *>(data),
+               static_cast<unsigned long>(size));
+  jpeg_read_header(&cinfo, TRUE);
+  if (!hasYUVLayout(cinfo)) {
+    jpeg_destroy_decompress(&cinfo);
+    return nullptr;
+  }
+
+  const int w{static_cast<int>(cinfo.image_width)};
+  const int h{static_cast<int>(cinfo.image_height)};
+  *fullDims = {w, h};
+
+  cinfo.raw_data_out = TRUE;
+  cinfo.out_color_space = cinfo.jpeg_color_space;
+  jpeg_start_decompress(&cinfo);
+
+  const int cw{(w + 1) / 2}, ch{(h + 1) / 2};
+  yuv = new YUVImage{w, h, {}, {}, {}};
+  yuv->y.resize(static_cast<size_t>(w) * h);
+  // Grayscale keeps the neutral chroma.
+  yuv->u.assign(static_cast<size_t>(cw) * ch, 128);
+  yuv->v.assign(static_cast<size_t>(cw) * ch, 128);
+
+  // One row of iMCUs of each component. Y comes in max_v_samp_factor * 8
+  // rows per call, the chroma in 8 rows at 1/hs the width.
+  JSAMPARRAY strips[3];
+  for (int c = 0; c < cinfo.num_components; ++c) {
+    const jpeg_component_info &comp{cinfo.comp_info[c]};
+    const JDIMENSION blocks{(comp.width_in_blocks + comp.h_samp_factor - 1) /
+                            comp.h_samp_factor * comp.h_samp_factor};
+    strips[c] = (*cinfo.mem->alloc_sarray)(
+        reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE, blocks * DCTSIZE,
+        comp.v_samp_factor * DCTSIZE);
+  }
+
+  const VideoRange &range{videoRange()};
+  // Chroma is at 1/2 or full resolution in each direction.
+  const int hShift{cinfo.comp_info[0].h_samp_factor - 1};
+  const int vShift{cinfo.comp_info[0].v_samp_factor - 1};
+  const int stripRows{cinfo.max_v_samp_factor * DCTSIZE};
+  while (cinfo.output_scanline < cinfo.output_height) {
+    const int y0{static_cast<int>(cinfo.output_scanline)};
+    jpeg_read_raw_data(&cinfo, strips, stripRows);
+    const int rows{std::min(stripRows, h - y0)};
+
+    for (int r = 0; r < rows; ++r) {
+      const JSAMPLE *in{strips[0][r]};
+      Uint8 *out{&yuv->y[static_cast<size_t>(y0 + r) * w]};
+      for (int x = 0; x < w; ++x) {
+        out[x] = range.luma[in[x]];
+      }
+    }
+    if (cinfo.num_components == 1)
+      continue;
+
+    // Each IYUV chroma sample averages the 2x2, 2x1, 1x2 or single stored
+    // sample that covers the same luma; y0 is always even.
+    for (int cy = y0 / 2; cy < (y0 + rows + 1) / 2; ++cy) {
+      const int r0{(2 * cy - y0) >> vShift};
+      const int r1{std::min(2 * cy + 1 - y0, rows - 1) >> vShift};
+      for (int c = 1; c < 3; ++c) {
+        const JSAMPLE *in0{strips[c][r0]};
+        const JSAMPLE *in1{strips[c][r1]};
+        Uint8 *out{c == 1 ? &yuv->u[static_cast<size_t>(cy) * cw]
+                          : &yuv->v[static_cast<size_t>(cy) * cw]};
+        if (hShift == 1 && vShift == 1) {
+          // 4:2:0 already, by far the most common.
+          for (int cx = 0; cx < cw; ++cx) {
+            out[cx] = range.chroma[in0[cx]];
+          }
+          continue;
+        }
+        for (int cx = 0; cx < cw; ++cx) {
+          const int x0{(2 * cx) >> hShift};
+          const int x1{std::min(2 * cx + 1, w - 1) >> hShift};
+          out[cx] =
+              range.chroma[(in0[x0] + in0[x1] + in1[x0] + in1[x1] + 2) >> 2];
+        }
+      }
+    }
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return yuv;
+}
+#endif // EPIC_LIBJPEG
@@ -0,0 +1,45 @@
+#ifndef epic_jpegdecoder_h__
+#define epic_jpegdecoder_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+
+struct YUVImage;
+
+/// \brief True if \c data starts with the JPEG SOI marker.
+bool isJPEG(const Uint8 *data, size_t size);
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Decode the JPEG file \c data at 1/8, 1/4, 1/2 or full size, the
+///        smallest that still covers the image fit into \c box, into an
+///        ARGB8888 surface. An empty \c box decodes at full size.
+///
+/// libjpeg scales in the inverse DCT, which skips most of the work of a
+/// full resolution decode when only a proxy is wanted. libjpeg-turbo writes
+/// the pixels straight into the surface. Only built with EPIC_LIBJPEG, see
+/// CodecRegistry.
+///
+/// \param fullDims Set to the dimensions of the full resolution image.
+/// \return nullptr if decoding failed, or for CMYK images.
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *decodeJPEG(const Uint8 *data, size_t size, const SDL_Point &box,
+                        SDL_Point *fullDims);
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Decode the JPEG file \c data at full size into a YUVImage,
+///        without converting it to RGB.
+///
+/// libjpeg hands out the samples as they are stored. 4:2:0 files are only
+/// copied, the chroma of 4:2:2 and 4:4:4 files is averaged down and
+/// grayscale files get neutral chroma. The samples are squeezed from the
+/// full range of JPEG into video range on the way. Only built with
+/// EPIC_LIBJPEG, see CodecRegistry.
+///
+/// \param fullDims Set to the dimensions of the image.
+/// \return nullptr if decoding failed, or for files that are not YCbCr or
+///         grayscale, like CMYK, or with an unusual chroma subsampling.
+////////////////////////////////////////////////////////////////////////////
+YUVImage *decodeJPEGYUV(const Uint8 *data, size_t size, SDL_Point *fullDims);
+
+#endif // ! epic_jpegdecoder_h__
@@ -0,0 +1,121 @@
+#include "kinectbodysource.h"
+
+#include "KinectSensor.h"
+
+#include <algorithm>
+#include <iostream>
+
+////////////////////////////////////////////////////////////////////////////
+KinectBodySource::KinectBodySource()
+    : m_sensor{nullptr}, m_frameArrived{0}, m_clockOffset{0},
+      m_haveClockOffset{false} {}
+
+////////////////////////////////////////////////////////////////////////////
+KinectBodySource::~KinectBodySource() {
+  if (m_frameArrived != 0)
+    m_sensor->getBodyFrameReader()->UnsubscribeFrameArrived(m_frameArrived);
+  delete m_sensor;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool KinectBodySource::open() {
+  // KinectSensor exits the program if there is no sensor.
+  m_sensor = new KinectSensor();
+
+  IBodyFrameReader *reader{m_sensor->getBodyFrameReader()};
+  WAITABLE_HANDLE handle{0};
+  if (SUCCEEDED(reader->SubscribeFrameArrived(&handle)))
+    m_frameArrived = handle;
+  else
+    std::cerr << "Could not subscribe to body frames, polling instead.\n";
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool KinectBodySource::wait(Uint32 timeoutMs) {
+  if (m_frameArrived == 0) {
+    // Poll at twice the frame rate of the sensor.
+    SDL_Delay(std::min<Uint32>(timeoutMs, 16));
+    return true;
+  }
+
+  if (WaitForSingleObject(reinterpret_cast<HANDLE>(m_frameArrived),
+                          timeoutMs) != WAIT_OBJECT_0)
+    return false;
+
+  // Reading the event data resets the event.
+  IBodyFrameArrivedEventArgs *args{nullptr};
+  if (SUCCEEDED(m_sensor->getBodyFrameReader()->GetFrameArrivedEventData(
+          m_frameArrived, &args)))
+    args->Release();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool KinectBodySource::acquire(BodyFrame *frame) {
+  IBodyFrame *bodyFrame{nullptr};
+  HRESULT hr = m_sensor->getBodyFrameReader()->AcquireLatestFrame(&bodyFrame);
+  if (!SUCCEEDED(hr) || bodyFrame == nullptr)
+    return false;
+
+  const Uint64 acquired = SDL_GetPerformanceCounter();
+
+  // RelativeTime is in 100 ns ticks.
+  TIMESPAN time{0};
+  bodyFrame->get_RelativeTime(&time);
+  frame->ms = static_cast<Uint32>(time / 10000);
+
+  const Sint64 relative = static_cast<Sint64>(
+      time * (SDL_GetPerformanceFrequency() / 10000000.0));
+  const Sint64 offset = static_cast<Sint64>(acquired) - relative;
+  if (!m_haveClockOffset || offset < m_clockOffset) {
+    m_clockOffset = offset;
+    m_haveClockOffset = true;
+  }
+  frame->captured = static_cast<Uint64>(relative + m_clockOffset);
+
+  IBody *ppBodies[BODY_COUNT] = {0};
+  hr = bodyFrame->GetAndRefreshBodyData(_countof(ppBodies), ppBodies);
+  bodyFrame->Release();
+  if (!SUCCEEDED(hr))
+    return false;
+
+  static_assert(BODY_COUNT == BodyFrame::MAX_BODIES, "Body count mismatch");
+  static_assert(JointType_Count == BodyFrame::JOINT_COUNT,
+                "Joint count mismatch");
+
+  for (int i = 0; i < BODY_COUNT; ++i) {
+    BodyFrame::Body &body = frame->bodies[i];
+    body.tracked = false;
+
+    IBody *pBody = ppBodies[i];
+    if (pBody == nullptr)
+      continue;
+
+    BOOLEAN bTracked = false;
+    hr = pBody->get_IsTracked(&bTracked);
+    Joint joints[JointType_Count];
+    if (SUCCEEDED(hr) && bTracked &&
+        SUCCEEDED(pBody->GetJoints(_countof(joints), joints))) {
+      body.tracked = true;
+      UINT64 trackingId{0};
+      pBody->get_TrackingId(&trackingId);
+      body.trackingId = trackingId;
+      for (int j = 0; j < JointType_Count; ++j) {
+        body.joints[j][0] = joints[j].Position.X;
+        body.joints[j][1] = joints[j].Position.Y;
+        body.joints[j][2] = joints[j].Position.Z;
+      }
+
+      HandState hand;
+      pBody->get_HandLeftState(&hand);
+      body.leftHand = static_cast<BodyFrame::HandState>(hand);
+      pBody->get_HandRightState(&hand);
+      body.rightHand = static_cast<BodyFrame::HandState>(hand);
+    }
+
+    pBody->Release();
+  }
+
+  return true;
+}
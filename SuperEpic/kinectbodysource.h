@@ -0,0 +1,39 @@
+#ifndef epic_kinectbodysource_h__
+#define epic_kinectbodysource_h__
+
+#include "bodysource.h"
+
+#include <cstdint>
+
+class KinectSensor;
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Skeletons from a Kinect v2, Windows only.
+///
+/// wait() sleeps on the frame arrived event of the body frame reader, so the
+/// sensor thread only runs when the Kinect has delivered a new frame.
+///
+/// The RelativeTime of a frame is mapped to the performance counter by the
+/// smallest difference between the two seen so far. Capture times come out
+/// late by the delivery time of the fastest frame, a constant that the
+/// sensor stage of LatencyTracer leaves out.
+////////////////////////////////////////////////////////////////////////////
+class KinectBodySource : public BodySource {
+public:
+  KinectBodySource();
+  ~KinectBodySource() override;
+
+  bool open() override;
+  bool wait(Uint32 timeoutMs) override;
+  bool acquire(BodyFrame *frame) override;
+
+private:
+  KinectSensor *m_sensor;
+  std::intptr_t m_frameArrived; ///< WAITABLE_HANDLE, 0 if not subscribed.
+  /// Performance counter minus the frame RelativeTime in counter ticks, the
+  /// smallest seen, i.e. that of the frame delivered fastest.
+  Sint64 m_clockOffset;
+  bool m_haveClockOffset;
+};
+
+#endif // ! epic_kinectbodysource_h__
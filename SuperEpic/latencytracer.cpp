@@ -0,0 +1,122 @@
+#include "latencytracer.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int LatencyTracer::STAGES;
+const int LatencyTracer::BUCKET_US;
+const int LatencyTracer::MAX_MS;
+const int LatencyTracer::BUCKETS;
+
+////////////////////////////////////////////////////////////////////////////
+LatencyTracer::LatencyTracer()
+    : m_countsPerUs{SDL_GetPerformanceFrequency() * 1e-6},
+      m_buckets(STAGES * BUCKETS) {
+  reset();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void LatencyTracer::reset() {
+  std::fill(m_buckets.begin(), m_buckets.end(), 0);
+  std::fill(m_count, m_count + STAGES, 0);
+  std::fill(m_maxMs, m_maxMs + STAGES, 0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////
+const char *LatencyTracer::name(Stage stage) {
+  switch (stage) {
+  case Stage::Sensor:
+    return "sensor";
+  case Stage::Process:
+    return "process";
+  case Stage::Queue:
+    return "queue";
+  case Stage::Render:
+    return "render";
+  case Stage::Total:
+    return "total";
+  default:
+    return "";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void LatencyTracer::add(Stage stage, Uint64 from, Uint64 to) {
+  // Stamps from a sensor clock that was estimated can be a little off.
+  const double us = to > from ? (to - from) / m_countsPerUs : 0.0;
+  const int s = static_cast<int>(stage);
+  const int bucket = std::min(static_cast<int>(us / BUCKET_US), BUCKETS - 1);
+  ++m_buckets[s * BUCKETS + bucket];
+  ++m_count[s];
+  m_maxMs[s] = std::max(m_maxMs[s], us * 1e-3);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void LatencyTracer::record(const Stamps &stamps, Uint64 presented) {
+  if (stamps.captured == 0)
+    return;
+
+  add(Stage::Sensor, stamps.captured, stamps.acquired);
+  add(Stage::Process, stamps.acquired, stamps.queued);
+  add(Stage::Queue, stamps.queued, stamps.polled);
+  add(Stage::Render, stamps.polled, presented);
+  add(Stage::Total, stamps.captured, presented);
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t LatencyTracer::count(Stage stage) const {
+  return m_count[static_cast<int>(stage)];
+}
+
+////////////////////////////////////////////////////////////////////////////
+double LatencyTracer::maxMs(Stage stage) const {
+  return m_maxMs[static_cast<int>(stage)];
+}
+
+////////////////////////////////////////////////////////////////////////////
+double LatencyTracer::percentileMs(Stage stage, double p) const {
+  const int s = static_cast<int>(stage);
+  if (m_count[s] == 0)
+    return 0.0;
+
+  const size_t rank = static_cast<size_t>(std::ceil(p * m_count[s]));
+  size_t seen = 0;
+  for (int b = 0; b < BUCKETS; ++b) {
+    seen += m_buckets[s * BUCKETS + b];
+    if (seen >= rank && seen > 0) {
+      // The upper edge of the bucket, never more than the slowest sample.
+      return std::min((b + 1) * BUCKET_US * 1e-3, m_maxMs[s]);
+    }
+  }
+  return m_maxMs[s];
+}
+
+////////////////////////////////////////////////////////////////////////////
+void LatencyTracer::print(std::ostream &out) const {
+  out << "Latency (ms)      p50      p95      p99      max  samples\n";
+  for (int s = 0; s < STAGES; ++s) {
+    const Stage stage = static_cast<Stage>(s);
+    char line[96];
+    SDL_snprintf(line, sizeof(line),
+                 "  %-9s %8.1f %8.1f %8.1f %8.1f %8u\n", name(stage),
+                 percentileMs(stage, 0.5),
+                 percentileMs(stage, 0.95), percentileMs(stage, 0.99),
+                 maxMs(stage), static_cast<unsigned>(count(stage)));
+    out << line;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void LatencyTracer::writeJson(std::ostream &out) const {
+  out << "{";
+  for (int s = 0; s < STAGES; ++s) {
+    const Stage stage = static_cast<Stage>(s);
+    out << (s > 0 ? ", " : "") << "\"" << name(stage)
+        << "\": {\"samples\": " << count(stage)
+        << ", \"p50_ms\": " << percentileMs(stage, 0.5)
+        << ", \"p95_ms\": " << percentileMs(stage, 0.95)
+        << ", \"p99_ms\": " << percentileMs(stage, 0.99)
+        << ", \"max_ms\": " << maxMs(stage) << "}";
+  }
+  out << "}";
+}
@@ -0,0 +1,80 @@
+#ifndef epic_latencytracer_h__
+#define epic_latencytracer_h__
+
+#include <SDL.h>
+
+#include <ostream>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Histograms of the time from a hand moving to the frame showing
+///        it, split into the stages a sensor sample goes through.
+///
+/// Every sample carries SDL_GetPerformanceCounter() stamps, see Stamps,
+/// and is recorded once the frame that draws it has been presented:
+///
+/// - sensor:  captured by the sensor to acquired by the sensor thread.
+/// - process: joint filter, gesture recognizers and arbiter.
+/// - queue:   waiting for the render loop to poll it.
+/// - render:  polled to SDL_RenderPresent() returning, including vsync.
+/// - total:   captured to presented.
+///
+/// What the display adds after that, and the lag of the joint filter, are
+/// not measured here; the benchmark reports the filter lag on its own.
+/// Buckets are BUCKET_US wide up to MAX_MS, slower samples share the last
+/// bucket. Recording and reading happen on the render thread.
+////////////////////////////////////////////////////////////////////////////
+class LatencyTracer {
+public:
+  enum class Stage { Sensor, Process, Queue, Render, Total, Count };
+
+  static const int STAGES = static_cast<int>(Stage::Count);
+  static const int BUCKET_US = 100;
+  static const int MAX_MS = 500;
+  static const int BUCKETS = MAX_MS * 1000 / BUCKET_US;
+
+  /// \brief When a sample reached each stage, SDL_GetPerformanceCounter()
+  ///        values. A \c captured of 0 means the sample has no stamps,
+  ///        e.g. a replayed one.
+  struct Stamps {
+    Uint64 captured;
+    Uint64 acquired;
+    Uint64 queued;
+    Uint64 polled;
+  };
+
+  LatencyTracer();
+
+  /// \brief Add a sample that was presented at \c presented.
+  void record(const Stamps &stamps, Uint64 presented);
+
+  /// \brief Forget all samples.
+  void reset();
+
+  /// \brief Samples recorded for \c stage.
+  size_t count(Stage stage) const;
+
+  /// \brief Latency below which a fraction \c p of the samples of
+  ///        \c stage fall, in milliseconds, at bucket resolution.
+  double percentileMs(Stage stage, double p) const;
+
+  double maxMs(Stage stage) const;
+
+  /// \brief One line per stage with p50, p95, p99 and the maximum.
+  void print(std::ostream &out) const;
+
+  /// \brief A JSON object with an entry per stage.
+  void writeJson(std::ostream &out) const;
+
+  static const char *name(Stage stage);
+
+private:
+  void add(Stage stage, Uint64 from, Uint64 to);
+
+  double m_countsPerUs; ///< Performance counter ticks per microsecond.
+  std::vector<Uint32> m_buckets; ///< BUCKETS per stage.
+  size_t m_count[STAGES];
+  double m_maxMs[STAGES];
+};
+
+#endif // ! epic_latencytracer_h__
@@ -0,0 +1,895 @@
+#include "pixelkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||           \
+    defined(_M_IX86)
+#define EPIC_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define EPIC_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit SSE2 and AVX2 instructions in functions marked for
+// them, MSVC takes the intrinsics anywhere.
+#if defined(__GNUC__)
+#define EPIC_SSE2 __attribute__((target("sse2")))
+#define EPIC_AVX2 __attribute__((target("avx2")))
+#else
+#define EPIC_SSE2
+#define EPIC_AVX2
+#endif
+
+namespace {
+/// Radius of the Lanczos window, in source pixels when not shrinking.
+const int LANCZOS_A{3};
+const double PI{3.14159265358979323846};
+
+/// \brief Row \c y of \c surface.
+template <typename T> T *row(const SDL_Surface *surface, int y) {
+  return reinterpret_cast<T *>(static_cast<Uint8 *>(surface->pixels) +
+                               y * surface->pitch);
+}
+
+/// \brief c * a / 255, rounded, without the division.
+inline Uint32 mulAlpha(Uint32 c, Uint32 a) {
+  const Uint32 t{c * a + 128};
+  return (t + (t >> 8)) >> 8;
+}
+
+/// \brief Rows or columns [first, last) of a source of \c srcSize pixels
+///        covered by pixel \c i of a destination of \c dstSize pixels.
+inline void areaSpan(int i, int srcSize, int dstSize, int *first,
+                     int *last) {
+  *first = i * srcSize / dstSize;
+  *last = std::max(*first + 1, (i + 1) * srcSize / dstSize);
+}
+
+/// \brief BT.601 video range luma of an ARGB8888 pixel.
+inline Uint8 lumaOf(Uint32 p) {
+  const int r{static_cast<int>((p >> 16) & 0xff)};
+  const int g{static_cast<int>((p >> 8) & 0xff)};
+  const int b{static_cast<int>(p & 0xff)};
+  return static_cast<Uint8>(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+}
+
+/// \brief BT.601 video range chroma of the colour \c r, \c g, \c b.
+inline void chromaOf(int r, int g, int b, Uint8 *u, Uint8 *v) {
+  *u = static_cast<Uint8>(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+  *v = static_cast<Uint8>(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+}
+
+/// \brief Pixel of \c src that lands on (x, y) of \c dst after rotating
+///        clockwise by \c degrees.
+inline Uint32 rotatedPixel(const SDL_Surface *src, int degrees, int x,
+                           int y) {
+  switch (degrees) {
+  case 90:
+    return row<const Uint32>(src, src->h - 1 - x)[y];
+  case 180:
+    return row<const Uint32>(src, src->h - 1 - y)[src->w - 1 - x];
+  case 270:
+    return row<const Uint32>(src, x)[src->w - 1 - y];
+  default:
+    return row<const Uint32>(src, y)[x];
+  }
+}
+
+/// \brief Round and clamp a filtered channel back to 8 bits.
+inline Uint32 toChannel(float v) {
+  const int c{static_cast<int>(v + 0.5f)};
+  return static_cast<Uint32>(std::min(255, std::max(0, c)));
+}
+
+/// \brief Resampling weights of one dimension: destination pixel \c i is the
+///        sum of weights[i * n + k] times source pixel start[i] + k.
+struct Taps {
+  int n;
+  std::vector<int> start;
+  std::vector<float> weights;
+};
+
+double lanczos(double x) {
+  if (x == 0.0)
+    return 1.0;
+  if (x <= -LANCZOS_A || x >= LANCZOS_A)
+    return 0.0;
+  const double px{PI * x};
+  return LANCZOS_A * std::sin(px) * std::sin(px / LANCZOS_A) / (px * px);
+}
+
+Taps lanczosTaps(int srcSize, int dstSize) {
+  const double scale{static_cast<double>(srcSize) / dstSize};
+  // When shrinking, the window widens to cover every source pixel.
+  const double stretch{std::max(1.0, scale)};
+  const double support{LANCZOS_A * stretch};
+
+  Taps taps;
+  taps.n = std::min(srcSize, static_cast<int>(std::ceil(2 * support)) + 1);
+  taps.start.resize(dstSize);
+  taps.weights.assign(static_cast<size_t>(dstSize) * taps.n, 0.0f);
+
+  for (int i = 0; i < dstSize; ++i) {
+    const double center{(i + 0.5) * scale - 0.5};
+    const int first{static_cast<int>(std::floor(center - support)) + 1};
+    const int last{static_cast<int>(std::floor(center + support))};
+    // Taps past the edges repeat the edge pixel.
+    const int start{std::max(0, std::min(first, srcSize - taps.n))};
+    taps.start[i] = start;
+
+    float *w{&taps.weights[static_cast<size_t>(i) * taps.n]};
+    double sum{0.0};
+    for (int s = first; s <= last; ++s) {
+      const double l{lanczos((s - center) / stretch)};
+      w[std::min(srcSize - 1, std::max(0, s)) - start] +=
+          static_cast<float>(l);
+      sum += l;
+    }
+    for (int k = 0; k < taps.n; ++k) {
+      w[k] = static_cast<float>(w[k] / sum);
+    }
+  }
+
+  return taps;
+}
+
+/// Filters one source row horizontally into 4 floats (B, G, R, A) per
+/// destination pixel.
+using HorizontalPass = void (*)(const Uint32 *in, const Taps &taps,
+                                float *out);
+/// Sums \c n filtered rows with \c weights into \c width pixels.
+using VerticalPass = void (*)(const float *const *rows, const float *weights,
+                              int n, int width, Uint32 *out);
+
+/// \brief Separable Lanczos resample. Only the source rows the current
+///        destination row needs are kept, horizontally filtered.
+void lanczosResample(const SDL_Surface *src, SDL_Surface *dst,
+                     HorizontalPass horizontal, VerticalPass vertical) {
+  const Taps columns{lanczosTaps(src->w, dst->w)};
+  const Taps rows{lanczosTaps(src->h, dst->h)};
+  const size_t stride{static_cast<size_t>(dst->w) * 4};
+
+  // Source row r is in slot r % rows.n.
+  std::vector<float> ring(stride * rows.n);
+  std::vector<int> ringRow(rows.n, -1);
+  std::vector<const float *> taps(rows.n);
+
+  for (int y = 0; y < dst->h; ++y) {
+    for (int k = 0; k < rows.n; ++k) {
+      const int r{rows.start[y] + k};
+      const int slot{r % rows.n};
+      if (ringRow[slot] != r) {
+        horizontal(row<const Uint32>(src, r), columns, &ring[slot * stride]);
+        ringRow[slot] = r;
+      }
+      taps[k] = &ring[slot * stride];
+    }
+    vertical(taps.data(), &rows.weights[static_cast<size_t>(y) * rows.n],
+             rows.n, dst->w, row<Uint32>(dst, y));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Scalar reference.
+////////////////////////////////////////////////////////////////////////////
+
+void rgb24ToArgbScalar(const Uint8 *src, Uint32 *dst, int count) {
+  for (int i = 0; i < count; ++i, src += 3) {
+    dst[i] = 0xff000000u | (static_cast<Uint32>(src[0]) << 16) |
+             (static_cast<Uint32>(src[1]) << 8) | src[2];
+  }
+}
+
+void premultiplyScalar(Uint32 *pixels, int count) {
+  for (int i = 0; i < count; ++i) {
+    const Uint32 p{pixels[i]}, a{p >> 24};
+    pixels[i] = (a << 24) | (mulAlpha((p >> 16) & 0xff, a) << 16) |
+                (mulAlpha((p >> 8) & 0xff, a) << 8) | mulAlpha(p & 0xff, a);
+  }
+}
+
+/// Sums of the B, G, R and A channels of the pixels [x0, x1) x [y0, y1).
+using AreaSum = void (*)(const SDL_Surface *src, int x0, int x1, int y0,
+                         int y1, Uint32 *sums);
+
+void areaSumScalar(const SDL_Surface *src, int x0, int x1, int y0, int y1,
+                   Uint32 *sums) {
+  sums[0] = sums[1] = sums[2] = sums[3] = 0;
+  for (int y = y0; y < y1; ++y) {
+    const Uint32 *in{row<const Uint32>(src, y)};
+    for (int x = x0; x < x1; ++x) {
+      const Uint32 p{in[x]};
+      sums[0] += p & 0xff;
+      sums[1] += (p >> 8) & 0xff;
+      sums[2] += (p >> 16) & 0xff;
+      sums[3] += p >> 24;
+    }
+  }
+}
+
+void downscaleAreaWith(const SDL_Surface *src, SDL_Surface *dst,
+                       AreaSum sum) {
+  for (int y = 0; y < dst->h; ++y) {
+    int y0, y1;
+    areaSpan(y, src->h, dst->h, &y0, &y1);
+    Uint32 *out{row<Uint32>(dst, y)};
+
+    for (int x = 0; x < dst->w; ++x) {
+      int x0, x1;
+      areaSpan(x, src->w, dst->w, &x0, &x1);
+
+      Uint32 s[4];
+      sum(src, x0, x1, y0, y1, s);
+      const Uint32 n{static_cast<Uint32>((y1 - y0) * (x1 - x0))};
+      out[x] = ((s[3] / n) << 24) | ((s[2] / n) << 16) | ((s[1] / n) << 8) |
+               (s[0] / n);
+    }
+  }
+}
+
+void downscaleAreaScalar(const SDL_Surface *src, SDL_Surface *dst) {
+  downscaleAreaWith(src, dst, areaSumScalar);
+}
+
+void horizontalScalar(const Uint32 *in, const Taps &taps, float *out) {
+  const int n{taps.n};
+  for (size_t x = 0; x < taps.start.size(); ++x) {
+    const Uint32 *p{in + taps.start[x]};
+    const float *w{&taps.weights[x * n]};
+    float b{0.0f}, g{0.0f}, r{0.0f}, a{0.0f};
+    for (int k = 0; k < n; ++k) {
+      b += w[k] * (p[k] & 0xff);
+      g += w[k] * ((p[k] >> 8) & 0xff);
+      r += w[k] * ((p[k] >> 16) & 0xff);
+      a += w[k] * (p[k] >> 24);
+    }
+    out[x * 4 + 0] = b;
+    out[x * 4 + 1] = g;
+    out[x * 4 + 2] = r;
+    out[x * 4 + 3] = a;
+  }
+}
+
+void verticalScalar(const float *const *rows, const float *weights, int n,
+                    int width, Uint32 *out) {
+  for (int x = 0; x < width; ++x) {
+    Uint32 pixel{0};
+    for (int c = 0; c < 4; ++c) {
+      float v{0.0f};
+      for (int k = 0; k < n; ++k) {
+        v += rows[k][x * 4 + c] * weights[k];
+      }
+      pixel |= toChannel(v) << (8 * c);
+    }
+    out[x] = pixel;
+  }
+}
+
+void downscaleLanczosScalar(const SDL_Surface *src, SDL_Surface *dst) {
+  lanczosResample(src, dst, horizontalScalar, verticalScalar);
+}
+
+void rotateScalar(const SDL_Surface *src, SDL_Surface *dst, int degrees) {
+  for (int y = 0; y < dst->h; ++y) {
+    Uint32 *out{row<Uint32>(dst, y)};
+    for (int x = 0; x < dst->w; ++x) {
+      out[x] = rotatedPixel(src, degrees, x, y);
+    }
+  }
+}
+
+/// \brief Luma of pixels [x0, w) of the rows \c in0 and \c in1 into \c y0
+///        and \c y1, and the chroma of the 2x2 blocks they make into \c u
+///        and \c v. \c x0 is even. For the last row of an odd height
+///        \c in1 is \c in0 again and \c y1 is nullptr.
+void yuv420SpanScalar(const Uint32 *in0, const Uint32 *in1, int x0, int w,
+                      Uint8 *y0, Uint8 *y1, Uint8 *u, Uint8 *v) {
+  for (int x = x0; x < w; ++x) {
+    y0[x] = lumaOf(in0[x]);
+    if (y1 != nullptr)
+      y1[x] = lumaOf(in1[x]);
+  }
+  for (int cx = x0 / 2; cx < (w + 1) / 2; ++cx) {
+    const int xa{2 * cx}, xb{std::min(2 * cx + 1, w - 1)};
+    int r{2}, g{2}, b{2};
+    for (Uint32 p : {in0[xa], in0[xb], in1[xa], in1[xb]}) {
+      r += (p >> 16) & 0xff;
+      g += (p >> 8) & 0xff;
+      b += p & 0xff;
+    }
+    chromaOf(r >> 2, g >> 2, b >> 2, &u[cx], &v[cx]);
+  }
+}
+
+/// Fills one row of luma, or two, and one row of chroma, see
+/// yuv420SpanScalar().
+using Yuv420Span = void (*)(const Uint32 *in0, const Uint32 *in1, int w,
+                            Uint8 *y0, Uint8 *y1, Uint8 *u, Uint8 *v);
+
+void argbToYuv420With(const SDL_Surface *src, Uint8 *y, Uint8 *u, Uint8 *v,
+                      Yuv420Span span) {
+  const int w{src->w}, cw{(w + 1) / 2};
+  for (int r = 0; r < src->h; r += 2) {
+    const bool pair{r + 1 < src->h};
+    span(row<const Uint32>(src, r), row<const Uint32>(src, pair ? r + 1 : r),
+         w, y + static_cast<size_t>(r) * w,
+         pair ? y + static_cast<size_t>(r + 1) * w : nullptr,
+         u + static_cast<size_t>(r / 2) * cw,
+         v + static_cast<size_t>(r / 2) * cw);
+  }
+}
+
+void argbToYuv420Scalar(const SDL_Surface *src, Uint8 *y, Uint8 *u,
+                        Uint8 *v) {
+  argbToYuv420With(src, y, u, v,
+                   [](const Uint32 *in0, const Uint32 *in1, int w, Uint8 *y0,
+                      Uint8 *y1, Uint8 *u, Uint8 *v) {
+                     yuv420SpanScalar(in0, in1, 0, w, y0, y1, u, v);
+                   });
+}
+
+#ifdef EPIC_KERNELS_X86
+////////////////////////////////////////////////////////////////////////////
+// SSE2. There is no byte shuffle before SSSE3, RGB24 stays scalar.
+////////////////////////////////////////////////////////////////////////////
+
+/// \brief Widen the 4 channels of one pixel to floats.
+EPIC_SSE2 inline __m128 pixelToFloats(Uint32 p) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i c = _mm_unpacklo_epi16(
+      _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(p)), zero), zero);
+  return _mm_cvtepi32_ps(c);
+}
+
+/// \brief Round and clamp 4 channels back to one pixel.
+EPIC_SSE2 inline Uint32 floatsToPixel(__m128 v) {
+  __m128i c = _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+  c = _mm_packs_epi32(c, c);
+  return static_cast<Uint32>(_mm_cvtsi128_si32(_mm_packus_epi16(c, c)));
+}
+
+/// \brief Premultiply the 2 pixels in the 16 bit lanes of \c c.
+EPIC_SSE2 inline __m128i premultiply16(__m128i c) {
+  // Alpha for the colour lanes, 255 for the alpha lanes themselves.
+  const __m128i colour = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  const __m128i opaque = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i alpha = _mm_shufflehi_epi16(
+      _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+  const __m128i a = _mm_or_si128(_mm_and_si128(alpha, colour), opaque);
+
+  const __m128i t =
+      _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+EPIC_SSE2 void premultiplySse2(Uint32 *pixels, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  int i{0};
+  for (; i + 4 <= count; i += 4) {
+    __m128i *p{reinterpret_cast<__m128i *>(pixels + i)};
+    const __m128i v = _mm_loadu_si128(p);
+    _mm_storeu_si128(
+        p, _mm_packus_epi16(premultiply16(_mm_unpacklo_epi8(v, zero)),
+                            premultiply16(_mm_unpackhi_epi8(v, zero))));
+  }
+  premultiplyScalar(pixels + i, count - i);
+}
+
+EPIC_SSE2 void areaSumSse2(const SDL_Surface *src, int x0, int x1, int y0,
+                           int y1, Uint32 *sums) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero;
+  for (int y = y0; y < y1; ++y) {
+    const Uint32 *in{row<const Uint32>(src, y)};
+    int x{x0};
+    for (; x + 4 <= x1; x += 4) {
+      const __m128i p =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x));
+      // Two pixels per 16 bit half, adding them cannot overflow.
+      const __m128i s = _mm_add_epi16(_mm_unpacklo_epi8(p, zero),
+                                      _mm_unpackhi_epi8(p, zero));
+      acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(s, zero),
+                                             _mm_unpackhi_epi16(s, zero)));
+    }
+    for (; x < x1; ++x) {
+      const __m128i p = _mm_unpacklo_epi8(
+          _mm_cvtsi32_si128(static_cast<int>(in[x])), zero);
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(p, zero));
+    }
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), acc);
+}
+
+void downscaleAreaSse2(const SDL_Surface *src, SDL_Surface *dst) {
+  downscaleAreaWith(src, dst, areaSumSse2);
+}
+
+EPIC_SSE2 void horizontalSse2(const Uint32 *in, const Taps &taps,
+                              float *out) {
+  const int n{taps.n};
+  for (size_t x = 0; x < taps.start.size(); ++x) {
+    const Uint32 *p{in + taps.start[x]};
+    const float *w{&taps.weights[x * n]};
+    __m128 acc = _mm_setzero_ps();
+    for (int k = 0; k < n; ++k) {
+      acc = _mm_add_ps(acc, _mm_mul_ps(pixelToFloats(p[k]), _mm_set1_ps(w[k])));
+    }
+    _mm_storeu_ps(out + x * 4, acc);
+  }
+}
+
+EPIC_SSE2 void verticalSse2(const float *const *rows, const float *weights,
+                            int n, int width, Uint32 *out) {
+  const __m128 half = _mm_set1_ps(0.5f);
+  int x{0};
+  for (; x + 4 <= width; x += 4) {
+    __m128 acc[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(),
+                     _mm_setzero_ps()};
+    for (int k = 0; k < n; ++k) {
+      const __m128 w = _mm_set1_ps(weights[k]);
+      for (int j = 0; j < 4; ++j) {
+        acc[j] = _mm_add_ps(
+            acc[j], _mm_mul_ps(_mm_loadu_ps(rows[k] + (x + j) * 4), w));
+      }
+    }
+    __m128i c[4];
+    for (int j = 0; j < 4; ++j) {
+      c[j] = _mm_cvttps_epi32(_mm_add_ps(acc[j], half));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+                     _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]),
+                                      _mm_packs_epi32(c[2], c[3])));
+  }
+  for (; x < width; ++x) {
+    __m128 acc = _mm_setzero_ps();
+    for (int k = 0; k < n; ++k) {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[k] + x * 4),
+                                       _mm_set1_ps(weights[k])));
+    }
+    out[x] = floatsToPixel(acc);
+  }
+}
+
+void downscaleLanczosSse2(const SDL_Surface *src, SDL_Surface *dst) {
+  lanczosResample(src, dst, horizontalSse2, verticalSse2);
+}
+
+/// \brief Transpose the 4x4 block of pixels in \c v.
+EPIC_SSE2 inline void transpose4(__m128i *v) {
+  const __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]);
+  const __m128i t1 = _mm_unpacklo_epi32(v[2], v[3]);
+  const __m128i t2 = _mm_unpackhi_epi32(v[0], v[1]);
+  const __m128i t3 = _mm_unpackhi_epi32(v[2], v[3]);
+  v[0] = _mm_unpacklo_epi64(t0, t1);
+  v[1] = _mm_unpackhi_epi64(t0, t1);
+  v[2] = _mm_unpacklo_epi64(t2, t3);
+  v[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+EPIC_SSE2 void rotateSse2(const SDL_Surface *src, SDL_Surface *dst,
+                          int degrees) {
+  const int dw{dst->w}, dh{dst->h};
+  if (degrees == 180) {
+    for (int y = 0; y < dh; ++y) {
+      const Uint32 *in{row<const Uint32>(src, dh - 1 - y)};
+      Uint32 *out{row<Uint32>(dst, y)};
+      int x{0};
+      for (; x + 4 <= dw; x += 4) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + dw - 4 - x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+                         _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+      }
+      for (; x < dw; ++x) {
+        out[x] = in[dw - 1 - x];
+      }
+    }
+    return;
+  }
+  if (degrees != 90 && degrees != 270) {
+    rotateScalar(src, dst, degrees);
+    return;
+  }
+
+  // 4x4 blocks: four source rows give four destination columns.
+  const int bw{dw & ~3}, bh{dh & ~3};
+  for (int y0 = 0; y0 < bh; y0 += 4) {
+    for (int x0 = 0; x0 < bw; x0 += 4) {
+      __m128i v[4];
+      for (int j = 0; j < 4; ++j) {
+        const Uint32 *in{degrees == 90
+                             ? row<const Uint32>(src, src->h - 1 - x0 - j) + y0
+                             : row<const Uint32>(src, x0 + j) + src->w - 4 -
+                                   y0};
+        v[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+      }
+      transpose4(v);
+      for (int i = 0; i < 4; ++i) {
+        // Clockwise by 270 reads the source rows backwards.
+        const int y{degrees == 90 ? y0 + i : y0 + 3 - i};
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row<Uint32>(dst, y) + x0),
+                         v[i]);
+      }
+    }
+  }
+
+  for (int y = 0; y < dh; ++y) {
+    Uint32 *out{row<Uint32>(dst, y)};
+    for (int x = y < bh ? bw : 0; x < dw; ++x) {
+      out[x] = rotatedPixel(src, degrees, x, y);
+    }
+  }
+}
+
+/// \brief B, G and R of the 8 pixels at \c in in 16 bit lanes.
+EPIC_SSE2 inline void channels8(const Uint32 *in, __m128i *b, __m128i *g,
+                                __m128i *r) {
+  const __m128i mask = _mm_set1_epi32(0xff);
+  const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+  const __m128i p1 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 4));
+  *b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+  *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                       _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+  *r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                       _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+
+/// \brief lumaOf() of 8 pixels. The sum needs all 16 bits, so it wraps
+///        as signed and is shifted back unsigned.
+EPIC_SSE2 inline __m128i luma8(__m128i b, __m128i g, __m128i r) {
+  const __m128i t = _mm_add_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                    _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+      _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)),
+                    _mm_set1_epi16(128)));
+  return _mm_add_epi16(_mm_srli_epi16(t, 8), _mm_set1_epi16(16));
+}
+
+/// \brief Means of the 2x2 blocks of 16 pixels of two rows, given the
+///        column sums of the first 8 in \c lo and of the last 8 in \c hi.
+EPIC_SSE2 inline __m128i blockMean8(__m128i lo, __m128i hi) {
+  const __m128i mask = _mm_set1_epi32(0xffff);
+  const __m128i pairsLo =
+      _mm_add_epi32(_mm_and_si128(lo, mask), _mm_srli_epi32(lo, 16));
+  const __m128i pairsHi =
+      _mm_add_epi32(_mm_and_si128(hi, mask), _mm_srli_epi32(hi, 16));
+  return _mm_srli_epi16(
+      _mm_add_epi16(_mm_packs_epi32(pairsLo, pairsHi), _mm_set1_epi16(2)), 2);
+}
+
+/// \brief chromaOf() of 8 colours, \c cr, \c cg and \c cb are the
+///        coefficients of the channels.
+EPIC_SSE2 inline __m128i chroma8(__m128i b, __m128i g, __m128i r, short cb,
+                                 short cg, short cr) {
+  const __m128i t = _mm_add_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)),
+                    _mm_mullo_epi16(g, _mm_set1_epi16(cg))),
+      _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(cb)),
+                    _mm_set1_epi16(128)));
+  return _mm_add_epi16(_mm_srai_epi16(t, 8), _mm_set1_epi16(128));
+}
+
+EPIC_SSE2 void yuv420SpanSse2(const Uint32 *in0, const Uint32 *in1, int w,
+                              Uint8 *y0, Uint8 *y1, Uint8 *u, Uint8 *v) {
+  int x{0};
+  for (; x + 16 <= w; x += 16) {
+    __m128i b[4], g[4], r[4];
+    channels8(in0 + x, &b[0], &g[0], &r[0]);
+    channels8(in0 + x + 8, &b[1], &g[1], &r[1]);
+    channels8(in1 + x, &b[2], &g[2], &r[2]);
+    channels8(in1 + x + 8, &b[3], &g[3], &r[3]);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(y0 + x),
+                     _mm_packus_epi16(luma8(b[0], g[0], r[0]),
+                                      luma8(b[1], g[1], r[1])));
+    if (y1 != nullptr) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(y1 + x),
+                       _mm_packus_epi16(luma8(b[2], g[2], r[2]),
+                                        luma8(b[3], g[3], r[3])));
+    }
+
+    const __m128i mb = blockMean8(_mm_add_epi16(b[0], b[2]),
+                                  _mm_add_epi16(b[1], b[3]));
+    const __m128i mg = blockMean8(_mm_add_epi16(g[0], g[2]),
+                                  _mm_add_epi16(g[1], g[3]));
+    const __m128i mr = blockMean8(_mm_add_epi16(r[0], r[2]),
+                                  _mm_add_epi16(r[1], r[3]));
+    const __m128i cu = chroma8(mb, mg, mr, 112, -74, -38);
+    const __m128i cv = chroma8(mb, mg, mr, -18, -94, 112);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2),
+                     _mm_packus_epi16(cu, cu));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2),
+                     _mm_packus_epi16(cv, cv));
+  }
+  yuv420SpanScalar(in0, in1, x, w, y0, y1, u, v);
+}
+
+void argbToYuv420Sse2(const SDL_Surface *src, Uint8 *y, Uint8 *u, Uint8 *v) {
+  argbToYuv420With(src, y, u, v, yuv420SpanSse2);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// AVX2, on top of the SSE2 rotation and YUV conversion.
+////////////////////////////////////////////////////////////////////////////
+
+EPIC_AVX2 void rgb24ToArgbAvx2(const Uint8 *src, Uint32 *dst, int count) {
+  // R, G, B of four pixels per 128 bit lane to B, G, R, 0.
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4,
+      3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+  const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+  int i{0};
+  // Each 16 byte load reads 4 bytes past its 4 pixels.
+  for (; i + 10 <= count; i += 8) {
+    const Uint8 *p{src + i * 3};
+    const __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)), 1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle),
+                                        opaque));
+  }
+  rgb24ToArgbScalar(src + i * 3, dst + i, count - i);
+}
+
+EPIC_AVX2 inline __m256i premultiply16Avx2(__m256i c) {
+  const __m256i colour =
+      _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1,
+                       -1);
+  const __m256i opaque = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0,
+                                          0, 0, 255, 0, 0, 0);
+  const __m256i alpha = _mm256_shufflehi_epi16(
+      _mm256_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  const __m256i a = _mm256_or_si256(_mm256_and_si256(alpha, colour), opaque);
+
+  const __m256i t =
+      _mm256_add_epi16(_mm256_mullo_epi16(c, a), _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+EPIC_AVX2 void premultiplyAvx2(Uint32 *pixels, int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  int i{0};
+  for (; i + 8 <= count; i += 8) {
+    __m256i *p{reinterpret_cast<__m256i *>(pixels + i)};
+    const __m256i v = _mm256_loadu_si256(p);
+    // Unpacking and packing both stay within the 128 bit lanes, which
+    // keeps the pixels in order.
+    _mm256_storeu_si256(
+        p, _mm256_packus_epi16(
+               premultiply16Avx2(_mm256_unpacklo_epi8(v, zero)),
+               premultiply16Avx2(_mm256_unpackhi_epi8(v, zero))));
+  }
+  premultiplyScalar(pixels + i, count - i);
+}
+
+EPIC_AVX2 void areaSumAvx2(const SDL_Surface *src, int x0, int x1, int y0,
+                           int y1, Uint32 *sums) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = zero;
+  __m128i tail = _mm_setzero_si128();
+  for (int y = y0; y < y1; ++y) {
+    const Uint32 *in{row<const Uint32>(src, y)};
+    int x{x0};
+    for (; x + 8 <= x1; x += 8) {
+      const __m256i p =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+      const __m256i s = _mm256_add_epi16(_mm256_unpacklo_epi8(p, zero),
+                                         _mm256_unpackhi_epi8(p, zero));
+      acc = _mm256_add_epi32(acc,
+                             _mm256_add_epi32(_mm256_unpacklo_epi16(s, zero),
+                                              _mm256_unpackhi_epi16(s, zero)));
+    }
+    for (; x + 4 <= x1; x += 4) {
+      const __m128i p =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x));
+      const __m128i s =
+          _mm_add_epi16(_mm_cvtepu8_epi16(p),
+                        _mm_cvtepu8_epi16(_mm_srli_si128(p, 8)));
+      tail = _mm_add_epi32(tail, _mm_add_epi32(_mm_cvtepu16_epi32(s),
+                                               _mm_cvtepu16_epi32(
+                                                   _mm_srli_si128(s, 8))));
+    }
+    for (; x < x1; ++x) {
+      tail = _mm_add_epi32(
+          tail, _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(in[x]))));
+    }
+  }
+  tail = _mm_add_epi32(tail, _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                           _mm256_extracti128_si256(acc, 1)));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), tail);
+}
+
+void downscaleAreaAvx2(const SDL_Surface *src, SDL_Surface *dst) {
+  downscaleAreaWith(src, dst, areaSumAvx2);
+}
+
+EPIC_AVX2 void horizontalAvx2(const Uint32 *in, const Taps &taps,
+                              float *out) {
+  const int n{taps.n};
+  for (size_t x = 0; x < taps.start.size(); ++x) {
+    const Uint32 *p{in + taps.start[x]};
+    const float *w{&taps.weights[x * n]};
+    // Two taps at a time, one per 128 bit lane.
+    __m256 acc = _mm256_setzero_ps();
+    int k{0};
+    for (; k + 2 <= n; k += 2) {
+      const __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + k))));
+      const __m256 wk = _mm256_insertf128_ps(
+          _mm256_castps128_ps256(_mm_set1_ps(w[k])), _mm_set1_ps(w[k + 1]), 1);
+      acc = _mm256_add_ps(acc, _mm256_mul_ps(c, wk));
+    }
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc),
+                            _mm256_extractf128_ps(acc, 1));
+    if (k < n) {
+      const __m128 c = _mm_cvtepi32_ps(
+          _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(p[k]))));
+      sum = _mm_add_ps(sum, _mm_mul_ps(c, _mm_set1_ps(w[k])));
+    }
+    _mm_storeu_ps(out + x * 4, sum);
+  }
+}
+
+EPIC_AVX2 void verticalAvx2(const float *const *rows, const float *weights,
+                            int n, int width, Uint32 *out) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  // packs and packus interleave the lanes, pixels 0, 2, 4, 6, 1, 3, 5, 7.
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int x{0};
+  for (; x + 8 <= width; x += 8) {
+    __m256 acc[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(),
+                     _mm256_setzero_ps(), _mm256_setzero_ps()};
+    for (int k = 0; k < n; ++k) {
+      const __m256 w = _mm256_set1_ps(weights[k]);
+      for (int j = 0; j < 4; ++j) {
+        acc[j] = _mm256_add_ps(
+            acc[j], _mm256_mul_ps(_mm256_loadu_ps(rows[k] + (x + j * 2) * 4),
+                                  w));
+      }
+    }
+    __m256i c[4];
+    for (int j = 0; j < 4; ++j) {
+      c[j] = _mm256_cvttps_epi32(_mm256_add_ps(acc[j], half));
+    }
+    const __m256i packed =
+        _mm256_packus_epi16(_mm256_packs_epi32(c[0], c[1]),
+                            _mm256_packs_epi32(c[2], c[3]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x),
+                        _mm256_permutevar8x32_epi32(packed, order));
+  }
+  for (; x < width; ++x) {
+    __m128 acc = _mm_setzero_ps();
+    for (int k = 0; k < n; ++k) {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[k] + x * 4),
+                                       _mm_set1_ps(weights[k])));
+    }
+    out[x] = floatsToPixel(acc);
+  }
+}
+
+void downscaleLanczosAvx2(const SDL_Surface *src, SDL_Surface *dst) {
+  lanczosResample(src, dst, horizontalAvx2, verticalAvx2);
+}
+#endif // EPIC_KERNELS_X86
+
+#ifdef EPIC_KERNELS_NEON
+////////////////////////////////////////////////////////////////////////////
+// NEON, the channel (de)interleaving loads and stores do most of the work.
+////////////////////////////////////////////////////////////////////////////
+
+void rgb24ToArgbNeon(const Uint8 *src, Uint32 *dst, int count) {
+  int i{0};
+  for (; i + 16 <= count; i += 16) {
+    const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+    uint8x16x4_t bgra;
+    bgra.val[0] = rgb.val[2];
+    bgra.val[1] = rgb.val[1];
+    bgra.val[2] = rgb.val[0];
+    bgra.val[3] = vdupq_n_u8(0xff);
+    vst4q_u8(reinterpret_cast<Uint8 *>(dst + i), bgra);
+  }
+  rgb24ToArgbScalar(src + i * 3, dst + i, count - i);
+}
+
+/// \brief c * a / 255 for 8 channels, rounded.
+inline uint8x8_t mulAlphaNeon(uint8x8_t c, uint8x8_t a) {
+  const uint16x8_t t = vaddq_u16(vmull_u8(c, a), vdupq_n_u16(128));
+  return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+void premultiplyNeon(Uint32 *pixels, int count) {
+  int i{0};
+  for (; i + 8 <= count; i += 8) {
+    Uint8 *p{reinterpret_cast<Uint8 *>(pixels + i)};
+    uint8x8x4_t bgra = vld4_u8(p);
+    for (int c = 0; c < 3; ++c) {
+      bgra.val[c] = mulAlphaNeon(bgra.val[c], bgra.val[3]);
+    }
+    vst4_u8(p, bgra);
+  }
+  premultiplyScalar(pixels + i, count - i);
+}
+#endif // EPIC_KERNELS_NEON
+
+const PixelKernels SCALAR_KERNELS{rgb24ToArgbScalar, premultiplyScalar,
+                                  downscaleAreaScalar, downscaleLanczosScalar,
+                                  rotateScalar, argbToYuv420Scalar,
+                                  PixelKernels::Isa::Scalar};
+#ifdef EPIC_KERNELS_X86
+const PixelKernels SSE2_KERNELS{rgb24ToArgbScalar, premultiplySse2,
+                                downscaleAreaSse2, downscaleLanczosSse2,
+                                rotateSse2, argbToYuv420Sse2,
+                                PixelKernels::Isa::SSE2};
+const PixelKernels AVX2_KERNELS{rgb24ToArgbAvx2, premultiplyAvx2,
+                                downscaleAreaAvx2, downscaleLanczosAvx2,
+                                rotateSse2, argbToYuv420Sse2,
+                                PixelKernels::Isa::AVX2};
+#endif
+#ifdef EPIC_KERNELS_NEON
+const PixelKernels NEON_KERNELS{rgb24ToArgbNeon, premultiplyNeon,
+                                downscaleAreaScalar, downscaleLanczosScalar,
+                                rotateScalar, argbToYuv420Scalar,
+                                PixelKernels::Isa::NEON};
+#endif
+
+const PixelKernels *pickBest() {
+  for (auto isa : {PixelKernels::Isa::AVX2, PixelKernels::Isa::NEON,
+                   PixelKernels::Isa::SSE2}) {
+    if (const PixelKernels *kernels = PixelKernels::get(isa))
+      return kernels;
+  }
+  return &SCALAR_KERNELS;
+}
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+const PixelKernels &PixelKernels::best() {
+  static const PixelKernels *kernels{pickBest()};
+  return *kernels;
+}
+
+////////////////////////////////////////////////////////////////////////////
+const PixelKernels &PixelKernels::scalar() { return SCALAR_KERNELS; }
+
+////////////////////////////////////////////////////////////////////////////
+const PixelKernels *PixelKernels::get(Isa isa) {
+  switch (isa) {
+  case Isa::Scalar:
+    return &SCALAR_KERNELS;
+#ifdef EPIC_KERNELS_X86
+  case Isa::SSE2:
+    return SDL_HasSSE2() ? &SSE2_KERNELS : nullptr;
+  case Isa::AVX2:
+    return SDL_HasAVX2() ? &AVX2_KERNELS : nullptr;
+#endif
+#ifdef EPIC_KERNELS_NEON
+  case Isa::NEON:
+    return &NEON_KERNELS;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+const char *PixelKernels::name(Isa isa) {
+  switch (isa) {
+  case Isa::SSE2:
+    return "sse2";
+  case Isa::AVX2:
+    return "avx2";
+  case Isa::NEON:
+    return "neon";
+  default:
+    return "scalar";
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef epic_pixelkernels_h__
+#define epic_pixelkernels_h__
+
+#include <SDL.h>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief The pixel loops of the image loader, in SSE2, AVX2 and NEON
+///        variants next to a scalar reference.
+///
+/// Surfaces are ARGB8888 and must not need locking. best() picks the
+/// variants once, with SDL_HasAVX2() and SDL_HasSSE2(); NEON is decided at
+/// compile time. A variant without a vector version of a kernel uses the
+/// scalar one. Every variant gives the same pixels as scalar(), except that
+/// the AVX2 downscaleLanczos() sums in another order and may be off by one.
+////////////////////////////////////////////////////////////////////////////
+struct PixelKernels {
+  enum class Isa { Scalar, SSE2, AVX2, NEON };
+
+  /// \brief RGB24 (bytes R, G, B) to opaque ARGB8888, \c count pixels.
+  void (*rgb24ToArgb)(const Uint8 *src, Uint32 *dst, int count);
+
+  /// \brief Multiply the colour channels of \c count pixels with their
+  ///        alpha, rounded, in place.
+  void (*premultiply)(Uint32 *pixels, int count);
+
+  /// \brief Every pixel of \c dst is the mean of the pixels of \c src it
+  ///        covers. \c dst is no larger than \c src.
+  void (*downscaleArea)(const SDL_Surface *src, SDL_Surface *dst);
+
+  /// \brief Lanczos-3 resample of \c src to the size of \c dst. Sharper than
+  ///        downscaleArea() where it shrinks by less than 2x.
+  void (*downscaleLanczos)(const SDL_Surface *src, SDL_Surface *dst);
+
+  /// \brief Rotate \c src clockwise by 0, 90, 180 or 270 \c degrees into
+  ///        \c dst, which has the rotated dimensions.
+  void (*rotate)(const SDL_Surface *src, SDL_Surface *dst, int degrees);
+
+  /// \brief \c src to the planes of SDL_PIXELFORMAT_IYUV in BT.601 video
+  ///        range, alpha is ignored. \c y has \c src->w x \c src->h
+  ///        samples, \c u and \c v half that rounded up, all tightly
+  ///        packed. Chroma is taken from the mean of each 2x2 block.
+  void (*argbToYuv420)(const SDL_Surface *src, Uint8 *y, Uint8 *u, Uint8 *v);
+
+  Isa isa;
+
+  /// \brief The fastest kernels this CPU runs.
+  static const PixelKernels &best();
+
+  /// \brief The reference kernels.
+  static const PixelKernels &scalar();
+
+  /// \brief The kernels of \c isa, nullptr if they were not compiled in or
+  ///        the CPU does not run them.
+  static const PixelKernels *get(Isa isa);
+
+  /// \brief "scalar", "sse2", "avx2" or "neon".
+  static const char *name(Isa isa);
+};
+
+#endif // ! epic_pixelkernels_h__
@@ -0,0 +1,113 @@
+#include "pngdecoder.h"
+
+#include <cstring>
+
+namespace {
+const Uint8 PNG_SIGNATURE[]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+bool isPNG(const Uint8 *data, size_t size) {
+  return size >= sizeof(PNG_SIGNATURE) &&
+         std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0;
+}
+
+#ifdef EPIC_LIBPNG
+#include <png.h>
+
+namespace {
+/// Where png_read_*() reads the file from.
+struct MemoryReader {
+  const Uint8 *data;
+  size_t size;
+  size_t pos;
+};
+
+void readMemory(png_structp png, png_bytep out, png_size_t length) {
+  MemoryReader *reader{static_cast<MemoryReader *>(png_get_io_ptr(png))};
+  if (length > reader->size - reader->pos)
+    png_error(png, "Read past the end of the file");
+  std::memcpy(out, reader->data + reader->pos, length);
+  reader->pos += length;
+}
+
+/// \brief libpng returns here instead of printing and aborting.
+void onError(png_structp png, png_const_charp) { png_longjmp(png, 1); }
+
+/// \brief Drop warnings rather than printing them from a worker thread.
+void onWarning(png_structp, png_const_charp) {}
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *decodePNG(const Uint8 *data, size_t size, const SDL_Point &,
+                       SDL_Point *fullDims) {
+  png_structp png{png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                         onError, onWarning)};
+  if (png == nullptr)
+    return nullptr;
+  png_infop info{png_create_info_struct(png)};
+  if (info == nullptr) {
+    png_destroy_read_struct(&png, nullptr, nullptr);
+    return nullptr;
+  }
+
+  MemoryReader reader{data, size, 0};
+  // Set after the setjmp(), so volatile to survive the longjmp().
+  SDL_Surface *volatile argb{nullptr};
+  if (setjmp(png_jmpbuf(png))) {
+    SDL_FreeSurface(argb);
+    png_destroy_read_struct(&png, &info, nullptr);
+    return nullptr;
+  }
+
+  png_set_read_fn(png, &reader, readMemory);
+  png_read_info(png, info);
+
+  png_uint_32 w, h;
+  int depth, colorType;
+  png_get_IHDR(png, info, &w, &h, &depth, &colorType, nullptr, nullptr,
+               nullptr);
+  *fullDims = {static_cast<int>(w), static_cast<int>(h)};
+
+  // Everything becomes 8 bit per channel RGB with alpha...
+  if (depth == 16)
+    png_set_strip_16(png);
+  if (colorType == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb(png);
+  if (colorType == PNG_COLOR_TYPE_GRAY && depth < 8)
+    png_set_expand_gray_1_2_4_to_8(png);
+  if (png_get_valid(png, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(png);
+  if (colorType == PNG_COLOR_TYPE_GRAY ||
+      colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+    png_set_gray_to_rgb(png);
+  // ...in the byte order of ARGB8888, opaque where there was no alpha.
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+  png_set_bgr(png);
+  png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+#else
+  png_set_swap_alpha(png);
+  png_set_filler(png, 0xff, PNG_FILLER_BEFORE);
+#endif
+  const int passes{png_set_interlace_handling(png)};
+  png_read_update_info(png, info);
+
+  argb = SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00,
+                              0x000000ff, 0xff000000);
+  if (argb == nullptr) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return nullptr;
+  }
+
+  for (int pass = 0; pass < passes; ++pass) {
+    for (png_uint_32 y = 0; y < h; ++y) {
+      png_read_row(png, static_cast<Uint8 *>(argb->pixels) + y * argb->pitch,
+                   nullptr);
+    }
+  }
+
+  png_read_end(png, nullptr);
+  png_destroy_read_struct(&png, &info, nullptr);
+  return argb;
+}
+#endif // EPIC_LIBPNG
@@ -0,0 +1,25 @@
+#ifndef epic_pngdecoder_h__
+#define epic_pngdecoder_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+
+/// \brief True if \c data starts with the PNG signature.
+bool isPNG(const Uint8 *data, size_t size);
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Decode the PNG file \c data into an ARGB8888 surface.
+///
+/// libpng converts every colour type and bit depth to 8 bit BGRA and reads
+/// the rows straight into the surface. The image is always decoded at full
+/// resolution, \c box is not used. Only built with EPIC_LIBPNG, see
+/// CodecRegistry.
+///
+/// \param fullDims Set to the dimensions of the image.
+/// \return nullptr if decoding failed.
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *decodePNG(const Uint8 *data, size_t size, const SDL_Point &box,
+                       SDL_Point *fullDims);
+
+#endif // ! epic_pngdecoder_h__
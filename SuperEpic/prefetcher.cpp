@@ -0,0 +1,87 @@
+#include "prefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/// Weight of the newest sample in the smoothed velocity.
+const float VELOCITY_SMOOTHING{0.3f};
+
+/// Shortest interval between two shifts used for the velocity, shifts that
+/// arrive in the same frame would otherwise look infinitely fast.
+const Uint32 MIN_SHIFT_INTERVAL_MS{16};
+
+/// Without a shift for this long the user counts as standing still.
+const Uint32 IDLE_MS{300};
+
+/// How far into the future lookAhead() covers at the current velocity.
+const float LOOK_AHEAD_SECONDS{1.0f};
+} // namespace
+
+const int Prefetcher::BASE_RADIUS;
+const int Prefetcher::MAX_LOOK_AHEAD;
+
+////////////////////////////////////////////////////////////////////////////
+Prefetcher::Prefetcher()
+    : m_velocity{0.0f}, m_direction{0}, m_lastShift{0}, m_hits{0},
+      m_misses{0} {}
+
+////////////////////////////////////////////////////////////////////////////
+Prefetcher::~Prefetcher() {}
+
+////////////////////////////////////////////////////////////////////////////
+void Prefetcher::onShift(int dx, Uint32 ticks) {
+  if (dx == 0)
+    return;
+
+  const int direction{dx < 0 ? 1 : -1};
+  const Uint32 interval{ticks - m_lastShift};
+  const float speed{std::abs(dx) * 1000.0f /
+                    std::max(MIN_SHIFT_INTERVAL_MS, interval)};
+
+  if (direction != m_direction || interval > IDLE_MS) {
+    // Starting to move, or turned around: the old velocity means nothing.
+    m_velocity = speed;
+  } else {
+    m_velocity += VELOCITY_SMOOTHING * (speed - m_velocity);
+  }
+
+  m_direction = direction;
+  m_lastShift = ticks;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Prefetcher::update(Uint32 ticks) {
+  if (ticks - m_lastShift > IDLE_MS)
+    m_velocity = 0.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////
+int Prefetcher::lookAhead(int imageWidth) const {
+  if (imageWidth <= 0)
+    return BASE_RADIUS;
+
+  const float images{m_velocity * LOOK_AHEAD_SECONDS / imageWidth};
+  return std::min(MAX_LOOK_AHEAD,
+                  BASE_RADIUS + static_cast<int>(std::ceil(images)));
+}
+
+////////////////////////////////////////////////////////////////////////////
+int Prefetcher::lookBehind() const {
+  return m_velocity > 0.0f ? 1 : BASE_RADIUS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Prefetcher::recordArrival(bool resident) {
+  if (resident) {
+    ++m_hits;
+  } else {
+    ++m_misses;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+float Prefetcher::hitRate() const {
+  const size_t total{m_hits + m_misses};
+  return total == 0 ? 1.0f : m_hits / static_cast<float>(total);
+}
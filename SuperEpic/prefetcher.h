@@ -0,0 +1,71 @@
+#ifndef epic_prefetcher_h__
+#define epic_prefetcher_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Predicts which gallery images are needed next from the way the
+///        user is panning.
+///
+/// The renderer reports every gallery shift with onShift(). The prefetcher
+/// keeps a smoothed pan velocity and direction, from which lookAhead() and
+/// lookBehind() tell how many images on either side of the visible window
+/// should be loaded. The faster the pan, the further ahead; the side the
+/// user is moving away from only keeps its nearest neighbour.
+///
+/// Whether images were resident when they scrolled into view is counted by
+/// recordArrival(), hitRate() is what to tune the constants against.
+////////////////////////////////////////////////////////////////////////////
+class Prefetcher {
+public:
+  /// Images kept on either side of the visible window when not moving.
+  static const int BASE_RADIUS = 4;
+  /// Upper bound for lookAhead().
+  static const int MAX_LOOK_AHEAD = 24;
+
+  Prefetcher();
+  ~Prefetcher();
+
+  /// \brief Record a gallery shift of \c dx pixels at \c ticks ms, with the
+  ///        sign convention of Renderer::shiftCandidates(): negative moves
+  ///        towards higher indices.
+  void onShift(int dx, Uint32 ticks);
+
+  /// \brief Drop the velocity once no shift was seen for a while.
+  void update(Uint32 ticks);
+
+  /// \brief +1 when moving towards higher indices, -1 towards lower ones,
+  ///        0 if not moved yet. Keeps the last direction when idle.
+  int direction() const { return m_direction; }
+
+  /// \brief Smoothed pan speed in pixels per second.
+  float velocity() const { return m_velocity; }
+
+  /// \brief Images to load past the visible window in direction().
+  /// \param imageWidth On-screen width of one gallery image in pixels.
+  int lookAhead(int imageWidth) const;
+
+  /// \brief Images to load on the other side of the visible window.
+  int lookBehind() const;
+
+  /// \brief Count an image that scrolled into view, \c resident if it had
+  ///        its gallery texture by then.
+  void recordArrival(bool resident);
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+  /// \brief Fraction of arrivals that were resident, 1 if there were none.
+  float hitRate() const;
+
+private:
+  float m_velocity;
+  int m_direction;
+  Uint32 m_lastShift; ///< SDL ticks of the last onShift().
+  size_t m_hits;
+  size_t m_misses;
+};
+
+#endif // ! epic_prefetcher_h__
@@ -0,0 +1,310 @@
+#include "proxycache.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+const Uint32 CACHE_MAGIC{0x43504553}; // "SEPC"
+const Uint32 CACHE_VERSION{1};
+const char *CACHE_EXTENSION{".sepc"};
+
+/// Anything bigger than this in an entry header means the file is garbage.
+const Uint32 MAX_PROXY_DIM{16384};
+
+/// \brief Fast non-cryptographic hash, works on 8 bytes at a time.
+Uint64 hash64(const void *data, size_t len, Uint64 seed) {
+  const Uint8 *p{static_cast<const Uint8 *>(data)};
+  Uint64 h{seed ^ (len * 0x9E3779B97F4A7C15ULL)};
+
+  size_t i{0};
+  for (; i + 8 <= len; i += 8) {
+    Uint64 w;
+    SDL_memcpy(&w, p + i, 8);
+    h ^= w;
+    h *= 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+  }
+  for (; i < len; ++i) {
+    h ^= p[i];
+    h *= 0x100000001B3ULL;
+  }
+
+  return h ^ (h >> 32);
+}
+
+/// \brief Hash the pixel rows of \c surf, skipping the pitch padding.
+Uint64 hashPixels(SDL_Surface *surf) {
+  const size_t rowBytes{static_cast<size_t>(surf->w) * 4};
+  Uint64 h{0};
+  for (int y = 0; y < surf->h; ++y) {
+    h = hash64(static_cast<Uint8 *>(surf->pixels) + y * surf->pitch, rowBytes,
+               h);
+  }
+  return h;
+}
+
+bool readLE32(SDL_RWops *rw, Uint32 *v) {
+  Uint32 le;
+  if (SDL_RWread(rw, &le, sizeof(le), 1) != 1)
+    return false;
+  *v = SDL_SwapLE32(le);
+  return true;
+}
+
+bool readLE64(SDL_RWops *rw, Uint64 *v) {
+  Uint64 le;
+  if (SDL_RWread(rw, &le, sizeof(le), 1) != 1)
+    return false;
+  *v = SDL_SwapLE64(le);
+  return true;
+}
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+ProxyCache::ProxyCache(const std::string &dir)
+    : m_dir{dir}, m_hits{0}, m_misses{0} {
+  if (m_dir.empty()) {
+    // Creates the directory if it does not exist yet.
+    char *pref{SDL_GetPrefPath("SuperEpic", "ProxyCache")};
+    if (pref != nullptr) {
+      m_dir = pref;
+      SDL_free(pref);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+ProxyCache::~ProxyCache() {}
+
+////////////////////////////////////////////////////////////////////////////
+std::string ProxyCache::makeKey(const std::string &path,
+                                const std::string &entry) const {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return "";
+
+  std::ostringstream key;
+  key << path << '|' << static_cast<long long>(st.st_size) << '|'
+      << static_cast<long long>(st.st_mtime) << '|' << entry;
+  return key.str();
+}
+
+////////////////////////////////////////////////////////////////////////////
+std::string ProxyCache::entryPath(const std::string &key) const {
+  char name[17];
+  SDL_snprintf(name, sizeof(name), "%016llx",
+               static_cast<unsigned long long>(
+                   hash64(key.data(), key.size(), 0)));
+  return m_dir + name + CACHE_EXTENSION;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *ProxyCache::load(const std::string &path,
+                              const std::string &entry, SDL_Point *srcDims) {
+  std::string key{isValid() ? makeKey(path, entry) : ""};
+  SDL_RWops *rw{key.empty() ? nullptr
+                            : SDL_RWFromFile(entryPath(key).c_str(), "rb")};
+  if (rw == nullptr) {
+    ++m_misses;
+    return nullptr;
+  }
+
+  SDL_Surface *surf{nullptr};
+  Uint32 magic, version, keyLen, srcW, srcH, w, h;
+  Uint64 hash;
+  bool ok{readLE32(rw, &magic) && magic == CACHE_MAGIC &&
+          readLE32(rw, &version) && version == CACHE_VERSION &&
+          readLE32(rw, &keyLen) && keyLen == key.size()};
+
+  if (ok) {
+    // Two different keys can hash to the same file name, compare the key.
+    std::string stored(keyLen, '\0');
+    ok = SDL_RWread(rw, &stored[0], 1, keyLen) == keyLen && stored == key;
+  }
+
+  ok = ok && readLE32(rw, &srcW) && readLE32(rw, &srcH) && readLE32(rw, &w) &&
+       readLE32(rw, &h) && readLE64(rw, &hash) && w > 0 && h > 0 &&
+       w <= MAX_PROXY_DIM && h <= MAX_PROXY_DIM;
+
+  if (ok) {
+    surf = SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00,
+                                0x000000ff, 0xff000000);
+    ok = surf != nullptr;
+  }
+
+  for (int y = 0; ok && y < static_cast<int>(h); ++y) {
+    ok = SDL_RWread(rw, static_cast<Uint8 *>(surf->pixels) + y * surf->pitch,
+                    w * 4, 1) == 1;
+  }
+
+  ok = ok && hashPixels(surf) == hash;
+  SDL_RWclose(rw);
+
+  if (!ok) {
+    SDL_FreeSurface(surf);
+    ++m_misses;
+    return nullptr;
+  }
+
+  srcDims->x = srcW;
+  srcDims->y = srcH;
+  ++m_hits;
+  return surf;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ProxyCache::contains(const std::string &path,
+                          const std::string &entry) const {
+  const std::string key{isValid() ? makeKey(path, entry) : ""};
+  struct stat st;
+  return !key.empty() && stat(entryPath(key).c_str(), &st) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool ProxyCache::store(const std::string &path, const std::string &entry,
+                       const SDL_Point &srcDims, SDL_Surface *proxy) {
+  std::string key{isValid() ? makeKey(path, entry) : ""};
+  if (key.empty() || proxy == nullptr)
+    return false;
+
+  // Write to a temporary file first so a crash never leaves half an entry.
+  const std::string file{entryPath(key)};
+  std::ostringstream tmp;
+  tmp << file << '.' << std::hash<std::thread::id>()(std::this_thread::get_id())
+      << ".tmp";
+
+  SDL_RWops *rw{SDL_RWFromFile(tmp.str().c_str(), "wb")};
+  if (rw == nullptr)
+    return false;
+
+  bool ok{SDL_WriteLE32(rw, CACHE_MAGIC) && SDL_WriteLE32(rw, CACHE_VERSION) &&
+          SDL_WriteLE32(rw, static_cast<Uint32>(key.size())) &&
+          SDL_RWwrite(rw, key.data(), 1, key.size()) == key.size() &&
+          SDL_WriteLE32(rw, srcDims.x) && SDL_WriteLE32(rw, srcDims.y) &&
+          SDL_WriteLE32(rw, proxy->w) && SDL_WriteLE32(rw, proxy->h) &&
+          SDL_WriteLE64(rw, hashPixels(proxy))};
+
+  for (int y = 0; ok && y < proxy->h; ++y) {
+    ok = SDL_RWwrite(rw, static_cast<Uint8 *>(proxy->pixels) + y * proxy->pitch,
+                     proxy->w * 4, 1) == 1;
+  }
+  SDL_RWclose(rw);
+
+  std::remove(file.c_str()); // rename() does not overwrite on Windows.
+  if (!ok || std::rename(tmp.str().c_str(), file.c_str()) != 0) {
+    std::remove(tmp.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ProxyCache::forEachEntry(
+    const std::function<void(const std::string &, size_t, Uint64)> &fn)
+    const {
+  if (!isValid())
+    return;
+
+#ifdef WIN32
+  WIN32_FIND_DATA ffd;
+  HANDLE hFind{FindFirstFile((m_dir + "*").c_str(), &ffd)};
+  if (hFind == INVALID_HANDLE_VALUE)
+    return;
+  do {
+    if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+        endsWith(ffd.cFileName, CACHE_EXTENSION)) {
+      fn(ffd.cFileName,
+         static_cast<size_t>((static_cast<Uint64>(ffd.nFileSizeHigh) << 32) |
+                             ffd.nFileSizeLow),
+         (static_cast<Uint64>(ffd.ftLastWriteTime.dwHighDateTime) << 32) |
+             ffd.ftLastWriteTime.dwLowDateTime);
+    }
+  } while (FindNextFile(hFind, &ffd) != 0);
+  FindClose(hFind);
+#else
+  DIR *d{opendir(m_dir.c_str())};
+  if (d == nullptr)
+    return;
+  while (dirent *e = readdir(d)) {
+    struct stat st;
+    if (endsWith(e->d_name, CACHE_EXTENSION) &&
+        stat((m_dir + e->d_name).c_str(), &st) == 0) {
+      fn(e->d_name, static_cast<size_t>(st.st_size),
+         static_cast<Uint64>(st.st_mtime));
+    }
+  }
+  closedir(d);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t ProxyCache::diskBytes() const {
+  size_t bytes{0};
+  forEachEntry([&bytes](const std::string &, size_t size, Uint64) {
+    bytes += size;
+  });
+  return bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void ProxyCache::clear() {
+  std::vector<std::string> names;
+  forEachEntry([&names](const std::string &name, size_t, Uint64) {
+    names.push_back(name);
+  });
+
+  for (auto &name : names) {
+    std::remove((m_dir + name).c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t ProxyCache::prune(size_t maxBytes) {
+  struct File {
+    std::string name;
+    size_t size;
+    Uint64 time;
+  };
+  std::vector<File> files;
+  size_t bytes{0};
+  forEachEntry([&](const std::string &name, size_t size, Uint64 time) {
+    files.push_back({name, size, time});
+    bytes += size;
+  });
+  if (bytes <= maxBytes)
+    return 0;
+
+  std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+    return a.time < b.time;
+  });
+
+  // A lost pyramid tile is noticed when it is loaded, see ImageLoader.
+  size_t removed{0};
+  for (auto &file : files) {
+    if (bytes <= maxBytes)
+      break;
+    if (std::remove((m_dir + file.name).c_str()) == 0) {
+      bytes -= file.size;
+      ++removed;
+    }
+  }
+  return removed;
+}
@@ -0,0 +1,82 @@
+#ifndef epic_proxycache_h__
+#define epic_proxycache_h__
+
+#include <SDL.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief On-disk cache of downscaled image proxies and pyramid tiles.
+///
+/// Entries are keyed by the source path, its file size and modification
+/// time and an entry name chosen by the caller, e.g. the proxy level and the
+/// box it was fit into. Each entry is one file holding the key, the source
+/// image dimensions, a hash of the pixels that is checked on every read and
+/// the raw ARGB8888 pixels. Stale and corrupt entries are treated as misses
+/// and overwritten. Nothing is removed on its own, prune() keeps the
+/// directory under a size limit.
+///
+/// load(), contains() and store() may be called from any thread.
+////////////////////////////////////////////////////////////////////////////
+class ProxyCache {
+public:
+  /// \param dir Cache directory ending in a path separator. Empty means the
+  ///            SDL pref path for SuperEpic.
+  explicit ProxyCache(const std::string &dir = "");
+  ~ProxyCache();
+
+  /// \brief False if there is no usable cache directory, in which case every
+  ///        load() misses and store() does nothing.
+  bool isValid() const { return !m_dir.empty(); }
+
+  const std::string &dir() const { return m_dir; }
+
+  /// \brief Look up a proxy of the image at \c path.
+  /// \param srcDims Set to the dimensions of the full resolution image.
+  /// \return The cached ARGB8888 surface, nullptr on a miss.
+  SDL_Surface *load(const std::string &path, const std::string &entry,
+                    SDL_Point *srcDims);
+
+  /// \brief True if there is an entry for \c path, without reading it.
+  ///        load() may still miss if the entry turns out to be corrupt.
+  bool contains(const std::string &path, const std::string &entry) const;
+
+  /// \brief Write \c proxy to the cache. \c proxy must be ARGB8888.
+  /// \return False if the entry could not be written.
+  bool store(const std::string &path, const std::string &entry,
+             const SDL_Point &srcDims, SDL_Surface *proxy);
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+  /// \brief Total size of the files in the cache directory.
+  size_t diskBytes() const;
+
+  /// \brief Delete every entry in the cache directory.
+  void clear();
+
+  /// \brief Delete the entries written longest ago until the rest take at
+  ///        most \c maxBytes. Not while other threads use the cache.
+  /// \return The number of entries deleted.
+  size_t prune(size_t maxBytes);
+
+private:
+  /// \brief The key for an entry, empty if \c path can not be stat'ed.
+  std::string makeKey(const std::string &path,
+                      const std::string &entry) const;
+  std::string entryPath(const std::string &key) const;
+  /// \brief Call \c fn with the file name, size and modification time of
+  ///        every cache entry. The time is only good for comparing entries.
+  void forEachEntry(
+      const std::function<void(const std::string &, size_t, Uint64)> &fn)
+      const;
+
+  std::string m_dir;
+  std::atomic<size_t> m_hits;
+  std::atomic<size_t> m_misses;
+};
+
+#endif // ! epic_proxycache_h__
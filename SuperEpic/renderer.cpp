@@ -1,13 +1,12 @@
 #include "renderer.h"
-#include <ctime>
+#include <SDL_image.h>
 
-#ifdef WIN32
-#include "KinectSensor.h"
-#endif
+#include "gesturetracker.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <initializer_list>
 #include <iostream>
 
 namespace {
@@ -21,14 +20,74 @@ const float DEFAULT_CURSOR_SPEED{1.0f};
 
 const int NUM_IMAGES_TO_DRAW{6};
 
+/// Queued gallery loads this many images past the prefetch range are
+/// dropped, a little slack keeps a jittery pan from cancelling and
+/// requeueing the same image.
+const int CANCEL_MARGIN{2};
+
+/// Load priority of the strip thumbnails, after every gallery image. Strip
+/// requests are never cancelled, every image is in the thumbnail strip.
+const int STRIP_PRIORITY{1000};
+
+/// Textures created per frame from decoded images, keeps the loop responsive
+/// while the loader is still busy.
+const int MAX_UPLOADS_PER_FRAME{4};
+
+/// Images with a side longer than this are shown from a TilePyramid rather
+/// than a single full resolution texture.
+const int PYRAMID_MIN_DIMENSION{4096};
+
+/// Default for Renderer::proxyCacheLimit().
+const size_t DEFAULT_PROXY_CACHE_BYTES{size_t{2} * 1024 * 1024 * 1024};
+
+/// Default for Renderer::textureBudget().
+const size_t DEFAULT_TEXTURE_BUDGET_BYTES{512 * 1024 * 1024};
+
+/// Above this fraction of the texture budget, proxies of images off screen
+/// are uploaded in the compact tier, see Renderer::proxyTier().
+const double COMPACT_PRESSURE{0.5};
+
+/// Thumbnail strip proxies are never made narrower than this.
+const int MIN_STRIP_PROXY_WIDTH{16};
+
+/// Aspect ratio (w / h) used to lay out images that are still loading.
+const float PLACEHOLDER_ASPECT_RATIO{4.0f / 3.0f};
+
 // const char *DEFAULT_CURSOR_TEXTURE_PATH{"../res/open_hand.png"};
 // const char *DEFAULT_CURSOR_RING_TEXTURE_PATH{
 // "../res/circle_section_white.png" };
 const float DEFAULT_CURSOR_RING_CYCLE_SECONDS{1.0f};
 const int DEFAULT_WILLING_TO_QUIT{60};
+
+/// Longest the render-on-demand loop sleeps, so that timed state such as
+/// the prefetch velocity is still updated when nothing happens.
+const Uint32 IDLE_WAIT_MS{250};
+/// Refresh interval assumed if the display does not tell.
+const float DEFAULT_REFRESH_MS{1000.0f / 60.0f};
+/// paceFrame() plans for frames this much slower than the average, plus
+/// PACING_MARGIN_MS, so that a slow frame still makes the vsync.
+const double PACING_COST_FACTOR{1.5};
+const double PACING_MARGIN_MS{2.0};
+/// Weight of the newest frame in the average frame cost.
+const double FRAME_COST_ALPHA{0.1};
+
+bool samePoint(const SDL_Point &a, const SDL_Point &b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+/// \brief Copy of \c boxes with every proxy not in \c keep switched off.
+ImageLoader::ProxyBoxes onlyProxies(const ImageLoader::ProxyBoxes &boxes,
+                                    std::initializer_list<Image::Proxy> keep) {
+  ImageLoader::ProxyBoxes only{};
+  for (auto p : keep) {
+    only[static_cast<int>(p)] = boxes[static_cast<int>(p)];
+  }
+  return only;
+}
 } // namespace
 
 bool Renderer::m_shouldQuit = false;
+Uint32 Renderer::m_sensorEvent = 0;
 
 ////////////////////////////////////////////////////////////////////////////
 Renderer::Renderer()
@@ -40,9 +99,25 @@ Renderer::Renderer(int winWidth, int winHeight, int winX, int winY)
     : m_window{nullptr}, m_renderer{nullptr}, m_winDims{winWidth, winHeight},
       m_winPos{winX, winY}, m_cursorSpeed{DEFAULT_CURSOR_SPEED},
       m_cursor{nullptr}, m_mode{DisplayMode::Gallery}, m_galleryStartIndex{0},
-      m_images{}, m_imageModeImage{nullptr}, m_fullScreen{false},
+      m_images{}, m_proxyBoxes{}, m_proxyCache{nullptr}, m_loader{nullptr},
+      m_residency{DEFAULT_TEXTURE_BUDGET_BYTES}, m_uploader{nullptr},
+      m_prefetcher{},
+      m_prioritizedStartIndex{0}, m_prioritizedMode{DisplayMode::Gallery},
+      m_imageModeImage{nullptr},
+      m_fullScreen{false},
       m_useKinectForCursorPos{false}, m_imageStartingPos{0}, m_clickCount{0},
-      m_selected{false}, m_willingToQuit{0} //  , m_srcImageRect{ 0, 0, 0, 0 }
+      m_selected{false}, m_willingToQuit{0}, m_renderOnDemand{true},
+      m_dirty{true}, m_loaderEvent{0}, m_framesRendered{0},
+      m_framesSkipped{0}, m_lastStep{0.0f}, m_recorder{nullptr},
+      m_replayer{nullptr}, m_tracker{nullptr}, m_latency{}, m_unpresented{},
+      m_predictor{nullptr}, m_gestureCaptured{0}, m_lateLatch{true},
+      m_framePacing{false}, m_refreshMs{DEFAULT_REFRESH_MS},
+      m_frameCostMs{DEFAULT_REFRESH_MS / 2}, m_lastPresent{0},
+      m_framesPaced{0}, m_pacingMs{0.0},
+      m_startFullScreen{true},
+      m_softwareRenderer{false}, m_proxyCacheDir{},
+      m_proxyCacheLimit{DEFAULT_PROXY_CACHE_BYTES}
+//  , m_srcImageRect{ 0, 0, 0, 0 }
 //  , m_destWindowRect{ 0, 0, 0, 0 }
 //  , m_imageScreenRatio{ 0 }
 //  , m_windowHeightLeastIncrement{ 0 }
@@ -53,6 +128,37 @@ Renderer::Renderer(int winWidth, int winHeight, int winX, int winY)
 
 ////////////////////////////////////////////////////////////////////////////
 Renderer::~Renderer() {
+  // Stop the decode threads before the images they decode for go away.
+  delete m_loader;
+
+  if (m_recorder != nullptr) {
+    std::cout << "Recorded " << m_recorder->count() << " input records\n";
+    delete m_recorder;
+  }
+  delete m_replayer;
+  delete m_predictor;
+
+  if (m_proxyCache != nullptr) {
+    std::cout << "Proxy cache: " << m_proxyCache->hits() << " hits, "
+              << m_proxyCache->misses() << " misses, "
+              << m_proxyCache->diskBytes() / (1024 * 1024) << " MB in "
+              << m_proxyCache->dir() << "\n";
+    delete m_proxyCache;
+  }
+
+  std::cout << "Prefetch: " << m_prefetcher.hits() << " hits, "
+            << m_prefetcher.misses() << " misses ("
+            << static_cast<int>(m_prefetcher.hitRate() * 100) << "%)\n";
+
+  if (m_latency.count(LatencyTracer::Stage::Total) > 0)
+    m_latency.print(std::cout);
+
+  std::cout << "Texture tiers: "
+            << tierBytes(TextureUploader::Tier::Full) / (1024 * 1024)
+            << " MB full, "
+            << tierBytes(TextureUploader::Tier::Compact) / (1024 * 1024)
+            << " MB compact\n";
+
   for (auto img : m_images) {
     delete img;
   }
@@ -60,28 +166,475 @@ Renderer::~Renderer() {
   if (m_cursor != nullptr)
     delete m_cursor;
 
+  if (m_uploader != nullptr) {
+    std::cout << "Uploads: " << m_uploader->streamedCount() << " streamed, "
+              << m_uploader->updatedCount() << " updated ("
+              << m_uploader->stagedCount() << " staged), "
+              << m_uploader->fallbackCount() << " from surfaces, "
+              << m_uploader->yuvCount() << " YUV, "
+              << m_uploader->compactCount() << " compact in "
+              << static_cast<int>(m_uploader->uploadMs()) << " ms\n";
+    delete m_uploader;
+  }
+
   if (m_renderer != nullptr)
     SDL_DestroyRenderer(m_renderer);
 
   if (m_window != nullptr)
     SDL_DestroyWindow(m_window);
 
+  IMG_Quit();
   SDL_Quit();
 }
 
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::loadImages(const std::vector<std::string> &images) {
   for (auto file : images) {
-    Image *texture{Image::load(file)};
-    if (!texture) {
-      std::cerr << "Could not load image texture: " << SDL_GetError()
+    // Placeholders until updateResidency() asks for the real thing.
+    m_images.push_back(new Image());
+    m_imagePaths.push_back(file);
+    m_loadStates.push_back(LoadState::Idle);
+    m_fullRequested.push_back(false);
+  }
+  m_proxyBoxes = getProxyBoxes();
+
+  // Visible images first, then the strip thumbnails for everything else.
+  // Both mostly come straight out of the proxy cache.
+  requireGalleryWindow();
+
+  const ImageLoader::ProxyBoxes strip{
+      onlyProxies(m_proxyBoxes, {Image::Proxy::Strip})};
+  for (size_t i = 0; i < m_images.size(); ++i) {
+    if (m_loadStates[i] == LoadState::Idle) {
+      m_loadStates[i] = LoadState::Requested;
+      m_loader->enqueue(
+          ImageLoader::Request::forImage(i, m_imagePaths[i], false, strip));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+int Renderer::uploadDecodedImages() {
+  ImageLoader::Result r;
+  int uploads{0}, results{0};
+  while (uploads < MAX_UPLOADS_PER_FRAME && m_loader->poll(&r)) {
+    ++results;
+    Image *img{m_images[r.index]};
+    if (r.cancelled) {
+      // Nothing to upload, allow the image to be requested again.
+      if (r.kind != ImageLoader::Kind::Tile) {
+        finishLoad(r);
+      } else if (img->pyramid() != nullptr) {
+        img->pyramid()->setTile(r.tile, nullptr);
+      }
+      continue;
+    }
+
+    ++uploads;
+    if (r.kind == ImageLoader::Kind::Tile) {
+      uploadTile(img, r);
+      continue;
+    }
+
+    finishLoad(r);
+    if (r.kind == ImageLoader::Kind::Pyramid) {
+      if (r.failed) {
+        // Stays on the screen proxy, a single texture this size would not
+        // fit anyway.
+        std::cerr << "Could not build tile pyramid: " << r.path << ": "
+                  << r.error << std::endl;
+      } else {
+        img->setSourceSize(r.dims);
+        if (!setProxies(img, r)) {
+          std::cerr << "Could not load image texture: " << r.path << ": "
+                    << SDL_GetError() << std::endl;
+        }
+        img->setPyramid(new TilePyramid(r.dims));
+        m_residency.add(img);
+      }
+      continue;
+    }
+
+    if (r.failed) {
+      std::cerr << "Could not load image: " << r.path << ": " << r.error
                 << std::endl;
-      return;
+      m_loadStates[r.index] = LoadState::Failed;
+      continue;
     }
-    std::cout << "Loaded image: " << file << "\n";
-    m_images.push_back(texture);
-    Image *thumb = new Image(*texture);
-    m_thumbs.push_back(thumb);
+
+    img->setSourceSize(r.dims);
+    bool ok{true};
+    if (r.surface != nullptr) {
+      ok = img->setSurface(r.surface) && ok;
+    }
+    if (r.yuv != nullptr) {
+      ok = img->setYUV(r.yuv) && ok;
+    }
+    ok = setProxies(img, r) && ok;
+    if (!ok) {
+      std::cerr << "Could not load image texture: " << r.path << ": "
+                << SDL_GetError() << std::endl;
+    }
+
+    if (img->isResident())
+      m_residency.add(img);
+  }
+
+  return results;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::finishLoad(const ImageLoader::Result &r) {
+  // Proxy loads and the full resolution load of an image overlap, each
+  // only ends its own.
+  if (r.full || r.kind == ImageLoader::Kind::Pyramid) {
+    m_fullRequested[r.index] = false;
+  } else if (m_loadStates[r.index] == LoadState::Requested) {
+    m_loadStates[r.index] = LoadState::Idle;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool Renderer::setProxies(Image *img, const ImageLoader::Result &r) {
+  bool ok{true};
+  for (int p = 0; p < Image::NUM_PROXIES; ++p) {
+    if (r.proxies[p] == nullptr)
+      continue;
+    const Image::Proxy proxy{static_cast<Image::Proxy>(p)};
+    ok = img->setProxy(proxy, r.proxies[p], proxyTier(r.index, proxy)) && ok;
+  }
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t Renderer::pendingLoads() const {
+  return m_loader != nullptr ? m_loader->pending() + m_loader->finished() : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::uploadTile(Image *img, const ImageLoader::Result &r) {
+  TilePyramid *pyramid{img->pyramid()};
+  if (pyramid == nullptr) {
+    SDL_FreeSurface(r.surface); // Evicted while the tile was loading.
+    return;
+  }
+
+  if (r.failed) {
+    // The cache lost the tile, e.g. it was cleaned up by hand. Build the
+    // pyramid again rather than asking for the same missing tile forever.
+    std::cerr << "Could not load tile: " << r.path << ": " << r.error
+              << std::endl;
+    img->setPyramid(nullptr);
+    if (!m_fullRequested[r.index]) {
+      m_fullRequested[r.index] = true;
+      m_loader->enqueue(ImageLoader::Request::forPyramid(r.index, r.path));
+    }
+    return;
+  }
+
+  // Making room for the tile must not evict the pyramid it goes into.
+  m_residency.touch(img);
+  pyramid->setTile(r.tile, r.surface);
+  m_residency.update(img);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::requestTiles() {
+  if (m_imageModeImage == nullptr || m_imageModeImage->pyramid() == nullptr)
+    return;
+
+  auto it = std::find(m_images.begin(), m_images.end(), m_imageModeImage);
+  if (it == m_images.end())
+    return;
+  const size_t index{static_cast<size_t>(it - m_images.begin())};
+
+  for (auto &tile : m_imageModeImage->pyramid()->takeWanted()) {
+    m_loader->enqueue(
+        ImageLoader::Request::forTile(index, m_imagePaths[index], tile));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool Renderer::needsPyramid(const Image *img) const {
+  int maxW{PYRAMID_MIN_DIMENSION}, maxH{PYRAMID_MIN_DIMENSION};
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(m_renderer, &info) == 0) {
+    if (info.max_texture_width > 0)
+      maxW = std::min(maxW, info.max_texture_width);
+    if (info.max_texture_height > 0)
+      maxH = std::min(maxH, info.max_texture_height);
+  }
+  return img->getTexWidth() > maxW || img->getTexHeight() > maxH;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::updateResidency() {
+  if (m_images.empty())
+    return;
+
+  if (m_galleryStartIndex != m_prioritizedStartIndex ||
+      m_mode != m_prioritizedMode) {
+    m_prioritizedStartIndex = m_galleryStartIndex;
+    m_prioritizedMode = m_mode;
+    m_loader->reprioritize();
+  }
+
+  m_residency.beginFrame();
+  requireGalleryWindow();
+
+  if (m_mode != DisplayMode::Gallery) {
+    // Its tile pyramid drops tiles while drawing.
+    m_residency.update(m_imageModeImage);
+    m_residency.touch(m_imageModeImage);
+
+    auto it = std::find(m_images.begin(), m_images.end(), m_imageModeImage);
+    if (it != m_images.end()) {
+      promoteProxies(static_cast<size_t>(it - m_images.begin()),
+                     {Image::Proxy::Screen});
+    }
+  }
+
+  if (uploadDecodedImages() > 0)
+    m_dirty = true;
+  m_residency.trim();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::requireGalleryWindow() {
+  const int n{static_cast<int>(m_images.size())};
+  // shiftGallery() stops at both ends, nothing past them scrolls into view.
+  auto require = [this, n](int i) {
+    if (i >= 0 && i < n)
+      requireImage(static_cast<size_t>(i));
+  };
+
+  // Visible images first, so they are at the front of the load queue.
+  for (int i = 0; i < NUM_IMAGES_TO_DRAW; ++i) {
+    require(m_galleryStartIndex + i);
+  }
+
+  m_prefetcher.update(SDL_GetTicks());
+  const int ahead{m_prefetcher.lookAhead(m_winDims.x / 5)};
+  const int behind{m_prefetcher.lookBehind()};
+  const int after{m_prefetcher.direction() < 0 ? behind : ahead};
+  const int before{m_prefetcher.direction() < 0 ? ahead : behind};
+
+  // Nearest first, the direction of travel before the other side. Images
+  // that drop out of both ranges are no longer touched and get evicted first.
+  const int last{m_galleryStartIndex + NUM_IMAGES_TO_DRAW - 1};
+  for (int pass = 0; pass < 2; ++pass) {
+    const bool forward{(pass == 0) == (m_prefetcher.direction() >= 0)};
+    const int count{forward ? std::min(after, n - 1 - last)
+                            : std::min(before, m_galleryStartIndex)};
+    for (int i = 1; i <= count; ++i) {
+      require(forward ? last + i : m_galleryStartIndex - i);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::requireImage(size_t index) {
+  Image *img{m_images[index]};
+  if (img->isResident()) {
+    m_residency.touch(img);
+    promoteProxies(index, {Image::Proxy::Strip, Image::Proxy::Gallery});
+  } else if (m_loadStates[index] == LoadState::Idle) {
+    m_loadStates[index] = LoadState::Requested;
+    m_loader->enqueue(ImageLoader::Request::forImage(
+        index, m_imagePaths[index], false,
+        onlyProxies(getProxyBoxes(),
+                    {Image::Proxy::Strip, Image::Proxy::Gallery})));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::promoteProxies(size_t index,
+                              std::initializer_list<Image::Proxy> proxies) {
+  if (m_loadStates[index] != LoadState::Idle)
+    return;
+
+  // Mostly cache hits, uploaded in the tier proxyTier() picks by then.
+  ImageLoader::ProxyBoxes boxes{};
+  bool promote{false};
+  for (auto p : proxies) {
+    if (m_images[index]->getProxyTier(p) == TextureUploader::Tier::Compact &&
+        proxyTier(index, p) == TextureUploader::Tier::Full) {
+      boxes[static_cast<int>(p)] = m_proxyBoxes[static_cast<int>(p)];
+      promote = true;
+    }
+  }
+  if (!promote)
+    return;
+
+  m_loadStates[index] = LoadState::Requested;
+  m_loader->enqueue(
+      ImageLoader::Request::forImage(index, m_imagePaths[index], false, boxes));
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::requestFullResolution(size_t index) {
+  if (m_loadStates[index] == LoadState::Failed || m_fullRequested[index])
+    return;
+
+  // A cached screen sized proxy is drawn while the full resolution decode
+  // is still running. Otherwise that decode makes it, rather than decoding
+  // the same file twice at once.
+  m_fullRequested[index] = true;
+  ImageLoader::ProxyBoxes screen{
+      onlyProxies(getProxyBoxes(), {Image::Proxy::Screen})};
+  if (m_loadStates[index] == LoadState::Idle &&
+      m_loader->isCached(m_imagePaths[index], screen)) {
+    m_loadStates[index] = LoadState::Requested;
+    m_loader->enqueue(ImageLoader::Request::forImage(
+        index, m_imagePaths[index], false, screen));
+    screen = {};
+  }
+
+  if (needsPyramid(m_images[index])) {
+    // Too large for one texture, the tiles are loaded as they come in view.
+    m_loader->enqueue(
+        ImageLoader::Request::forPyramid(index, m_imagePaths[index], screen));
+  } else {
+    // JPEGs come as planar YUV if the renderer can draw that, which takes
+    // 1.5 instead of 4 bytes per pixel to upload and keep. Not if the
+    // screen proxy has to be made from the decode as well.
+    m_loader->enqueue(ImageLoader::Request::forImage(
+        index, m_imagePaths[index], true, screen, m_uploader->yuv()));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+int Renderer::loadPriority(const ImageLoader::Request &request) const {
+  const bool viewing{m_mode != DisplayMode::Gallery &&
+                     m_images[request.index] == m_imageModeImage};
+  if (viewing)
+    return 0;
+
+  // Full resolution images and tiles are only wanted by the image view.
+  if (request.full || request.kind != ImageLoader::Kind::Image)
+    return ImageLoader::DISCARD;
+
+  const ImageLoader::ProxyBoxes strip{
+      onlyProxies(request.proxyBoxes, {Image::Proxy::Strip})};
+  const bool stripOnly{std::equal(strip.begin(), strip.end(),
+                                  request.proxyBoxes.begin(), samePoint)};
+
+  bool after;
+  const int distance{galleryDistance(request.index, &after)};
+  if (stripOnly)
+    return STRIP_PRIORITY + distance;
+  if (distance == 0)
+    return 1;
+
+  // Images on the side the user is heading to come first.
+  const bool ahead{after == (m_prefetcher.direction() >= 0)};
+  const int range{ahead ? m_prefetcher.lookAhead(m_winDims.x / 5)
+                        : m_prefetcher.lookBehind()};
+  if (distance > range + CANCEL_MARGIN)
+    return ImageLoader::DISCARD;
+
+  return 1 + (ahead ? distance : 2 * distance);
+}
+
+////////////////////////////////////////////////////////////////////////////
+int Renderer::galleryDistance(size_t index, bool *after) const {
+  // Straight along the gallery, which stops at both ends, see
+  // shiftGallery().
+  const int offset{static_cast<int>(index) - m_galleryStartIndex};
+  const int toAfter{std::max(0, offset - (NUM_IMAGES_TO_DRAW - 1))};
+  const int toBefore{std::max(0, -offset)};
+  if (after != nullptr)
+    *after = toBefore == 0;
+  return std::max(toAfter, toBefore);
+}
+
+////////////////////////////////////////////////////////////////////////////
+TextureUploader::Tier Renderer::proxyTier(size_t index,
+                                          Image::Proxy p) const {
+  const bool viewing{m_mode != DisplayMode::Gallery &&
+                     m_images[index] == m_imageModeImage};
+  const size_t budget{m_residency.budget()};
+  if (viewing || m_uploader->compactFormat() == SDL_PIXELFORMAT_UNKNOWN ||
+      budget == 0)
+    return TextureUploader::Tier::Full;
+
+  // Plenty of room, keep everything at full quality.
+  const double pressure{m_residency.residentBytes() /
+                        static_cast<double>(budget)};
+  if (pressure < COMPACT_PRESSURE)
+    return TextureUploader::Tier::Full;
+
+  // The visible gallery window stays sharp until the budget runs out, the
+  // strip thumbnails are too small for the difference to show.
+  if (galleryDistance(index) > 0 || p == Image::Proxy::Strip || pressure >= 1.0)
+    return TextureUploader::Tier::Compact;
+  return TextureUploader::Tier::Full;
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t Renderer::tierBytes(TextureUploader::Tier tier) const {
+  size_t bytes{0};
+  for (auto img : m_images) {
+    bytes += img->getTextureBytes(tier);
+  }
+  return bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////
+ImageLoader::ProxyBoxes Renderer::getProxyBoxes() const {
+  const int n{std::max(1, static_cast<int>(m_images.size()))};
+
+  ImageLoader::ProxyBoxes boxes;
+  boxes[static_cast<int>(Image::Proxy::Strip)] = {
+      std::max(MIN_STRIP_PROXY_WIDTH, m_winDims.x / (5 * n)), m_winDims.y};
+  boxes[static_cast<int>(Image::Proxy::Gallery)] = {m_winDims.x / 5,
+                                                    m_winDims.y};
+  boxes[static_cast<int>(Image::Proxy::Screen)] = m_winDims;
+  return boxes;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::rebuildProxies() {
+  const ImageLoader::ProxyBoxes boxes{getProxyBoxes()};
+
+  // Only the proxies whose box changed, none if e.g. the window was resized
+  // back and forth.
+  ImageLoader::ProxyBoxes changed{};
+  bool anyChanged{false};
+  for (int p = 0; p < Image::NUM_PROXIES; ++p) {
+    if (!samePoint(boxes[p], m_proxyBoxes[p])) {
+      changed[p] = boxes[p];
+      anyChanged = true;
+    }
+  }
+  m_proxyBoxes = boxes;
+
+  for (size_t i = 0; i < m_images.size(); ++i) {
+    Image *img{m_images[i]};
+    if (m_loadStates[i] == LoadState::Failed) {
+      // Try again, the file may have been replaced in the meantime.
+      m_loadStates[i] = LoadState::Requested;
+      m_loader->enqueue(ImageLoader::Request::forImage(
+          i, m_imagePaths[i], false,
+          onlyProxies(boxes, {Image::Proxy::Strip})));
+      continue;
+    }
+    if (!anyChanged || !img->isLoaded() || m_loadStates[i] != LoadState::Idle)
+      continue;
+
+    // Out of view images only keep their strip thumbnail.
+    const ImageLoader::ProxyBoxes wanted{
+        img->isResident()
+            ? onlyProxies(changed, {Image::Proxy::Strip, Image::Proxy::Gallery})
+            : onlyProxies(changed, {Image::Proxy::Strip})};
+    if (std::all_of(wanted.begin(), wanted.end(), [](const SDL_Point &box) {
+          return box.x <= 0 || box.y <= 0;
+        }))
+      continue;
+
+    m_loadStates[i] = LoadState::Requested;
+    m_loader->enqueue(
+        ImageLoader::Request::forImage(i, m_imagePaths[i], false, wanted));
   }
 }
 
@@ -95,13 +648,45 @@ int Renderer::init() {
   // Set log messages
   SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
 
-  m_window = SDL_CreateWindow("SuperEpic",      // sdl_window title
-                              m_winPos.x,       // initial x position
-                              m_winPos.y,       // initial y position
-                              m_winDims.x,      // width, in pixels
-                              m_winDims.y,      // height, in pixels
-                              SDL_WINDOW_OPENGL // flags
-                              );
+  // Load the image codecs up front, IMG_Load is going to be called from the
+  // loader threads and the lazy init inside SDL_image is not thread safe.
+  int imgFlags{IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF | IMG_INIT_WEBP};
+  if ((IMG_Init(imgFlags) & imgFlags) != imgFlags) {
+    std::cerr << "IMG_Init could not load all codecs: " << IMG_GetError()
+              << "\n";
+  }
+  m_proxyCache = new ProxyCache(m_proxyCacheDir);
+  if (!m_proxyCache->isValid()) {
+    std::cerr << "No proxy cache directory: " << SDL_GetError() << "\n";
+  }
+  // Before the loader threads start using the cache.
+  const size_t pruned{m_proxyCache->prune(m_proxyCacheLimit)};
+  if (pruned > 0) {
+    std::cout << "Proxy cache: removed " << pruned << " old entries\n";
+  }
+  m_loader = new ImageLoader(m_proxyCache);
+  m_loader->prioritize([this](const ImageLoader::Request &request) {
+    return loadPriority(request);
+  });
+
+  // Wake-up calls for the render-on-demand loop.
+  const Uint32 events{SDL_RegisterEvents(2)};
+  if (events == static_cast<Uint32>(-1)) {
+    std::cerr << "SDL_RegisterEvents failed, rendering every frame.\n";
+    m_renderOnDemand = false;
+  } else {
+    m_loaderEvent = events;
+    m_sensorEvent = events + 1;
+    m_loader->notify(m_loaderEvent);
+  }
+
+  m_window = SDL_CreateWindow(
+      "SuperEpic",                                 // sdl_window title
+      m_winPos.x,                                  // initial x position
+      m_winPos.y,                                  // initial y position
+      m_winDims.x,                                 // width, in pixels
+      m_winDims.y,                                 // height, in pixels
+      m_softwareRenderer ? 0 : SDL_WINDOW_OPENGL); // flags
 
   if (m_window == nullptr) {
     std::cerr << "Coult not create sdl_window: " << SDL_GetError() << "\n";
@@ -110,9 +695,17 @@ int Renderer::init() {
 
   Image::sdl_window(m_window);
 
-  m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED |
-                                                    SDL_RENDERER_PRESENTVSYNC |
-                                                    SDL_RENDERER_TARGETTEXTURE);
+  // Linear filtering for the textures that get scaled down when drawn.
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+
+  // The software renderer does not wait for vsync, which is what a frame
+  // time measurement wants.
+  m_renderer = SDL_CreateRenderer(
+      m_window, -1,
+      m_softwareRenderer
+          ? SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE
+          : SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC |
+                SDL_RENDERER_TARGETTEXTURE);
 
   if (m_renderer == nullptr) {
     std::cerr << "Could not create SDL_Renderer: " << SDL_GetError() << "\n";
@@ -120,6 +713,15 @@ int Renderer::init() {
   }
 
   Image::sdl_renderer(m_renderer);
+  Image::residency(&m_residency);
+  m_uploader = new TextureUploader(m_renderer);
+  Image::uploader(m_uploader);
+
+  SDL_DisplayMode displayMode;
+  if (SDL_GetWindowDisplayMode(m_window, &displayMode) == 0 &&
+      displayMode.refresh_rate > 0) {
+    m_refreshMs = 1000.0f / displayMode.refresh_rate;
+  }
 
   m_cursor = new Cursor();
   m_cursor->init(static_cast<int>(m_winDims.x * DEFAULT_CURSOR_SCALE),
@@ -135,70 +737,155 @@ int Renderer::init() {
 
   SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 2); // anti-aliasing
   SDL_ShowCursor(0);                                 // don't show mouse arrow.
-  toggleFullScreen();
+  if (m_startFullScreen) {
+    toggleFullScreen();
+  }
   return 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::loop() {
-  float since = 0.0f; // seconds since last loop iteration
-  float then = 0.0f;
+  m_lastStep = SDL_GetTicks() * 1e-3f;
   while (!m_shouldQuit) {
-    float now = SDL_GetTicks() * 1e-3f;
-    since = now - then; // seconds
-
-// Pop events from the SDL event queue.
-// When we start using the kinect to control, this may get replaced, or
-// this is probably were the kinect gesture events will get checked.
-
-#ifdef WIN32
-    if (m_useKinectForCursorPos) {
-      onGesture();
-      SDL_Event event;
-      while (SDL_PollEvent(&event) != 0) {
-        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_k) {
-          m_useKinectForCursorPos = !m_useKinectForCursorPos;
-        }
-      }
-    } else {
-      SDL_Event event;
-      while (SDL_PollEvent(&event) != 0) {
-        printEvent(&event);
-        onEvent(event);
-      }
-    }
-#else
-    SDL_Event event;
-    while (SDL_PollEvent(&event) != 0) {
-      printEvent(&event);
-      onEvent(event);
-    }
-#endif
+    step();
+  }
 
-    std::cout << KinectSensor::getGestureType() << std::endl;
+  std::cout << "Frames: " << m_framesRendered << " rendered, "
+            << m_framesSkipped << " skipped";
+  if (m_framesPaced > 0) {
+    std::cout << ", " << m_framesPaced << " paced by "
+              << m_pacingMs / m_framesPaced << " ms on average";
+  }
+  std::cout << "\n";
+  std::cout << "Exiting render loop\n";
+}
 
-    SDL_RenderClear(m_renderer);
+////////////////////////////////////////////////////////////////////////////
+void Renderer::step() {
+  // Sleep until there is something to do, unless an animation is running
+  // or the previous iteration left work behind.
+  SDL_Event event;
+  if (m_renderOnDemand && !m_dirty && !isAnimating() &&
+      SDL_WaitEventTimeout(&event, IDLE_WAIT_MS) != 0) {
+    handleEvent(event);
+  }
 
-    switch (m_mode) {
-    case DisplayMode::Gallery:
-      renderGalleryMode();
-      break;
-    case DisplayMode::FromGalleryToImage:
-      renderTransitionMode(since);
-      break;
-    case DisplayMode::Image:
-      renderImageViewMode();
-      break;
+  if (!m_renderOnDemand || m_dirty || isAnimating()) {
+    paceFrame();
+  }
+  const Uint64 frameStart = SDL_GetPerformanceCounter();
+
+  float now = SDL_GetTicks() * 1e-3f;
+  float since = now - m_lastStep; // seconds since last loop iteration
+  m_lastStep = now;
+
+  // Pop events from the SDL event queue.
+  while (SDL_PollEvent(&event) != 0) {
+    handleEvent(event);
+  }
+
+  if (m_replayer != nullptr) {
+    replayRecords();
+  } else if (m_tracker != nullptr) {
+    pollGestures();
+  }
+
+  updateResidency();
+
+  if (m_renderOnDemand && !m_dirty && !isAnimating()) {
+    ++m_framesSkipped;
+    return;
+  }
+  m_dirty = false;
+  ++m_framesRendered;
+
+  SDL_RenderClear(m_renderer);
+
+  switch (m_mode) {
+  case DisplayMode::Gallery:
+    renderGalleryMode();
+    break;
+  case DisplayMode::FromGalleryToImage:
+    renderTransitionMode(since);
+    break;
+  case DisplayMode::Image:
+    renderImageViewMode();
+    break;
+  }
+
+  if (m_mode != DisplayMode::Gallery) {
+    requestTiles(); // The ones the image draw just found missing.
+  }
+
+  // The scene is done, only the cursor is drawn with the newest input.
+  latchCursor();
+  m_cursor->update(since);
+  renderCursorTexture();
+
+  const Uint64 beforePresent = SDL_GetPerformanceCounter();
+  SDL_RenderPresent(m_renderer);
+  m_lastPresent = SDL_GetPerformanceCounter();
+  const double costMs = (beforePresent - frameStart) * 1000.0 /
+                        SDL_GetPerformanceFrequency();
+  m_frameCostMs += FRAME_COST_ALPHA * (costMs - m_frameCostMs);
+
+  if (!m_unpresented.empty()) {
+    const Uint64 presented = SDL_GetPerformanceCounter();
+    for (const LatencyTracer::Stamps &stamps : m_unpresented) {
+      m_latency.record(stamps, presented);
     }
+    m_unpresented.clear();
+  }
+}
 
-    m_cursor->update(since);
-    renderCursorTexture();
+////////////////////////////////////////////////////////////////////////////
+void Renderer::paceFrame() {
+  // Without vsync there is nothing to be in time for.
+  if (!m_framePacing || m_softwareRenderer || m_lastPresent == 0)
+    return;
 
-    SDL_RenderPresent(m_renderer);
-    then = now;
-  } // while(!m_shouldQuit)
+  const double sinceMs = (SDL_GetPerformanceCounter() - m_lastPresent) *
+                         1000.0 / SDL_GetPerformanceFrequency();
+  const double slackMs = m_refreshMs - sinceMs -
+                         m_frameCostMs * PACING_COST_FACTOR -
+                         PACING_MARGIN_MS;
+  if (slackMs < 1.0)
+    return;
 
-  std::cout << "Exiting render loop\n";
+  SDL_Delay(static_cast<Uint32>(slackMs));
+  ++m_framesPaced;
+  m_pacingMs += static_cast<Uint32>(slackMs);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::latchCursor() {
+  if (!m_lateLatch || m_replayer != nullptr)
+    return;
+
+  if (!m_useKinectForCursorPos) {
+    int x, y;
+    SDL_PumpEvents();
+    SDL_GetMouseState(&x, &y);
+    m_cursor->setPos(x, y);
+    return;
+  }
+
+  // The cursor only follows the open hand; the gesture itself is handled
+  // with the next frame.
+  GestureTracker::Sample sample;
+  if (m_tracker == nullptr || !m_tracker->latest(&sample) ||
+      sample.gesture.type != GestureType::None)
+    return;
+
+  float hand[3]{sample.gesture.hand[0], sample.gesture.hand[1],
+                sample.gesture.hand[2]};
+  if (m_predictor != nullptr) {
+    m_predictor->update(hand, sample.gesture.ms);
+    m_gestureCaptured = sample.captured;
+    m_predictor->predict(predictionHorizonMs(), hand);
+  }
+  const SDL_Point pos = mapHandToCursor(hand, m_winDims.x, m_winDims.y);
+  m_cursor->setPos(pos.x, pos.y);
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -210,6 +897,170 @@ Image *Renderer::getImageFromGalleryIndex(int index) const {
   return m_images[(m_galleryStartIndex + (index)) % m_images.size()];
 }
 
+////////////////////////////////////////////////////////////////////////////
+void Renderer::handleEvent(const SDL_Event &event) {
+  // Loader and sensor events carry no data, they only mean that the next
+  // frame may look different.
+  m_dirty = true;
+  if (event.type == m_loaderEvent || event.type == m_sensorEvent)
+    return;
+
+  // While replaying, the log is the only input; the window can still be
+  // closed though.
+  if (m_replayer != nullptr && InputRecorder::isRecorded(event.type) &&
+      event.type != SDL_QUIT)
+    return;
+
+  if (m_recorder != nullptr)
+    m_recorder->record(SDL_GetTicks(), event);
+
+  dispatchEvent(event);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::dispatchEvent(const SDL_Event &event) {
+  if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_l) {
+    m_latency.print(std::cout);
+    return;
+  }
+
+  // The window can be closed and resized whatever steers the cursor.
+  if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT) {
+    printEvent(&event);
+    onEvent(event);
+    return;
+  }
+
+  if (m_useKinectForCursorPos) {
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_k) {
+      m_useKinectForCursorPos = !m_useKinectForCursorPos;
+    }
+    return;
+  }
+
+  printEvent(&event);
+  onEvent(event);
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool Renderer::isAnimating() const {
+  // A replay feeds input on its own schedule, waiting for events would
+  // stall it.
+  return m_mode == DisplayMode::FromGalleryToImage ||
+         m_cursor->isAnimating() || m_replayer != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////
+GestureView Renderer::gestureView() const {
+  switch (m_mode) {
+  case DisplayMode::Gallery:
+    return GestureView::Gallery;
+  case DisplayMode::Image:
+    return GestureView::Image;
+  default:
+    return GestureView::Transition;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::pollGestures() {
+  // Every sensor frame is handled once, oldest first, so that short
+  // gestures are not lost between two render frames. The queue is drained
+  // in mouse mode too, or it would be stale when switching back.
+  GestureTracker::Sample sample;
+  while (m_tracker->poll(&sample)) {
+    if (!m_useKinectForCursorPos)
+      continue;
+
+    if (m_recorder != nullptr)
+      m_recorder->record(SDL_GetTicks(), sample.gesture);
+    m_gestureCaptured = sample.captured;
+    onGesture(sample.gesture);
+    m_dirty = true;
+    m_unpresented.push_back({sample.captured, sample.acquired, sample.queued,
+                             SDL_GetPerformanceCounter()});
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+float Renderer::predictionHorizonMs() const {
+  const CursorPredictor::Params &params = m_predictor->params();
+  if (!params.adaptive || m_gestureCaptured == 0)
+    return params.horizonMs;
+
+  // From the capture of the frame to the present of the frame drawn now;
+  // until a frame was presented, assume that takes one 60 Hz frame.
+  const double ageMs = (SDL_GetPerformanceCounter() - m_gestureCaptured) *
+                       1000.0 / SDL_GetPerformanceFrequency();
+  const double presentMs =
+      m_latency.count(LatencyTracer::Stage::Render) > 0
+          ? m_latency.percentileMs(LatencyTracer::Stage::Render, 0.5)
+          : 1000.0 / 60.0;
+  return static_cast<float>(ageMs + presentMs);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::replayRecords() {
+  m_replayer->advance(SDL_GetTicks());
+
+  InputRecord record;
+  while (m_replayer->poll(&record)) {
+    m_dirty = true;
+    if (record.kind == InputRecord::Kind::Gesture) {
+      m_gestureCaptured = 0;
+      onGesture(record.gesture);
+    } else {
+      dispatchEvent(record.event);
+    }
+  }
+
+  if (m_replayer->finished()) {
+    std::cout << "Replayed " << m_replayer->count() << " input records\n";
+    m_shouldQuit = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::predictCursor(const CursorPredictor::Params &params) {
+  delete m_predictor;
+  m_predictor = new CursorPredictor(params);
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool Renderer::recordInput(const std::string &path) {
+  delete m_recorder;
+  m_recorder = new InputRecorder(path);
+  if (!m_recorder->isOpen()) {
+    delete m_recorder;
+    m_recorder = nullptr;
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool Renderer::replayInput(const std::string &path, bool realtime) {
+  delete m_replayer;
+  m_replayer = new InputReplayer(path, realtime);
+  if (!m_replayer->isOpen()) {
+    delete m_replayer;
+    m_replayer = nullptr;
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::postSensorUpdate() {
+  if (m_sensorEvent == 0)
+    return;
+
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = m_sensorEvent;
+  SDL_PushEvent(&event);
+}
+
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::onEvent(const SDL_Event &event) {
   if (event.type == SDL_MOUSEMOTION) {
@@ -325,6 +1176,7 @@ void Renderer::onWindowEvent(const SDL_WindowEvent &window) {
       m_imageModeImage->maximize();
     }
 
+    rebuildProxies();
     break;
   }
 }
@@ -351,34 +1203,72 @@ void Renderer::onMouseWheelEvent(const SDL_MouseWheelEvent &event) {
 }
 
 ////////////////////////////////////////////////////////////////////////////
-void Renderer::onGesture() {
-  std::string gesture = KinectSensor::getGestureType();
-  if (gesture == "NO_GESTURE") {
+void Renderer::onGesture(const GestureSample &sample) {
+  if (m_predictor != nullptr)
+    m_predictor->update(sample.hand, sample.ms);
+
+  if (sample.type != sample.previous) {
+    onGestureExit(sample.previous, sample.ms);
+    onGestureEnter(sample.type, sample.ms);
+  }
+
+  switch (sample.type) {
+  case GestureType::None:
+    onNoGesture(sample);
+    break;
+  case GestureType::Panning:
+    onPanning(sample);
+    break;
+  case GestureType::ZoomIn:
+    onZoom(1);
+    break;
+  case GestureType::ZoomOut:
+    onZoom(-1);
+    break;
+  case GestureType::SelectionProgress:
+    onSelectionProgress(sample);
+    break;
+  default:
+    break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::onGestureEnter(GestureType type, Uint32) {
+  switch (type) {
+  case GestureType::None:
     m_cursor->setMode(Cursor::Mode::Normal);
-    onNoGesture();
-  } else if (gesture == "SELECT") {
+    break;
+  case GestureType::Select:
     m_cursor->setMode(Cursor::Mode::Selected);
     onSelect();
-  } else if (gesture == "PANNING") {
+    break;
+  case GestureType::Panning:
     m_cursor->setMode(Cursor::Mode::PanningGallery);
-    onPanning();
-  } else if (gesture == "ZOOM_IN") {
-    m_cursor->setMode(Cursor::Mode::Selected);
-    onZoom(1);
-  } else if (gesture == "ZOOM_OUT") {
+    break;
+  case GestureType::ZoomIn:
+  case GestureType::ZoomOut:
     m_cursor->setMode(Cursor::Mode::Selected);
-    onZoom(-1);
-  } else if (gesture == "SELECTION_PROGRESS") {
+    break;
+  case GestureType::SelectionProgress:
     m_cursor->setMode(Cursor::Mode::Selecting);
-    onSelectionProgress();
+    break;
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////
-void Renderer::onNoGesture() {
-  SDL_Point pos;
-  KinectSensor::mapHandToCursor(KinectSensor::handCoords, m_winDims.x,
-                                m_winDims.y, reinterpret_cast<int *>(&pos));
+void Renderer::onGestureExit(GestureType type, Uint32) {
+  // Quitting takes one uninterrupted zoom out.
+  if (type == GestureType::ZoomOut)
+    m_willingToQuit = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::onNoGesture(const GestureSample &sample) {
+  float hand[3]{sample.hand[0], sample.hand[1], sample.hand[2]};
+  if (m_predictor != nullptr)
+    m_predictor->predict(predictionHorizonMs(), hand);
+  SDL_Point pos = mapHandToCursor(hand, m_winDims.x, m_winDims.y);
 
   m_cursor->setPos(pos.x, pos.y);
   m_previousImageHoverIndex = m_currentImageHoverIndex;
@@ -391,12 +1281,12 @@ void Renderer::onSelect() {
   m_selected = true;
 }
 
-void Renderer::onPanning() {
+void Renderer::onPanning(const GestureSample &sample) {
   if (m_mode == DisplayMode::Gallery) {
-    shiftCandidates(0 - KinectSensor::panning_delta_x * 30);
+    shiftCandidates(static_cast<int>(0 - sample.panningDeltaX * 30));
   } else if (m_mode == DisplayMode::Image) {
-    SDL_Point delta{0 - KinectSensor::panning_delta_x * 30,
-                    KinectSensor::panning_delta_y * 30};
+    SDL_Point delta{static_cast<int>(0 - sample.panningDeltaX * 30),
+                    static_cast<int>(sample.panningDeltaY * 30)};
     m_imageModeImage->panBy(delta);
   }
 }
@@ -425,8 +1315,8 @@ void Renderer::onZoom(int factor) {
   }
 }
 
-void Renderer::onSelectionProgress() {
-  if (std::time(nullptr) - KinectSensor::timer > 0.5) {
+void Renderer::onSelectionProgress(const GestureSample &sample) {
+  if (sample.secondsSincePan > 0.5f) {
     m_selected = false;
   }
 }
@@ -472,7 +1362,11 @@ void Renderer::renderImageTextures() {
 
     updateImageForGalleryView(img, imgXPos, imgWidth);
 
-    img->draw();
+    if (img->isLoaded()) {
+      img->draw();
+    } else {
+      renderPlaceholder(img->getBounds());
+    }
 
     if (m_selected &&
         (!m_useKinectForCursorPos && i == m_currentImageHoverIndex ||
@@ -483,19 +1377,20 @@ void Renderer::renderImageTextures() {
 }
 
 void Renderer::renderThumbsTexture() {
-  const int thumbWidth{m_winDims.x / (5 * static_cast<int>(m_thumbs.size()))};
+  const int thumbWidth{m_winDims.x / (5 * static_cast<int>(m_images.size()))};
   const int imgWidth{m_winDims.x / 5};
   int thumbXpos = 2 * m_winDims.x / 5;
   SDL_Rect thumbBox;
   thumbBox.h = 0;
   thumbBox.x = thumbXpos;
   thumbBox.w = 5 * thumbWidth;
-  for (auto thumb : m_thumbs) {
-    updateThumbForGalleryView(thumb, thumbXpos, thumbWidth);
+  for (auto img : m_images) {
+    SDL_Rect dest{getThumbBounds(img, thumbXpos, thumbWidth)};
     thumbXpos += thumbWidth;
-    thumb->draw();
-    if (thumbBox.h < thumb->getBounds().h)
-      thumbBox.h = thumb->getBounds().h;
+    if (img->isLoaded())
+      img->draw(dest);
+    if (thumbBox.h < dest.h)
+      thumbBox.h = dest.h;
   }
   thumbBox.h *= 1.2;
   thumbBox.y = (m_winDims.y * 4 / 5) - (thumbBox.h / 2);
@@ -504,6 +1399,16 @@ void Renderer::renderThumbsTexture() {
   renderRectangle(thumbBox, 2, 0, 255, 255);
 }
 
+////////////////////////////////////////////////////////////////////////////
+void Renderer::renderPlaceholder(const SDL_Rect &dest) const {
+  Uint8 r, g, b, a;
+  SDL_GetRenderDrawColor(m_renderer, &r, &g, &b, &a);
+  SDL_SetRenderDrawColor(m_renderer, 40, 40, 40, 255);
+  SDL_RenderFillRect(m_renderer, &dest);
+  SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
+  renderRectangle(dest, 1, 90, 90, 90);
+}
+
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::renderRectangle(const SDL_Rect &dest, int thickness, Uint8 R,
                                Uint8 G, Uint8 B) const {
@@ -526,8 +1431,10 @@ void Renderer::renderRectangle(const SDL_Rect &dest, int thickness, Uint8 R,
 void Renderer::updateImageForGalleryView(Image *img, int imgXPos,
                                          int imgWidth) {
 
-  float aspect_ratio{img->getTexWidth() /
-                     static_cast<float>(img->getTexHeight())};
+  float aspect_ratio{img->hasTexDims()
+                         ? img->getTexWidth() /
+                               static_cast<float>(img->getTexHeight())
+                         : PLACEHOLDER_ASPECT_RATIO};
 
   SDL_Rect dest;
   dest.w = imgWidth;
@@ -539,10 +1446,12 @@ void Renderer::updateImageForGalleryView(Image *img, int imgXPos,
   img->setBounds(dest);
 }
 
-void Renderer::updateThumbForGalleryView(Image *thumb, int thumbXPos,
-                                         int thumbWidth) {
-  float aspect_ratio{thumb->getTexWidth() /
-                     static_cast<float>(thumb->getTexHeight())};
+SDL_Rect Renderer::getThumbBounds(const Image *img, int thumbXPos,
+                                  int thumbWidth) const {
+  float aspect_ratio{img->hasTexDims()
+                         ? img->getTexWidth() /
+                               static_cast<float>(img->getTexHeight())
+                         : PLACEHOLDER_ASPECT_RATIO};
 
   SDL_Rect dest;
   dest.w = thumbWidth;
@@ -551,18 +1460,29 @@ void Renderer::updateThumbForGalleryView(Image *thumb, int thumbXPos,
   dest.x = thumbXPos;
   dest.y = (m_winDims.y * 4 / 5) - (dest.h / 2);
 
-  thumb->setBounds(dest);
+  return dest;
 }
 
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::prepareForGalleryToImageTransition() {
+  int idx = m_useKinectForCursorPos ? m_currentImageSelectIndex
+                                    : m_currentImageHoverIndex;
+  Image *img{getImageFromGalleryIndex(idx)};
+  if (!img->isResident()) {
+    return; // still loading, nothing to zoom into yet.
+  }
+
   m_mode = DisplayMode::FromGalleryToImage;
   m_clickCount = 0;
   m_selected = false;
   m_willingToQuit = 0;
-  int idx = m_useKinectForCursorPos ? m_currentImageSelectIndex
-                                    : m_currentImageHoverIndex;
-  m_imageModeImage = getImageFromGalleryIndex(idx);
+  m_imageModeImage = img;
+
+  // After m_mode and m_imageModeImage, which loadPriority() looks at.
+  if (!img->hasFullResolution()) {
+    requestFullResolution((m_galleryStartIndex + idx) % m_images.size());
+  }
+
   m_imageModeImage->maximize();
   m_targetScale = m_imageModeImage->getScaleFactor();
   m_imageModeImage->scale(0.0f);
@@ -570,13 +1490,17 @@ void Renderer::prepareForGalleryToImageTransition() {
 
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::prepareForImageViewMode() {
-  m_mode = KinectSensor::mode = DisplayMode::Image;
+  m_mode = DisplayMode::Image;
+  if (m_tracker != nullptr)
+    m_tracker->view(gestureView());
   m_imageModeImage->scale(m_targetScale);
   m_imageModeImage->setBaseScaleFactor(m_targetScale);
 }
 
 void Renderer::prepareForGalleryViewMode() {
-  m_mode = KinectSensor::mode = DisplayMode::Gallery;
+  m_mode = DisplayMode::Gallery;
+  if (m_tracker != nullptr)
+    m_tracker->view(gestureView());
   std::cout << "Switch to Gallery View"
             << "\n";
   m_willingToQuit = 0;
@@ -663,6 +1587,24 @@ void Renderer::printEvent(const SDL_Event *event) const {
 
 ////////////////////////////////////////////////////////////////////////////
 void Renderer::shiftCandidates(int dx) {
+  m_prefetcher.onShift(dx, SDL_GetTicks());
+  const int oldStartIndex{m_galleryStartIndex};
+  shiftGallery(dx);
+  if (m_galleryStartIndex == oldStartIndex || m_images.empty())
+    return;
+
+  // The image that just scrolled into view at the leading edge. There is
+  // none past the last image, the gallery does not wrap around.
+  const int n{static_cast<int>(m_images.size())};
+  const int edge{m_galleryStartIndex > oldStartIndex
+                     ? std::min(NUM_IMAGES_TO_DRAW - 1,
+                                n - 1 - m_galleryStartIndex)
+                     : 0};
+  m_prefetcher.recordArrival(getImageFromGalleryIndex(edge)->isResident());
+}
+
+////////////////////////////////////////////////////////////////////////////
+void Renderer::shiftGallery(int dx) {
   const int imgWidth{m_winDims.x / 5};
   if (dx < 0) { // shift to left to bring up new candidate from right
     if (m_galleryStartIndex + 5 < m_images.size()) {
@@ -2,13 +2,26 @@
 #define epic_renderer_h__
 
 #include "cursor.h"
+#include "cursorpredictor.h"
+#include "gesture.h"
 #include "image.h"
+#include "imageloader.h"
+#include "inputlog.h"
+#include "latencytracer.h"
+#include "prefetcher.h"
+#include "proxycache.h"
+#include "residency.h"
+#include "textureuploader.h"
+#include "tilepyramid.h"
 
 #include <SDL.h>
 
+#include <initializer_list>
 #include <string>
 #include <vector>
 
+class GestureTracker;
+
 class Renderer {
 public:
   enum class DisplayMode { Gallery, Image, FromGalleryToImage };
@@ -22,7 +35,11 @@ public:
   ~Renderer();
 
   ////////////////////////////////////////////////////////////////////////////
-  /// \brief Load the images in \c filePaths.
+  /// \brief Queue the images in \c filePaths for loading.
+  ///
+  /// Returns right away, the images are decoded in the background and show up
+  /// in the gallery as they finish. Only proxies are loaded, the full
+  /// resolution image is decoded once it is opened. Call after init().
   ////////////////////////////////////////////////////////////////////////////
   void loadImages(const std::vector<std::string> &filePaths);
 
@@ -41,25 +58,153 @@ public:
   ////////////////////////////////////////////////////////////////////////////
   void loop();
 
+  ////////////////////////////////////////////////////////////////////////////
+  /// \brief Run one iteration of the main loop: handle the pending events,
+  ///        upload finished loads and draw a frame if anything changed.
+  ///
+  /// For driving the renderer from a script, e.g. by pushing SDL events
+  /// between calls. May block like loop() does when renderOnDemand() is on.
+  ////////////////////////////////////////////////////////////////////////////
+  void step();
+
+  /// \brief Go fullscreen in init(), on by default. Call before init().
+  void startFullScreen(bool fullScreen) { m_startFullScreen = fullScreen; }
+
+  /// \brief Use SDL's software renderer instead of an accelerated one with
+  ///        vsync, e.g. for the dummy video driver. Call before init().
+  void softwareRenderer(bool software) { m_softwareRenderer = software; }
+
+  /// \brief Where the ProxyCache is kept, empty for the SDL pref path.
+  ///        Call before init().
+  void proxyCacheDir(const std::string &dir) { m_proxyCacheDir = dir; }
+
+  /// \brief Bytes the ProxyCache may take on disk, the oldest entries are
+  ///        removed at init() once it is larger. Call before init().
+  void proxyCacheLimit(size_t bytes) { m_proxyCacheLimit = bytes; }
+
+  DisplayMode mode() const { return m_mode; }
+  int galleryStartIndex() const { return m_galleryStartIndex; }
+
+  /// \brief Texture residency of the gallery images, for statistics.
+  const TextureResidency &residency() const { return m_residency; }
+
+  /// \brief How textures were uploaded, nullptr before init().
+  const TextureUploader *uploader() const { return m_uploader; }
+
+  /// \brief Bytes of texture memory the images hold in \c tier.
+  size_t tierBytes(TextureUploader::Tier tier) const;
+
+  /// \brief Load requests that are queued, running, or finished but not
+  ///        uploaded yet.
+  size_t pendingLoads() const;
+
   void cursorSpeed(float s) { m_cursorSpeed = s; }
   float cursorSpeed() const { return m_cursorSpeed; }
+
+  /// \brief Bytes of texture memory the gallery images may keep resident.
+  void textureBudget(size_t bytes) { m_residency.budget(bytes); }
+  size_t textureBudget() const { return m_residency.budget(); }
+
+  /// \brief Pan tracking and hit rate of the gallery prefetch.
+  const Prefetcher &prefetcher() const { return m_prefetcher; }
+
+  /// \brief Only redraw when something changed, otherwise sleep in
+  ///        SDL_WaitEventTimeout(). On by default.
+  void renderOnDemand(bool onDemand) { m_renderOnDemand = onDemand; }
+  bool renderOnDemand() const { return m_renderOnDemand; }
+
+  /// \brief Write the input events and gestures the renderer handles to
+  ///        the log \c path, see InputRecorder.
+  /// \return false if the log could not be created.
+  bool recordInput(const std::string &path);
+
+  /// \brief Drive the renderer from the log \c path instead of live input,
+  ///        see InputReplayer. The loop quits once the log is used up.
+  /// \param realtime Keep the recorded timing, otherwise one frame is drawn
+  ///                 per FAST_STEP_MS of the log.
+  /// \return false if the log could not be read.
+  bool replayInput(const std::string &path, bool realtime);
+
+  /// \brief Take gestures from \c tracker, which must stay alive until it
+  ///        is replaced, e.g. by nullptr, or the renderer is destroyed.
+  ///        'k' switches between the mouse and the gestures.
+  void gestureTracker(GestureTracker *tracker) { m_tracker = tracker; }
+
+  /// \brief Draw the gesture cursor where the hand is predicted to be when
+  ///        the frame is presented, see CursorPredictor. Off by default.
+  void predictCursor(const CursorPredictor::Params &params);
+
+  /// \brief Move the cursor to the newest mouse or hand position right
+  ///        before present, after the rest of the frame was drawn. On by
+  ///        default; a replay always draws the recorded position.
+  void lateLatch(bool latch) { m_lateLatch = latch; }
+
+  /// \brief With vsync, wait before drawing a frame so that it is done
+  ///        just in time for the next vsync, given the measured frame cost.
+  ///        Input is read after the wait. Off by default.
+  void framePacing(bool pace) { m_framePacing = pace; }
+
+  /// \brief Steer with gestures instead of the mouse, off by default.
+  void gestureCursor(bool gestures) { m_useKinectForCursorPos = gestures; }
+
+  /// \brief True while replaying an input log.
+  bool isReplaying() const { return m_replayer != nullptr; }
+
+  /// \brief Loop iterations that drew a frame.
+  size_t framesRendered() const { return m_framesRendered; }
+  /// \brief Loop iterations that woke up but had nothing new to draw.
+  size_t framesSkipped() const { return m_framesSkipped; }
+
+  /// \brief Motion to photon latency of the gestures presented so far.
+  ///        'l' prints it.
+  const LatencyTracer &latency() const { return m_latency; }
+
+  /// \brief Wake up the render loop because new sensor data is available.
+  ///        May be called from any thread.
+  static void postSensorUpdate();
+
   static bool m_shouldQuit; ///< If the main loop should exit.
+  static Uint32 m_sensorEvent; ///< SDL event type of postSensorUpdate().
 
 private:
   /// \brief Handle SDL events! :)
   void onEvent(const SDL_Event &event);
+  /// \brief Handle one event from the SDL queue: record it, or drop it if
+  ///        the input comes from a replay.
+  void handleEvent(const SDL_Event &event);
+  /// \brief Dispatch an input event, depending on the input mode.
+  void dispatchEvent(const SDL_Event &event);
+  /// \brief What GestureTracker should interpret gestures for.
+  GestureView gestureView() const;
+  /// \brief Sleep off the time the next frame does not need, see
+  ///        framePacing().
+  void paceFrame();
+  /// \brief Place the cursor at the newest input, see lateLatch().
+  void latchCursor();
+  /// \brief How far ahead of the last gesture m_predictor should look.
+  float predictionHorizonMs() const;
+  /// \brief Handle the gestures m_tracker queued since the last frame.
+  void pollGestures();
+  /// \brief Dispatch the records of the replayed log that are due.
+  void replayRecords();
+  /// \brief True if the next frame differs from the last one even without
+  ///        new events, e.g. during an animation.
+  bool isAnimating() const;
   void onMouseButtonUp(const SDL_MouseButtonEvent &event);
   void onKeyDown(const SDL_KeyboardEvent &event);
   void onWindowEvent(const SDL_WindowEvent &event);
   void onMouseMotionEvent(const SDL_MouseMotionEvent &event);
   void onMouseWheelEvent(const SDL_MouseWheelEvent &event);
   /// \brief Handle gestures
-  void onGesture();
-  void onNoGesture();
+  void onGesture(const GestureSample &sample);
+  /// \brief A gesture started or ended at sensor time \c ms.
+  void onGestureEnter(GestureType type, Uint32 ms);
+  void onGestureExit(GestureType type, Uint32 ms);
+  void onNoGesture(const GestureSample &sample);
   void onSelect();
-  void onPanning();
+  void onPanning(const GestureSample &sample);
   void onZoom(int factor);
-  void onSelectionProgress();
+  void onSelectionProgress(const GestureSample &sample);
   /// \brief Update renderer state for making the transition to Image mode.
   void prepareForGalleryToImageTransition();
   /// \brief Update renderer state for displaying Image view mode (after
@@ -79,18 +224,71 @@ private:
   void renderImageTextures();
   /// \brief Renders all thumbs
   void renderThumbsTexture();
+  /// \brief Render a filled slot for an image that has not finished loading.
+  void renderPlaceholder(const SDL_Rect &dest) const;
+  /// \brief Create textures for images the loader finished decoding.
+  /// \return Number of results taken off the loader completion queue.
+  int uploadDecodedImages();
+  /// \brief Hand a loaded pyramid tile to its image.
+  void uploadTile(Image *img, const ImageLoader::Result &r);
+  /// \brief Load the pyramid tiles the image view needed but did not have.
+  void requestTiles();
+  /// \brief True if \c img is too large to be drawn from a single texture.
+  bool needsPyramid(const Image *img) const;
+  /// \brief Request textures for the images around the visible gallery window
+  ///        and evict the least recently used ones when over budget.
+  void updateResidency();
+  /// \brief requireImage() every image in the visible gallery window and the
+  ///        ones m_prefetcher expects to scroll into view next.
+  void requireGalleryWindow();
+  /// \brief Keep the gallery proxies of image \c index, loading if needed.
+  void requireImage(size_t index);
+  /// \brief Load \c proxies of image \c index again where they are in
+  ///        Tier::Compact but proxyTier() now picks Tier::Full, e.g. once
+  ///        evictions made room or the image was opened.
+  void promoteProxies(size_t index,
+                      std::initializer_list<Image::Proxy> proxies);
+  /// \brief Load the full resolution texture of image \c index.
+  void requestFullResolution(size_t index);
+  /// \brief Rank a load request by how far its image is from what is on
+  ///        screen, ImageLoader::DISCARD once it is out of prefetch range.
+  int loadPriority(const ImageLoader::Request &request) const;
+  /// \brief Images between image \c index and the visible gallery window,
+  ///        0 if it is in there. \c after is set unless it is before the
+  ///        window. The gallery does not wrap around.
+  int galleryDistance(size_t index, bool *after = nullptr) const;
+  /// \brief The tier to upload proxy \c p of image \c index in: compact
+  ///        once the textures take more than COMPACT_PRESSURE of the
+  ///        budget, starting with the images off screen. The opened image
+  ///        is always full.
+  TextureUploader::Tier proxyTier(size_t index, Image::Proxy p) const;
+  /// \brief Mark the load that produced \c r as done, so that the image can
+  ///        be requested again.
+  void finishLoad(const ImageLoader::Result &r);
+  /// \brief Hand the proxies in \c r to \c img, see proxyTier().
+  /// \return false if a texture could not be created.
+  bool setProxies(Image *img, const ImageLoader::Result &r);
+  /// \brief Proxy sizes that match the current window dimensions.
+  ImageLoader::ProxyBoxes getProxyBoxes() const;
+  /// \brief Regenerate the proxies of loaded images in the background, e.g.
+  ///        after the window size changed. Only proxies whose box changed are
+  ///        decoded again, images that failed to load are retried.
+  void rebuildProxies();
   /// \brief Render a rectangle around the texture under the cursor.
   void renderRectangle(const SDL_Rect &dest, int thickness, Uint8 R, Uint8 G, Uint8 B) const;
   /// \brief Update img's position and size for the gallery view mode.
   void updateImageForGalleryView(Image *img, int imgXPos, int imgWidth);
-  /// \brief Update thumb's position and size for the gallery view mode.
-  void updateThumbForGalleryView(Image *thumb, int thumbXPos, int thumbWidth);
+  /// \brief Compute where the strip thumbnail of img goes in gallery view.
+  SDL_Rect getThumbBounds(const Image *img, int thumbXPos,
+                          int thumbWidth) const;
   /// \brief Toggle between windowed and fullscreen modes.
   void toggleFullScreen();
   /// \brief Print info for only SDL_WindowEvents.
   void printEvent(const SDL_Event *) const;
-  /// \brief Shift Candidates
+  /// \brief Shift Candidates, and tell m_prefetcher about it.
   void shiftCandidates(int dx);
+  /// \brief Move the gallery by \c dx pixels, without prefetch bookkeeping.
+  void shiftGallery(int dx);
   /// \brief Convert screen coords to a Gallery View index
   int getGalleryIndexFromCoord(int screen_coords) const;
   /// \brief Convert Gallery View index to Image
@@ -113,8 +311,23 @@ private:
   DisplayMode m_mode;      ///< Gallery view, or image view
   int m_galleryStartIndex; ///< The index within the gallery to start at.
 
-  std::vector<Image *> m_images; ///< Textures currently loaded into memory.
-  std::vector<Image *> m_thumbs; ///< Textures for thumbs
+  enum class LoadState { Idle, Requested, Failed };
+
+  std::vector<Image *> m_images; ///< All gallery images, loaded or not.
+  std::vector<std::string> m_imagePaths; ///< Source file of each m_images.
+  std::vector<LoadState> m_loadStates;   ///< Load progress of each m_images.
+  /// A full resolution or tile pyramid load of each m_images is in flight,
+  /// apart from the proxy loads in m_loadStates.
+  std::vector<bool> m_fullRequested;
+  ImageLoader::ProxyBoxes m_proxyBoxes; ///< What the proxies were made for.
+  ProxyCache *m_proxyCache;      ///< Proxies saved by previous runs.
+  ImageLoader *m_loader;         ///< Decodes m_images in the background.
+  TextureResidency m_residency;  ///< Evicts textures of m_images.
+  TextureUploader *m_uploader;   ///< Creates the textures of m_images.
+  Prefetcher m_prefetcher;       ///< Decides which m_images to load early.
+  int m_prioritizedStartIndex;   ///< m_galleryStartIndex when the load queue
+                                 /// was last reprioritized.
+  DisplayMode m_prioritizedMode; ///< m_mode at that time.
   Image *m_imageModeImage;       ///< The image to display in image view mode.
 
   /// The scaling factor that the gallery to image transition should stop at.
@@ -132,6 +345,37 @@ private:
   int m_willingToQuit;
 
   int m_currentImageSelectIndex; ///< The image index that the user select
+
+  bool m_renderOnDemand; ///< Skip frames when nothing changed.
+  bool m_dirty;          ///< The screen is out of date.
+  Uint32 m_loaderEvent;  ///< SDL event type pushed by m_loader.
+  size_t m_framesRendered;
+  size_t m_framesSkipped;
+  float m_lastStep; ///< SDL ticks in seconds of the last step().
+
+  InputRecorder *m_recorder; ///< Logs the input, nullptr if not recording.
+  InputReplayer *m_replayer; ///< Replaces live input, nullptr if not replaying.
+  GestureTracker *m_tracker; ///< Gesture input, nullptr if there is none.
+  LatencyTracer m_latency;
+  /// Gestures handled since the last frame was presented.
+  std::vector<LatencyTracer::Stamps> m_unpresented;
+  CursorPredictor *m_predictor; ///< nullptr if the cursor is not predicted.
+  Uint64 m_gestureCaptured; ///< LatencyTracer::Stamps::captured of the
+                            /// gesture being handled.
+
+  bool m_lateLatch;
+  bool m_framePacing;
+  float m_refreshMs;     ///< Display refresh interval.
+  double m_frameCostMs;  ///< Average time from input to present.
+  Uint64 m_lastPresent;  ///< SDL_GetPerformanceCounter() after the last
+                         /// present, 0 before the first.
+  size_t m_framesPaced;  ///< Frames that were delayed by paceFrame().
+  double m_pacingMs;     ///< Total delay added by paceFrame().
+
+  bool m_startFullScreen;
+  bool m_softwareRenderer;
+  std::string m_proxyCacheDir;
+  size_t m_proxyCacheLimit;
 };
 
 #endif // ! epic_renderer_h__
@@ -0,0 +1,77 @@
+#include "residency.h"
+#include "image.h"
+
+#include <iterator>
+
+////////////////////////////////////////////////////////////////////////////
+TextureResidency::TextureResidency(size_t budgetBytes)
+    : m_budget{budgetBytes}, m_residentBytes{0}, m_evictions{0}, m_frame{0} {}
+
+////////////////////////////////////////////////////////////////////////////
+TextureResidency::~TextureResidency() {}
+
+////////////////////////////////////////////////////////////////////////////
+void TextureResidency::add(Image *img) {
+  remove(img);
+
+  size_t bytes{img->getTextureBytes()};
+  m_lru.push_back({img, bytes, m_frame});
+  m_entries[img] = std::prev(m_lru.end());
+  m_residentBytes += bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TextureResidency::remove(Image *img) {
+  auto it = m_entries.find(img);
+  if (it == m_entries.end())
+    return;
+
+  m_residentBytes -= it->second->bytes;
+  m_lru.erase(it->second);
+  m_entries.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TextureResidency::touch(Image *img) {
+  auto it = m_entries.find(img);
+  if (it == m_entries.end())
+    return;
+
+  it->second->frame = m_frame;
+  m_lru.splice(m_lru.end(), m_lru, it->second);
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TextureResidency::update(Image *img) {
+  auto it = m_entries.find(img);
+  if (it == m_entries.end())
+    return;
+
+  const size_t bytes{img->getTextureBytes()};
+  m_residentBytes = m_residentBytes - it->second->bytes + bytes;
+  it->second->bytes = bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool TextureResidency::evictOne() {
+  if (m_lru.empty())
+    return false;
+
+  // Touched images are moved to the back, so if the front one was used this
+  // frame then all of them were.
+  Entry &lru = m_lru.front();
+  if (lru.frame == m_frame)
+    return false;
+
+  Image *img{lru.img};
+  remove(img);
+  img->evict();
+  ++m_evictions;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TextureResidency::trim() {
+  while (m_residentBytes > m_budget && evictOne()) {
+  }
+}
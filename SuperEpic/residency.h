@@ -0,0 +1,78 @@
+#ifndef epic_residency_h__
+#define epic_residency_h__
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+
+class Image;
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Keeps the textures of tracked Images under a byte budget.
+///
+/// Images are kept in least recently used order. Every frame the renderer
+/// calls beginFrame() and then touch() for the images it needs; those are
+/// never evicted during that frame. Everything else is fair game once the
+/// budget is exceeded, starting with the image that was used longest ago.
+////////////////////////////////////////////////////////////////////////////
+class TextureResidency {
+public:
+  explicit TextureResidency(size_t budgetBytes);
+  ~TextureResidency();
+
+  void budget(size_t bytes) { m_budget = bytes; }
+  size_t budget() const { return m_budget; }
+
+  /// \brief Bytes of texture memory held by the tracked images.
+  size_t residentBytes() const { return m_residentBytes; }
+
+  /// \brief Number of tracked images that currently hold a texture.
+  size_t residentCount() const { return m_entries.size(); }
+
+  /// \brief Number of textures dropped since construction.
+  size_t evictionCount() const { return m_evictions; }
+
+  /// \brief Start a new frame, images touched in the previous frame lose
+  ///        their protection from eviction.
+  void beginFrame() { ++m_frame; }
+
+  /// \brief Start tracking \c img, which must hold a texture.
+  ///        Tracked images count as touched in the current frame.
+  void add(Image *img);
+
+  /// \brief Stop tracking \c img without evicting it.
+  void remove(Image *img);
+
+  /// \brief Mark \c img as used in this frame. No-op if not tracked.
+  void touch(Image *img);
+
+  /// \brief Count the textures of \c img again after they changed, e.g.
+  ///        tiles of its TilePyramid came and went. No-op if not tracked.
+  void update(Image *img);
+
+  /// \brief Evict the least recently used image not touched this frame.
+  /// \return false if there was nothing that could be evicted.
+  bool evictOne();
+
+  /// \brief Evict images until the resident bytes fit the budget, or until
+  ///        only images touched this frame are left.
+  void trim();
+
+private:
+  struct Entry {
+    Image *img;
+    size_t bytes;
+    unsigned long long frame; ///< Frame in which img was last touched.
+  };
+  using Lru = std::list<Entry>;
+
+  Lru m_lru; ///< Front is least recently used.
+  std::unordered_map<Image *, Lru::iterator> m_entries;
+
+  size_t m_budget;
+  size_t m_residentBytes;
+  size_t m_evictions;
+  unsigned long long m_frame;
+};
+
+#endif // ! epic_residency_h__
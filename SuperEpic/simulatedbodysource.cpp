@@ -0,0 +1,332 @@
+#include "simulatedbodysource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+using JointType = BodyFrame::JointType;
+using HandState = BodyFrame::HandState;
+
+/// Joints of a person standing 2 m in front of the sensor with the arms
+/// down, relative to the spine base.
+const float REST_POSE[BodyFrame::JOINT_COUNT][3]{
+    {0.0f, 0.0f, 0.0f},     // SpineBase
+    {0.0f, 0.3f, 0.0f},     // SpineMid
+    {0.0f, 0.55f, 0.0f},    // Neck
+    {0.0f, 0.7f, 0.0f},     // Head
+    {-0.18f, 0.5f, 0.0f},   // ShoulderLeft
+    {-0.22f, 0.25f, 0.0f},  // ElbowLeft
+    {-0.24f, 0.05f, 0.0f},  // WristLeft
+    {-0.25f, 0.0f, 0.0f},   // HandLeft
+    {0.18f, 0.5f, 0.0f},    // ShoulderRight
+    {0.22f, 0.25f, 0.0f},   // ElbowRight
+    {0.24f, 0.05f, 0.0f},   // WristRight
+    {0.25f, 0.0f, 0.0f},    // HandRight
+    {-0.1f, -0.05f, 0.0f},  // HipLeft
+    {-0.1f, -0.45f, 0.0f},  // KneeLeft
+    {-0.1f, -0.85f, 0.0f},  // AnkleLeft
+    {-0.1f, -0.9f, -0.1f},  // FootLeft
+    {0.1f, -0.05f, 0.0f},   // HipRight
+    {0.1f, -0.45f, 0.0f},   // KneeRight
+    {0.1f, -0.85f, 0.0f},   // AnkleRight
+    {0.1f, -0.9f, -0.1f},   // FootRight
+    {0.0f, 0.5f, 0.0f},     // SpineShoulder
+    {-0.25f, -0.08f, 0.0f}, // HandTipLeft
+    {-0.22f, -0.02f, 0.0f}, // ThumbLeft
+    {0.25f, -0.08f, 0.0f},  // HandTipRight
+    {0.22f, -0.02f, 0.0f},  // ThumbRight
+};
+
+const float SPINE_BASE[3]{0.0f, -0.2f, 2.0f};
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Where the hands are, relative to the spine base.
+struct Pose {
+  float right[2];
+  float left[2];
+  HandState rightHand;
+  HandState leftHand;
+};
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Writes the frames of the built-in script, one body moving its
+///        hands from pose to pose.
+class ScriptWriter {
+public:
+  explicit ScriptWriter(const Pose &pose) : m_pose(pose), m_ms{0} {}
+
+  /// \brief Jump to \c pose and keep it for \c ms milliseconds.
+  void hold(const Pose &pose, Uint32 ms) {
+    m_pose = pose;
+    move(pose, ms);
+  }
+
+  /// \brief Move the hands to \c to in \c ms milliseconds, with the hand
+  ///        states of \c to from the start.
+  void move(const Pose &to, Uint32 ms) {
+    const Pose from = m_pose;
+    const Uint32 count = ms / SimulatedBodySource::FRAME_MS;
+    for (Uint32 i = 1; i <= count; ++i) {
+      const float t = static_cast<float>(i) / count;
+      Pose p = to;
+      for (int c = 0; c < 2; ++c) {
+        p.right[c] = from.right[c] + (to.right[c] - from.right[c]) * t;
+        p.left[c] = from.left[c] + (to.left[c] - from.left[c]) * t;
+      }
+      emit(p);
+    }
+    m_pose = to;
+  }
+
+  std::vector<BodyFrame> &frames() { return m_frames; }
+
+private:
+  void emit(const Pose &pose) {
+    BodyFrame frame;
+    SDL_zero(frame);
+    frame.ms = m_ms;
+    m_ms += SimulatedBodySource::FRAME_MS;
+
+    BodyFrame::Body &body = frame.bodies[0];
+    body.tracked = true;
+    body.trackingId = 1;
+    body.rightHand = pose.rightHand;
+    body.leftHand = pose.leftHand;
+    for (int j = 0; j < BodyFrame::JOINT_COUNT; ++j) {
+      for (int c = 0; c < 3; ++c) {
+        body.joints[j][c] = SPINE_BASE[c] + REST_POSE[j][c];
+      }
+    }
+
+    // Move the whole hand with the hand joint.
+    const JointType rightJoints[]{JointType::WristRight, JointType::HandRight,
+                                  JointType::HandTipRight,
+                                  JointType::ThumbRight};
+    const JointType leftJoints[]{JointType::WristLeft, JointType::HandLeft,
+                                 JointType::HandTipLeft, JointType::ThumbLeft};
+    const float *restRight = REST_POSE[static_cast<int>(JointType::HandRight)];
+    const float *restLeft = REST_POSE[static_cast<int>(JointType::HandLeft)];
+    for (int c = 0; c < 2; ++c) {
+      for (JointType j : rightJoints) {
+        body.joints[static_cast<int>(j)][c] += pose.right[c] - restRight[c];
+      }
+      for (JointType j : leftJoints) {
+        body.joints[static_cast<int>(j)][c] += pose.left[c] - restLeft[c];
+      }
+    }
+    // Raised hands are held in front of the body.
+    body.joints[static_cast<int>(JointType::HandRight)][2] -= 0.3f;
+    body.joints[static_cast<int>(JointType::HandLeft)][2] -= 0.3f;
+
+    m_frames.push_back(frame);
+  }
+
+  Pose m_pose;
+  Uint32 m_ms;
+  std::vector<BodyFrame> m_frames;
+};
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////
+SimulatedBodySource::SimulatedBodySource(const std::string &path, float speed,
+                                         bool loop)
+    : m_path{path}, m_speed{speed}, m_loop{loop}, m_frames{}, m_next{0},
+      m_start{0}, m_loopOffset{0}, m_started{false}, m_wakeMutex{}, m_wake{},
+      m_interrupted{false} {}
+
+////////////////////////////////////////////////////////////////////////////
+bool SimulatedBodySource::open() {
+  if (m_path.empty()) {
+    m_frames = script();
+  } else if (!load()) {
+    return false;
+  }
+
+  std::cout << "Simulating " << m_frames.size() << " skeleton frames"
+            << (m_path.empty() ? "" : " from " + m_path) << "\n";
+  return !m_frames.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool SimulatedBodySource::load() {
+  std::ifstream file(m_path);
+  if (!file.is_open()) {
+    std::cerr << "The skeleton stream " << m_path << " could not be opened.\n";
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream fields(line);
+    Uint32 ms;
+    int index, right, left;
+    fields >> ms >> index >> right >> left;
+    if (!fields || index < 0 || index >= BodyFrame::MAX_BODIES) {
+      std::cerr << m_path << ":" << lineNumber << ": bad skeleton line\n";
+      return false;
+    }
+
+    if (m_frames.empty() || m_frames.back().ms != ms) {
+      m_frames.emplace_back();
+      SDL_zero(m_frames.back());
+      m_frames.back().ms = ms;
+    }
+
+    BodyFrame::Body &body = m_frames.back().bodies[index];
+    body.tracked = true;
+    body.trackingId = static_cast<Uint64>(index) + 1;
+    body.rightHand = static_cast<HandState>(right);
+    body.leftHand = static_cast<HandState>(left);
+    for (auto &joint : body.joints) {
+      fields >> joint[0] >> joint[1] >> joint[2];
+    }
+    if (!fields) {
+      std::cerr << m_path << ":" << lineNumber << ": expected "
+                << BodyFrame::JOINT_COUNT << " joints\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool SimulatedBodySource::wait(Uint32 timeoutMs) {
+  if (finished())
+    return false;
+
+  std::unique_lock<std::mutex> lock(m_wakeMutex);
+  const Uint32 due = dueIn();
+  if (due > 0 &&
+      m_wake.wait_for(lock, std::chrono::milliseconds(std::min(due, timeoutMs)),
+                      [this] { return m_interrupted; })) {
+    m_interrupted = false;
+    return false;
+  }
+  return due <= timeoutMs;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void SimulatedBodySource::interrupt() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_interrupted = true;
+  }
+  m_wake.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool SimulatedBodySource::acquire(BodyFrame *frame) {
+  if (finished() || dueIn() > 0)
+    return false;
+
+  // The frame counts as captured when it became due.
+  const Uint32 lateMs = m_speed > 0.0f ? SDL_GetTicks() - dueTicks() : 0;
+  const Uint64 captured = SDL_GetPerformanceCounter() -
+                          lateMs * SDL_GetPerformanceFrequency() / 1000;
+
+  const BodyFrame &next = m_frames[m_next];
+  const Uint32 streamMs = next.ms - m_frames.front().ms + m_loopOffset;
+  *frame = next;
+  frame->ms = streamMs;
+  frame->captured = captured;
+
+  if (++m_next == m_frames.size() && m_loop) {
+    m_loopOffset = streamMs + FRAME_MS;
+    m_next = 0;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+Uint32 SimulatedBodySource::dueIn() {
+  const Uint32 now = SDL_GetTicks();
+  if (!m_started) {
+    m_start = now;
+    m_started = true;
+  }
+  if (m_speed <= 0.0f)
+    return 0;
+
+  const Uint32 due = dueTicks();
+  return now < due ? due - now : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+Uint32 SimulatedBodySource::dueTicks() const {
+  const Uint32 streamMs =
+      m_frames[m_next].ms - m_frames.front().ms + m_loopOffset;
+  return m_start + static_cast<Uint32>(streamMs / m_speed);
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool SimulatedBodySource::finished() const {
+  return m_next >= m_frames.size();
+}
+
+////////////////////////////////////////////////////////////////////////////
+std::vector<BodyFrame> SimulatedBodySource::script() {
+  // The right hand steers the cursor inside a rectangle in front of the
+  // right shoulder, see mapHandToCursor(); x 0.05 is the left edge of the
+  // window and 0.35 the right one.
+  const Pose rest{{0.25f, 0.0f}, {-0.25f, 0.0f}, HandState::Open,
+                  HandState::Open};
+  const auto raised = [](float x, float y, HandState right) {
+    return Pose{{x, y}, {-0.25f, 0.0f}, right, HandState::Open};
+  };
+  const auto bothHands = [](float leftX) {
+    return Pose{{0.2f, 0.5f}, {leftX, 0.5f}, HandState::Closed,
+                HandState::Closed};
+  };
+
+  ScriptWriter w{rest};
+  w.hold(rest, 500);
+
+  // Hover over the gallery.
+  w.move(raised(0.2f, 0.5f, HandState::Open), 500);
+  w.move(raised(0.05f, 0.5f, HandState::Open), 1000);
+  w.move(raised(0.35f, 0.5f, HandState::Open), 2000);
+
+  // Pan the gallery a few times: grab, drag to the left, let go.
+  for (int i = 0; i < 3; ++i) {
+    w.hold(raised(0.3f, 0.5f, HandState::Closed), 200);
+    w.move(raised(0.1f, 0.5f, HandState::Closed), 800);
+    w.hold(raised(0.1f, 0.5f, HandState::Closed), 500);
+    w.move(raised(0.3f, 0.5f, HandState::Open), 500);
+  }
+
+  // Select the image in the middle by holding the closed hand still.
+  w.move(raised(0.2f, 0.5f, HandState::Open), 500);
+  w.hold(raised(0.2f, 0.5f, HandState::Open), 500);
+  w.hold(raised(0.2f, 0.5f, HandState::Closed), 1800);
+  w.hold(raised(0.2f, 0.5f, HandState::Open), 300);
+
+  // Zoom into it by pulling the closed hands apart.
+  w.move(Pose{{0.2f, 0.5f}, {-0.05f, 0.5f}, HandState::Open, HandState::Open},
+         300);
+  w.move(bothHands(-0.4f), 1000);
+  w.hold(raised(0.2f, 0.5f, HandState::Open), 1500);
+
+  // Pan around the image.
+  w.hold(raised(0.2f, 0.5f, HandState::Closed), 200);
+  w.move(raised(0.1f, 0.4f, HandState::Closed), 1000);
+  w.move(raised(0.3f, 0.6f, HandState::Closed), 1500);
+  w.move(raised(0.2f, 0.5f, HandState::Open), 500);
+
+  // And zoom back out to the gallery.
+  w.move(Pose{{0.2f, 0.5f}, {-0.4f, 0.5f}, HandState::Open, HandState::Open},
+         300);
+  w.move(bothHands(0.1f), 2000);
+  w.move(rest, 500);
+  w.hold(rest, 1000);
+
+  return w.frames();
+}
@@ -0,0 +1,74 @@
+#ifndef epic_simulatedbodysource_h__
+#define epic_simulatedbodysource_h__
+
+#include "bodysource.h"
+
+#include <SDL.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Plays back a skeleton stream instead of reading a sensor, so the
+///        gesture path can be run and profiled without a Kinect.
+///
+/// The stream is either read from a text file or is the built-in script of
+/// the gestures the renderer knows: hover, pan the gallery, select, zoom
+/// into the image, pan it and zoom back out. The file has one line per
+/// tracked body and frame, lines starting with # are skipped:
+///
+///     ms body right_hand left_hand x y z ... (25 joints)
+///
+/// \c ms is the frame time, lines with the same time make one frame.
+/// \c body is the index in BodyFrame::bodies, the hand states are the
+/// numbers of BodyFrame::HandState and the joints come in JointType order,
+/// in meters.
+////////////////////////////////////////////////////////////////////////////
+class SimulatedBodySource : public BodySource {
+public:
+  /// Frame interval of the built-in script, the 30 Hz of the Kinect.
+  static const Uint32 FRAME_MS = 33;
+
+  /// \param path Stream to read, empty for the built-in script.
+  /// \param speed Playback speed relative to the frame times, 1 for real
+  ///              time, 0 to hand out a frame on every acquire() without
+  ///              waiting.
+  /// \param loop Start over at the end instead of finishing.
+  SimulatedBodySource(const std::string &path, float speed, bool loop);
+
+  bool open() override;
+  bool wait(Uint32 timeoutMs) override;
+  void interrupt() override;
+  bool acquire(BodyFrame *frame) override;
+  bool finished() const override;
+
+  /// \brief The built-in gesture script.
+  static std::vector<BodyFrame> script();
+
+private:
+  bool load();
+  /// \brief Milliseconds until the next frame is due, 0 if it is. Starts
+  ///        the playback clock on the first call.
+  Uint32 dueIn();
+  /// \brief SDL ticks the next frame is due at.
+  Uint32 dueTicks() const;
+
+  std::string m_path;
+  float m_speed;
+  bool m_loop;
+
+  std::vector<BodyFrame> m_frames;
+  size_t m_next;       ///< Next frame to hand out.
+  Uint32 m_start;      ///< SDL ticks when playback started.
+  Uint32 m_loopOffset; ///< Added to the frame times after looping.
+  bool m_started;
+
+  // Lets interrupt() cut a wait() short.
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  bool m_interrupted;
+};
+
+#endif // ! epic_simulatedbodysource_h__
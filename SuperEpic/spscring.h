@@ -0,0 +1,70 @@
+#ifndef epic_spscring_h__
+#define epic_spscring_h__
+
+#include <atomic>
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Fixed size, lock-free queue from exactly one producer thread to
+///        exactly one consumer thread.
+///
+/// push() is only called by the producer and pop() only by the consumer.
+/// The head and tail counters run freely and are only ever written by one
+/// side each, so a release store on one side and an acquire load on the
+/// other is all the synchronization needed. They are padded apart so that
+/// the two threads do not false share a cache line. (Padding rather than
+/// alignas, operator new does not honour over-alignment before C++17.)
+////////////////////////////////////////////////////////////////////////////
+template <typename T, size_t Capacity> class SpscRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  SpscRing() : m_head{0}, m_tail{0} {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  /// \brief Append \c item, producer only.
+  /// \return false, dropping \c item, if the ring is full.
+  bool push(const T &item) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+      return false;
+
+    m_items[tail & (Capacity - 1)] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// \brief Take the oldest item, consumer only.
+  /// \return false if the ring is empty.
+  bool pop(T *item) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+
+    *item = m_items[head & (Capacity - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// \brief Items queued, may already be stale when read by either side.
+  size_t size() const {
+    return m_tail.load(std::memory_order_acquire) -
+           m_head.load(std::memory_order_acquire);
+  }
+
+  static size_t capacity() { return Capacity; }
+
+private:
+  static const size_t CACHE_LINE = 64;
+
+  std::atomic<size_t> m_head; ///< Next item to pop.
+  char m_headPadding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail; ///< Next slot to push to.
+  char m_tailPadding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+  T m_items[Capacity];
+};
+
+#endif // ! epic_spscring_h__
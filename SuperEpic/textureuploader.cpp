@@ -0,0 +1,245 @@
+#include "textureuploader.h"
+#include "pixelkernels.h"
+#include "yuvimage.h"
+
+#include <cstring>
+
+namespace {
+/// \brief Renderers whose SDL_LockTexture() hands out the texture memory,
+///        or a mapping of it, instead of a copy kept next to the texture.
+bool locksTextureMemory(const char *name) {
+  return std::strcmp(name, "software") == 0 ||
+         std::strcmp(name, "direct3d11") == 0;
+}
+
+/// \brief True if upload() can copy \c surf with SDL_ConvertPixels() into a
+///        texture of \c format.
+bool canConvert(const SDL_Surface *surf, Uint32 format) {
+  const Uint32 from{surf->format->format};
+  if (from == SDL_PIXELFORMAT_UNKNOWN || SDL_ISPIXELFORMAT_INDEXED(from) ||
+      SDL_ISPIXELFORMAT_FOURCC(from) || SDL_MUSTLOCK(surf))
+    return false;
+
+  // Color keys become alpha in SDL_CreateTextureFromSurface().
+  if (SDL_GetColorKey(const_cast<SDL_Surface *>(surf), nullptr) == 0)
+    return false;
+
+  return !SDL_ISPIXELFORMAT_ALPHA(from) || SDL_ISPIXELFORMAT_ALPHA(format);
+}
+
+/// \brief True if \c surf is ARGB8888 without a single translucent pixel,
+///        so that it loses nothing but colour in a compact format.
+bool isOpaqueArgb(const SDL_Surface *surf) {
+  if (surf->format->format != SDL_PIXELFORMAT_ARGB8888 || SDL_MUSTLOCK(surf))
+    return false;
+
+  Uint32 alpha{0xff000000u};
+  for (int y = 0; y < surf->h; ++y) {
+    const Uint32 *row{reinterpret_cast<const Uint32 *>(
+        static_cast<const Uint8 *>(surf->pixels) + y * surf->pitch)};
+    for (int x = 0; x < surf->w; ++x) {
+      alpha &= row[x];
+    }
+    if ((alpha >> 24) != 0xff)
+      return false;
+  }
+  return true;
+}
+} // namespace
+
+const size_t TextureUploader::STAGING_KEEP_BYTES{16 * 1024 * 1024};
+
+////////////////////////////////////////////////////////////////////////////
+TextureUploader::TextureUploader(SDL_Renderer *renderer)
+    : m_renderer{renderer}, m_format{SDL_PIXELFORMAT_ARGB8888},
+      m_streaming{false}, m_yuv{false},
+      m_compactFormat{SDL_PIXELFORMAT_UNKNOWN}, m_staging{}, m_streamed{0},
+      m_updated{0}, m_staged{0}, m_fallbacks{0}, m_yuvUploads{0},
+      m_compactUploads{0}, m_uploadMs{0.0} {
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) != 0)
+    return;
+
+  // Listed in order of preference, ARGB8888 first for most renderers.
+  bool found{false}, rgb565{false};
+  for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+    const Uint32 format{info.texture_formats[i]};
+    if (format == SDL_PIXELFORMAT_IYUV)
+      m_yuv = true;
+    if (format == SDL_PIXELFORMAT_RGB565)
+      rgb565 = true;
+    if (!found && !SDL_ISPIXELFORMAT_FOURCC(format)) {
+      m_format = format;
+      found = true;
+    }
+  }
+  m_streaming = locksTextureMemory(info.name);
+
+  // Formats the renderer does not list are emulated by SDL in the native
+  // one, which would save nothing.
+  if (m_yuv)
+    m_compactFormat = SDL_PIXELFORMAT_IYUV;
+  else if (rgb565 && SDL_BYTESPERPIXEL(m_format) > 2)
+    m_compactFormat = SDL_PIXELFORMAT_RGB565;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Texture *TextureUploader::upload(SDL_Surface *surf, Tier tier,
+                                     Tier *made) {
+  const Uint64 start{SDL_GetPerformanceCounter()};
+
+  SDL_Texture *tex{nullptr};
+  if (tier == Tier::Compact && m_compactFormat != SDL_PIXELFORMAT_UNKNOWN &&
+      isOpaqueArgb(surf))
+    tex = uploadCompact(surf);
+
+  if (made != nullptr)
+    *made = tex != nullptr ? Tier::Compact : Tier::Full;
+
+  if (tex != nullptr) {
+    ++m_compactUploads;
+  } else if (!canConvert(surf, m_format)) {
+    tex = SDL_CreateTextureFromSurface(m_renderer, surf);
+    if (tex != nullptr)
+      ++m_fallbacks;
+  } else {
+    if (m_streaming)
+      tex = lockAndCopy(surf);
+    // Also when the lock failed, the texture memory may be busy.
+    if (tex == nullptr)
+      tex = updateStatic(surf);
+
+    if (tex != nullptr && SDL_ISPIXELFORMAT_ALPHA(surf->format->format))
+      SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+  }
+
+  m_uploadMs += (SDL_GetPerformanceCounter() - start) * 1000.0 /
+                SDL_GetPerformanceFrequency();
+  return tex;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Texture *TextureUploader::lockAndCopy(SDL_Surface *surf) {
+  SDL_Texture *tex{SDL_CreateTexture(m_renderer, m_format,
+                                     SDL_TEXTUREACCESS_STREAMING, surf->w,
+                                     surf->h)};
+  if (tex == nullptr)
+    return nullptr;
+
+  void *pixels;
+  int pitch;
+  if (SDL_LockTexture(tex, nullptr, &pixels, &pitch) != 0) {
+    SDL_DestroyTexture(tex);
+    return nullptr;
+  }
+  const int converted{SDL_ConvertPixels(surf->w, surf->h,
+                                        surf->format->format, surf->pixels,
+                                        surf->pitch, m_format, pixels, pitch)};
+  SDL_UnlockTexture(tex);
+  if (converted != 0) {
+    SDL_DestroyTexture(tex);
+    return nullptr;
+  }
+
+  ++m_streamed;
+  return tex;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Texture *TextureUploader::updateStatic(SDL_Surface *surf) {
+  SDL_Texture *tex{SDL_CreateTexture(m_renderer, m_format,
+                                     SDL_TEXTUREACCESS_STATIC, surf->w,
+                                     surf->h)};
+  if (tex == nullptr)
+    return nullptr;
+
+  const void *pixels{surf->pixels};
+  int pitch{surf->pitch};
+  const bool staged{surf->format->format != m_format};
+  if (staged) {
+    pitch = surf->w * SDL_BYTESPERPIXEL(m_format);
+    m_staging.resize(static_cast<size_t>(pitch) * surf->h);
+    if (SDL_ConvertPixels(surf->w, surf->h, surf->format->format,
+                          surf->pixels, surf->pitch, m_format,
+                          m_staging.data(), pitch) != 0) {
+      SDL_DestroyTexture(tex);
+      return nullptr;
+    }
+    pixels = m_staging.data();
+  }
+
+  const int updated{SDL_UpdateTexture(tex, nullptr, pixels, pitch)};
+  if (m_staging.capacity() > STAGING_KEEP_BYTES)
+    std::vector<Uint8>{}.swap(m_staging);
+  if (updated != 0) {
+    SDL_DestroyTexture(tex);
+    return nullptr;
+  }
+
+  ++m_updated;
+  if (staged)
+    ++m_staged;
+  return tex;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Texture *TextureUploader::uploadCompact(SDL_Surface *surf) {
+  SDL_Texture *tex{SDL_CreateTexture(m_renderer, m_compactFormat,
+                                     SDL_TEXTUREACCESS_STATIC, surf->w,
+                                     surf->h)};
+  if (tex == nullptr)
+    return nullptr;
+
+  int updated;
+  if (m_compactFormat == SDL_PIXELFORMAT_IYUV) {
+    const size_t lumaSize{static_cast<size_t>(surf->w) * surf->h};
+    const int cw{(surf->w + 1) / 2};
+    const size_t chromaSize{static_cast<size_t>(cw) * ((surf->h + 1) / 2)};
+    m_staging.resize(lumaSize + 2 * chromaSize);
+    Uint8 *y{m_staging.data()};
+    Uint8 *u{y + lumaSize};
+    Uint8 *v{u + chromaSize};
+    PixelKernels::best().argbToYuv420(surf, y, u, v);
+    updated = SDL_UpdateYUVTexture(tex, nullptr, y, surf->w, u, cw, v, cw);
+  } else {
+    const int pitch{surf->w * 2};
+    m_staging.resize(static_cast<size_t>(pitch) * surf->h);
+    updated = SDL_ConvertPixels(surf->w, surf->h, surf->format->format,
+                                surf->pixels, surf->pitch, m_compactFormat,
+                                m_staging.data(), pitch);
+    if (updated == 0)
+      updated = SDL_UpdateTexture(tex, nullptr, m_staging.data(), pitch);
+  }
+
+  if (m_staging.capacity() > STAGING_KEEP_BYTES)
+    std::vector<Uint8>{}.swap(m_staging);
+  if (updated != 0) {
+    SDL_DestroyTexture(tex);
+    return nullptr;
+  }
+  return tex;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Texture *TextureUploader::uploadYUV(const YUVImage &yuv) {
+  if (!m_yuv)
+    return nullptr;
+
+  const Uint64 start{SDL_GetPerformanceCounter()};
+  SDL_Texture *tex{SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_IYUV,
+                                     SDL_TEXTUREACCESS_STATIC, yuv.w, yuv.h)};
+  if (tex != nullptr) {
+    const int cw{(yuv.w + 1) / 2};
+    if (SDL_UpdateYUVTexture(tex, nullptr, yuv.y.data(), yuv.w, yuv.u.data(),
+                             cw, yuv.v.data(), cw) == 0) {
+      ++m_yuvUploads;
+    } else {
+      SDL_DestroyTexture(tex);
+      tex = nullptr;
+    }
+  }
+
+  m_uploadMs += (SDL_GetPerformanceCounter() - start) * 1000.0 /
+                SDL_GetPerformanceFrequency();
+  return tex;
+}
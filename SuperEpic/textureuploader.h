@@ -0,0 +1,125 @@
+#ifndef epic_textureuploader_h__
+#define epic_textureuploader_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+#include <vector>
+
+struct YUVImage;
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Turns decoded surfaces into textures in the renderer's native
+///        format, without the intermediate surfaces of
+///        SDL_CreateTextureFromSurface().
+///
+/// Decoding happens on the ImageLoader threads, but textures may only be
+/// touched by the thread that created the renderer, so the decoded surface
+/// is the one buffer handed between the two. upload() then writes its rows
+/// in a single pass, converting on the fly when the formats differ:
+///
+///  - Where SDL_LockTexture() exposes the texture memory itself (the
+///    software and Direct3D 11 renderers) into a locked streaming texture.
+///  - Elsewhere, e.g. OpenGL, where a streaming texture keeps a second copy
+///    of its pixels in system memory for as long as it lives, into a static
+///    texture with SDL_UpdateTexture(). Straight from the surface if it is
+///    in the native format already, otherwise through a staging buffer that
+///    is reused from upload to upload.
+///
+/// Surfaces this cannot handle, e.g. paletted or color keyed ones, still go
+/// through SDL_CreateTextureFromSurface(). Images decoded to planar YUV are
+/// uploaded as they are with uploadYUV(). Tier::Compact textures are
+/// converted into the staging buffer, see upload().
+////////////////////////////////////////////////////////////////////////////
+class TextureUploader {
+public:
+  /// \brief How much of the source a texture keeps.
+  enum class Tier : int {
+    Full,   ///< All of it: the native format, or IYUV for YUV sources.
+    Compact ///< Less, in compactFormat(), to save texture memory.
+  };
+  static const int NUM_TIERS = 2;
+
+  explicit TextureUploader(SDL_Renderer *renderer);
+
+  /// \brief Create a texture with the pixels of \c surf, which is left
+  ///        alone. Must be called from the thread that created the renderer.
+  ///
+  /// Tier::Compact is only honoured for opaque ARGB8888 surfaces and when
+  /// there is a compactFormat(), anything else gets a Tier::Full texture.
+  ///
+  /// \param made If not nullptr, set to the tier the texture was made in.
+  /// \return nullptr if no texture could be created, e.g. out of memory.
+  SDL_Texture *upload(SDL_Surface *surf, Tier tier = Tier::Full,
+                      Tier *made = nullptr);
+
+  /// \brief Create an SDL_PIXELFORMAT_IYUV texture with the planes of
+  ///        \c yuv, converted to RGB by the renderer when drawing. Same
+  ///        rules as upload(), and only if yuv() is true.
+  SDL_Texture *uploadYUV(const YUVImage &yuv);
+
+  /// \brief The format textures are created in.
+  Uint32 format() const { return m_format; }
+
+  /// \brief True if the renderer draws IYUV textures itself. SDL emulates
+  ///        them for the others, with an RGB copy next to the planes.
+  bool yuv() const { return m_yuv; }
+
+  /// \brief The format of Tier::Compact textures: IYUV at 1.5 bytes per
+  ///        pixel, or RGB565 at 2 if the renderer has no IYUV.
+  ///        SDL_PIXELFORMAT_UNKNOWN if it draws neither itself, or if
+  ///        format() is no larger than RGB565 anyway.
+  Uint32 compactFormat() const { return m_compactFormat; }
+
+  /// \brief True if textures are written through SDL_LockTexture().
+  bool streaming() const { return m_streaming; }
+
+  /// \brief Textures written through SDL_LockTexture().
+  size_t streamedCount() const { return m_streamed; }
+
+  /// \brief Textures written with SDL_UpdateTexture(), including staged.
+  size_t updatedCount() const { return m_updated; }
+
+  /// \brief Textures converted through the staging buffer first.
+  size_t stagedCount() const { return m_staged; }
+
+  /// \brief Textures left to SDL_CreateTextureFromSurface().
+  size_t fallbackCount() const { return m_fallbacks; }
+
+  /// \brief Textures made by uploadYUV().
+  size_t yuvCount() const { return m_yuvUploads; }
+
+  /// \brief Textures made in compactFormat().
+  size_t compactCount() const { return m_compactUploads; }
+
+  /// \brief Time spent in upload() and uploadYUV(), in milliseconds.
+  double uploadMs() const { return m_uploadMs; }
+
+  /// \brief Bytes held by the staging buffer between uploads.
+  size_t stagingBytes() const { return m_staging.capacity(); }
+
+private:
+  /// The staging buffer is given back after an upload larger than this, a
+  /// full resolution image would otherwise pin its size for good.
+  static const size_t STAGING_KEEP_BYTES;
+
+  SDL_Texture *lockAndCopy(SDL_Surface *surf);
+  SDL_Texture *updateStatic(SDL_Surface *surf);
+  SDL_Texture *uploadCompact(SDL_Surface *surf);
+
+  SDL_Renderer *m_renderer;
+  Uint32 m_format;              ///< First non-YUV format the renderer lists.
+  bool m_streaming;             ///< Lock streaming textures, see above.
+  bool m_yuv;                   ///< The renderer lists SDL_PIXELFORMAT_IYUV.
+  Uint32 m_compactFormat;       ///< See compactFormat().
+  std::vector<Uint8> m_staging; ///< Converted pixels for SDL_UpdateTexture().
+  size_t m_streamed;
+  size_t m_updated;
+  size_t m_staged;
+  size_t m_fallbacks;
+  size_t m_yuvUploads;
+  size_t m_compactUploads;
+  double m_uploadMs;
+};
+
+#endif // ! epic_textureuploader_h__
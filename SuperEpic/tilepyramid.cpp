@@ -0,0 +1,220 @@
+#include "tilepyramid.h"
+#include "image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+const int TilePyramid::TILE_SIZE;
+const size_t TilePyramid::MAX_RESIDENT_TILES;
+
+////////////////////////////////////////////////////////////////////////////
+int TilePyramid::levelCount(const SDL_Point &dims) {
+  int levels{1};
+  SDL_Point d{dims};
+  while (d.x > TILE_SIZE || d.y > TILE_SIZE) {
+    d = {(d.x + 1) / 2, (d.y + 1) / 2};
+    ++levels;
+  }
+  return levels;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Point TilePyramid::levelDims(const SDL_Point &dims, int level) {
+  SDL_Point d{dims};
+  for (int i = 0; i < level; ++i) {
+    d = {(d.x + 1) / 2, (d.y + 1) / 2};
+  }
+  return d;
+}
+
+////////////////////////////////////////////////////////////////////////////
+std::string TilePyramid::tileEntry(const TileId &tile) {
+  std::ostringstream entry;
+  entry << "tile" << TILE_SIZE << '-' << tile.level << '-' << tile.col << '-'
+        << tile.row;
+  return entry.str();
+}
+
+////////////////////////////////////////////////////////////////////////////
+std::string TilePyramid::manifestEntry() {
+  std::ostringstream entry;
+  entry << "pyramid" << TILE_SIZE;
+  return entry.str();
+}
+
+////////////////////////////////////////////////////////////////////////////
+TilePyramid::TilePyramid(const SDL_Point &dims)
+    : m_dims{dims}, m_levels{levelCount(dims)}, m_frame{0},
+      m_residentCount{0} {}
+
+////////////////////////////////////////////////////////////////////////////
+TilePyramid::~TilePyramid() {
+  for (auto &t : m_tiles) {
+    if (t.second.texture != nullptr)
+      SDL_DestroyTexture(t.second.texture);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TilePyramid::draw(const SDL_Rect &bbox, const SDL_Rect &viewport) {
+  ++m_frame;
+  if (bbox.w <= 0 || bbox.h <= 0)
+    return;
+
+  // The single tile of the coarsest level is the fallback for everything.
+  const int top{m_levels - 1};
+  if (residentTile({top, 0, 0}) == nullptr)
+    want({top, 0, 0});
+
+  // Coarsest level that still has at least one texel per screen pixel.
+  const float s{bbox.w / static_cast<float>(m_dims.x)};
+  int level{0};
+  while (level < top && (1 << (level + 1)) * s <= 1.0f) {
+    ++level;
+  }
+
+  const SDL_Point ld{levelDims(m_dims, level)};
+  const float fx{bbox.w / static_cast<float>(ld.x)};
+  const float fy{bbox.h / static_cast<float>(ld.y)};
+
+  // Visible part of the image, in level pixels.
+  const float lx0{(std::max(viewport.x, bbox.x) - bbox.x) / fx};
+  const float ly0{(std::max(viewport.y, bbox.y) - bbox.y) / fy};
+  const float lx1{
+      (std::min(viewport.x + viewport.w, bbox.x + bbox.w) - bbox.x) / fx};
+  const float ly1{
+      (std::min(viewport.y + viewport.h, bbox.y + bbox.h) - bbox.y) / fy};
+  if (lx1 <= lx0 || ly1 <= ly0) {
+    trim();
+    return;
+  }
+
+  const int c0{static_cast<int>(lx0) / TILE_SIZE};
+  const int r0{static_cast<int>(ly0) / TILE_SIZE};
+  const int c1{std::min((static_cast<int>(std::ceil(lx1)) - 1) / TILE_SIZE,
+                        (ld.x - 1) / TILE_SIZE)};
+  const int r1{std::min((static_cast<int>(std::ceil(ly1)) - 1) / TILE_SIZE,
+                        (ld.y - 1) / TILE_SIZE)};
+
+  SDL_Renderer *ren{Image::sdl_renderer()};
+  for (int r = r0; r <= r1; ++r) {
+    for (int c = c0; c <= c1; ++c) {
+      SDL_Rect area{c * TILE_SIZE, r * TILE_SIZE,
+                    std::min(TILE_SIZE, ld.x - c * TILE_SIZE),
+                    std::min(TILE_SIZE, ld.y - r * TILE_SIZE)};
+
+      // Both edges are rounded the same way so neighbours do not leave seams.
+      SDL_Rect dest;
+      dest.x = bbox.x + static_cast<int>(area.x * fx);
+      dest.y = bbox.y + static_cast<int>(area.y * fy);
+      dest.w = bbox.x + static_cast<int>((area.x + area.w) * fx) - dest.x;
+      dest.h = bbox.y + static_cast<int>((area.y + area.h) * fy) - dest.y;
+
+      SDL_Texture *tex{residentTile({level, c, r})};
+      if (tex != nullptr) {
+        SDL_RenderCopy(ren, tex, nullptr, &dest);
+      } else {
+        want({level, c, r});
+        drawFallback(level, area, dest);
+      }
+    }
+  }
+
+  trim();
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TilePyramid::drawFallback(int level, const SDL_Rect &area,
+                               const SDL_Rect &dest) {
+  for (int l = level + 1; l < m_levels; ++l) {
+    const int shift{l - level};
+    const int col{(area.x >> shift) / TILE_SIZE};
+    const int row{(area.y >> shift) / TILE_SIZE};
+
+    SDL_Texture *tex{residentTile({l, col, row})};
+    if (tex == nullptr)
+      continue;
+
+    const int x0{(area.x >> shift) - col * TILE_SIZE};
+    const int y0{(area.y >> shift) - row * TILE_SIZE};
+    SDL_Rect src{x0, y0, std::max(1, area.w >> shift),
+                 std::max(1, area.h >> shift)};
+    SDL_RenderCopy(Image::sdl_renderer(), tex, &src, &dest);
+    return;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Texture *TilePyramid::residentTile(const TileId &tile) {
+  auto it = m_tiles.find(tile);
+  if (it == m_tiles.end() || it->second.texture == nullptr)
+    return nullptr;
+
+  it->second.lastUsed = m_frame;
+  return it->second.texture;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TilePyramid::want(const TileId &tile) {
+  if (m_tiles.find(tile) != m_tiles.end())
+    return; // Already on its way.
+
+  m_tiles[tile] = {nullptr, m_frame};
+  m_wanted.push_back(tile);
+}
+
+////////////////////////////////////////////////////////////////////////////
+std::vector<TilePyramid::TileId> TilePyramid::takeWanted() {
+  std::vector<TileId> wanted;
+  wanted.swap(m_wanted);
+  return wanted;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TilePyramid::setTile(const TileId &tile, SDL_Surface *surf) {
+  SDL_Texture *tex{Image::createTexture(surf)};
+
+  auto it = m_tiles.find(tile);
+  if (tex == nullptr) {
+    // Forget about it, it is requested again the next time it is needed.
+    if (it != m_tiles.end() && it->second.texture == nullptr)
+      m_tiles.erase(it);
+    return;
+  }
+
+  if (it != m_tiles.end() && it->second.texture != nullptr) {
+    SDL_DestroyTexture(it->second.texture);
+    --m_residentCount;
+  }
+  m_tiles[tile] = {tex, m_frame};
+  ++m_residentCount;
+}
+
+////////////////////////////////////////////////////////////////////////////
+size_t TilePyramid::getTextureBytes() const {
+  return m_residentCount * TILE_SIZE * TILE_SIZE * 4;
+}
+
+////////////////////////////////////////////////////////////////////////////
+void TilePyramid::trim() {
+  const TileId top{m_levels - 1, 0, 0};
+  while (m_residentCount > MAX_RESIDENT_TILES) {
+    auto lru = m_tiles.end();
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+      if (it->second.texture == nullptr || it->second.lastUsed == m_frame ||
+          it->first == top) {
+        continue;
+      }
+      if (lru == m_tiles.end() || it->second.lastUsed < lru->second.lastUsed)
+        lru = it;
+    }
+
+    if (lru == m_tiles.end())
+      return; // Everything left is on screen.
+
+    SDL_DestroyTexture(lru->second.texture);
+    m_tiles.erase(lru);
+    --m_residentCount;
+  }
+}
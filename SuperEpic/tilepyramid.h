@@ -0,0 +1,95 @@
+#ifndef epic_tilepyramid_h__
+#define epic_tilepyramid_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Multi-resolution tiled representation of one large image.
+///
+/// Level 0 is the full resolution image, every following level is half the
+/// size of the previous one, the last level fits in a single tile. The tile
+/// pixels live in the ProxyCache and are uploaded as textures only when a
+/// draw() needs them; the pyramid keeps at most MAX_RESIDENT_TILES of them.
+////////////////////////////////////////////////////////////////////////////
+class TilePyramid {
+public:
+  static const int TILE_SIZE = 512;
+  static const size_t MAX_RESIDENT_TILES = 96;
+
+  struct TileId {
+    int level;
+    int col;
+    int row;
+
+    bool operator==(const TileId &o) const {
+      return level == o.level && col == o.col && row == o.row;
+    }
+
+    bool operator<(const TileId &o) const {
+      if (level != o.level)
+        return level < o.level;
+      if (row != o.row)
+        return row < o.row;
+      return col < o.col;
+    }
+  };
+
+  /// \brief Number of levels in the pyramid of an image of size \c dims.
+  static int levelCount(const SDL_Point &dims);
+  /// \brief Dimensions of \c level of the pyramid of an image of size \c dims.
+  static SDL_Point levelDims(const SDL_Point &dims, int level);
+  /// \brief ProxyCache entry name of a tile.
+  static std::string tileEntry(const TileId &tile);
+  /// \brief ProxyCache entry that marks a complete pyramid, written last.
+  static std::string manifestEntry();
+
+  explicit TilePyramid(const SDL_Point &dims);
+  ~TilePyramid();
+
+  int levels() const { return m_levels; }
+
+  /// \brief Draw the tiles of the image at \c bbox that intersect \c viewport,
+  ///        at the level that matches the on-screen scale. Missing tiles are
+  ///        filled in from the nearest coarser level that is resident.
+  void draw(const SDL_Rect &bbox, const SDL_Rect &viewport);
+
+  /// \brief Tiles draw() needed but did not have and that have not been
+  ///        requested yet. They count as requested after this call.
+  std::vector<TileId> takeWanted();
+
+  /// \brief Upload the pixels of a tile, takes ownership of \c surf.
+  void setTile(const TileId &tile, SDL_Surface *surf);
+
+  /// \brief Texture memory held by resident tiles.
+  size_t getTextureBytes() const;
+
+private:
+  struct Tile {
+    SDL_Texture *texture;       ///< nullptr while loading.
+    unsigned long long lastUsed; ///< draw() call that last needed this tile.
+  };
+
+  /// \brief Look up a resident tile and mark it as used.
+  SDL_Texture *residentTile(const TileId &tile);
+  /// \brief Remember that \c tile is needed, unless it already was.
+  void want(const TileId &tile);
+  /// \brief Draw \c dest with the part of a coarser resident tile covering
+  ///        level \c level pixels \c area.
+  void drawFallback(int level, const SDL_Rect &area, const SDL_Rect &dest);
+  /// \brief Drop the least recently used tiles over MAX_RESIDENT_TILES.
+  void trim();
+
+  SDL_Point m_dims;
+  int m_levels;
+  std::map<TileId, Tile> m_tiles; ///< Resident and requested tiles.
+  std::vector<TileId> m_wanted;
+  unsigned long long m_frame;
+  size_t m_residentCount;
+};
+
+#endif // ! epic_tilepyramid_h__
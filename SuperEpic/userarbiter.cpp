@@ -0,0 +1,134 @@
+#include "userarbiter.h"
+
+#include <algorithm>
+
+const Uint32 UserArbiter::HANDOFF_MS;
+
+////////////////////////////////////////////////////////////////////////////
+UserArbiter::UserArbiter(Policy policy)
+    : m_policy{policy}, m_controller{0}, m_candidate{0}, m_candidateSince{0},
+      m_raisedId{}, m_raisedMs{}, m_handoffs{0} {}
+
+////////////////////////////////////////////////////////////////////////////
+const char *UserArbiter::name(Policy policy) {
+  switch (policy) {
+  case Policy::Closest:
+    return "closest";
+  case Policy::Engaged:
+    return "engaged";
+  case Policy::RaisedHand:
+    return "raised";
+  }
+  return "";
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool UserArbiter::parse(const std::string &name, Policy *policy) {
+  for (Policy p : {Policy::Closest, Policy::Engaged, Policy::RaisedHand}) {
+    if (name == UserArbiter::name(p)) {
+      *policy = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+bool UserArbiter::score(const BodyFrame &frame, int index, float *score) {
+  using JointType = BodyFrame::JointType;
+  const BodyFrame::Body &body = frame.bodies[index];
+  const float *spine = body.joint(JointType::SpineBase);
+  const float *left = body.joint(JointType::HandLeft);
+  const float *right = body.joint(JointType::HandRight);
+
+  switch (m_policy) {
+  case Policy::Closest:
+    *score = -spine[2];
+    return true;
+  case Policy::Engaged:
+    // Camera z grows away from the sensor.
+    *score = spine[2] - std::min(left[2], right[2]);
+    return true;
+  case Policy::RaisedHand: {
+    const float head = body.joint(JointType::Head)[1];
+    if (left[1] < head && right[1] < head) {
+      m_raisedId[index] = 0;
+      return false;
+    }
+    if (m_raisedId[index] != body.trackingId) {
+      m_raisedId[index] = body.trackingId;
+      m_raisedMs[index] = frame.ms;
+    }
+    // The longer the hand has been up, the earlier it was raised.
+    *score = static_cast<float>(frame.ms - m_raisedMs[index]);
+    return true;
+  }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+int UserArbiter::select(const BodyFrame &frame,
+                        const GestureSample *gestures) {
+  int current = -1; // The user in control.
+  int best = -1;    // The user the policy likes best.
+  int closest = -1;
+  float bestScore = 0.0f;
+  for (int i = 0; i < BodyFrame::MAX_BODIES; ++i) {
+    const BodyFrame::Body &body = frame.bodies[i];
+    if (!body.tracked) {
+      m_raisedId[i] = 0;
+      continue;
+    }
+
+    if (body.trackingId == m_controller)
+      current = i;
+    const float z = body.joint(BodyFrame::JointType::SpineBase)[2];
+    if (closest < 0 ||
+        z < frame.bodies[closest].joint(BodyFrame::JointType::SpineBase)[2])
+      closest = i;
+
+    float s;
+    if (score(frame, i, &s) && (best < 0 || s > bestScore)) {
+      best = i;
+      bestScore = s;
+    }
+  }
+
+  if (current < 0) {
+    // Nobody in control, or the user in control left.
+    if (best < 0)
+      best = closest;
+    m_candidate = 0;
+    if (best < 0) {
+      m_controller = 0;
+      return -1;
+    }
+    if (m_controller != 0)
+      ++m_handoffs;
+    m_controller = frame.bodies[best].trackingId;
+    return best;
+  }
+
+  // Stay with the user in control while they are the best choice, or while
+  // either user is in the middle of a gesture.
+  if (best < 0 || best == current ||
+      gestures[current].type != GestureType::None ||
+      gestures[best].type != GestureType::None) {
+    m_candidate = 0;
+    return current;
+  }
+
+  const Uint64 id = frame.bodies[best].trackingId;
+  if (m_candidate != id) {
+    m_candidate = id;
+    m_candidateSince = frame.ms;
+  }
+  if (frame.ms - m_candidateSince < HANDOFF_MS)
+    return current;
+
+  m_controller = id;
+  m_candidate = 0;
+  ++m_handoffs;
+  return best;
+}
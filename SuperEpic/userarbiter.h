@@ -0,0 +1,67 @@
+#ifndef epic_userarbiter_h__
+#define epic_userarbiter_h__
+
+#include "bodysource.h"
+#include "gesture.h"
+
+#include <SDL.h>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Picks the one user, of all bodies in a frame, whose gestures
+///        steer the renderer.
+///
+/// - Closest: the body nearest to the sensor.
+/// - Engaged: the body reaching furthest towards the screen with either
+///   hand.
+/// - RaisedHand: the first body to raise a hand above the head. Until
+///   anyone has, the closest body.
+///
+/// Control is handed off cleanly: never in the middle of a gesture of
+/// either user, and only once another user has been the better choice for
+/// HANDOFF_MS. If the user in control is lost, the best other one takes
+/// over right away.
+////////////////////////////////////////////////////////////////////////////
+class UserArbiter {
+public:
+  enum class Policy { Closest, Engaged, RaisedHand };
+
+  /// How long another user must be the better choice to take over.
+  static const Uint32 HANDOFF_MS = 500;
+
+  explicit UserArbiter(Policy policy = Policy::Closest);
+
+  /// \brief Choose the user in control in \c frame.
+  /// \param gestures The gesture of each tracked body in \c frame, by
+  ///                 index into BodyFrame::bodies.
+  /// \return Index into BodyFrame::bodies, -1 if no body is tracked.
+  int select(const BodyFrame &frame, const GestureSample *gestures);
+
+  Policy policy() const { return m_policy; }
+
+  /// \brief Times control moved from one user to another.
+  size_t handoffs() const { return m_handoffs; }
+
+  static const char *name(Policy policy);
+  /// \brief Parse the name() of a policy.
+  /// \return false if \c name is not a policy.
+  static bool parse(const std::string &name, Policy *policy);
+
+private:
+  /// \brief How well body \c index of \c frame suits the policy, higher is
+  ///        better.
+  /// \return false if the body is no candidate at all.
+  bool score(const BodyFrame &frame, int index, float *score);
+
+  Policy m_policy;
+  Uint64 m_controller;     ///< Tracking id of the user in control, 0 if none.
+  Uint64 m_candidate;      ///< Tracking id of the user about to take over.
+  Uint32 m_candidateSince; ///< Sensor time m_candidate became the better
+                           /// choice.
+  Uint64 m_raisedId[BodyFrame::MAX_BODIES]; ///< Body with a raised hand.
+  Uint32 m_raisedMs[BodyFrame::MAX_BODIES]; ///< When it was raised.
+  size_t m_handoffs;
+};
+
+#endif // ! epic_userarbiter_h__
@@ -0,0 +1,50 @@
+#include "webpdecoder.h"
+
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////
+bool isWebP(const Uint8 *data, size_t size) {
+  return size >= 12 && std::memcmp(data, "RIFF", 4) == 0 &&
+         std::memcmp(data + 8, "WEBP", 4) == 0;
+}
+
+#ifdef EPIC_LIBWEBP
+#include <webp/decode.h>
+
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *decodeWebP(const Uint8 *data, size_t size, const SDL_Point &,
+                        SDL_Point *fullDims) {
+  WebPDecoderConfig config;
+  if (!WebPInitDecoderConfig(&config) ||
+      WebPGetFeatures(data, size, &config.input) != VP8_STATUS_OK ||
+      config.input.has_animation)
+    return nullptr;
+
+  const int w{config.input.width}, h{config.input.height};
+  *fullDims = {w, h};
+
+  SDL_Surface *argb{SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00,
+                                         0x000000ff, 0xff000000)};
+  if (argb == nullptr)
+    return nullptr;
+
+  config.options.use_threads = 1;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+  config.output.colorspace = MODE_BGRA;
+#else
+  config.output.colorspace = MODE_ARGB;
+#endif
+  config.output.is_external_memory = 1;
+  config.output.u.RGBA.rgba = static_cast<uint8_t *>(argb->pixels);
+  config.output.u.RGBA.stride = argb->pitch;
+  config.output.u.RGBA.size = static_cast<size_t>(argb->pitch) * h;
+
+  const VP8StatusCode status{WebPDecode(data, size, &config)};
+  WebPFreeDecBuffer(&config.output);
+  if (status != VP8_STATUS_OK) {
+    SDL_FreeSurface(argb);
+    return nullptr;
+  }
+  return argb;
+}
+#endif // EPIC_LIBWEBP
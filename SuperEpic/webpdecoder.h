@@ -0,0 +1,24 @@
+#ifndef epic_webpdecoder_h__
+#define epic_webpdecoder_h__
+
+#include <SDL.h>
+
+#include <cstddef>
+
+/// \brief True if \c data is a RIFF file of the WEBP form.
+bool isWebP(const Uint8 *data, size_t size);
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief Decode the WebP file \c data into an ARGB8888 surface.
+///
+/// libwebp decodes straight into the surface, with its filtering on a
+/// second thread. The image is always decoded at full resolution, \c box
+/// is not used. Only built with EPIC_LIBWEBP, see CodecRegistry.
+///
+/// \param fullDims Set to the dimensions of the image.
+/// \return nullptr if decoding failed, or for animations.
+////////////////////////////////////////////////////////////////////////////
+SDL_Surface *decodeWebP(const Uint8 *data, size_t size, const SDL_Point &box,
+                        SDL_Point *fullDims);
+
+#endif // ! epic_webpdecoder_h__
@@ -0,0 +1,23 @@
+#ifndef epic_yuvimage_h__
+#define epic_yuvimage_h__
+
+#include <SDL.h>
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////
+/// \brief A YCbCr 4:2:0 image in the three planes of SDL_PIXELFORMAT_IYUV.
+///
+/// The samples are in the BT.601 video range (Y 16-235, Cb and Cr 16-240),
+/// which is what SDL's YUV textures convert from. Takes 1.5 bytes per pixel
+/// against the 4 of ARGB8888.
+////////////////////////////////////////////////////////////////////////////
+struct YUVImage {
+  int w;                ///< Width of the Y plane.
+  int h;                ///< Height of the Y plane.
+  std::vector<Uint8> y; ///< w x h samples, rows w apart.
+  std::vector<Uint8> u; ///< Cb, (w + 1) / 2 x (h + 1) / 2 samples.
+  std::vector<Uint8> v; ///< Cr, same size as u.
+};
+
+#endif // ! epic_yuvimage_h__